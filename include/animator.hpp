@@ -1,17 +1,48 @@
 #ifndef ANIMATOR_HPP
 #define ANIMATOR_HPP
 
+#include <atomic>
 #include <chrono>
+#include <exception>
+#include <utility>
+#include <vector>
 
 #include "painter.hpp"
+#include "spsc_queue.hpp"
 
 class Universe; // forward declare
 
+// one generation as seen through an animator's viewport, copied out on the simulation thread
+// so that drawing it never touches the Universe
+struct Frame {
+    size_t generation{0};
+    size_t universe_rows{0};
+    size_t universe_cols{0};
+    // Universe rows and cols of the viewport, inclusive
+    size_t top_row{0};
+    size_t left_col{0};
+    size_t bottom_row{0};
+    size_t right_col{0};
+    std::vector<std::pair<size_t, size_t>> cells; // alive Cells in the viewport, relative to its top left
+};
+
+// a simulation thread advances the Universe and publishes a Frame per generation through a queue,
+// while the calling thread draws one Frame per refresh period
+// so drawing and stepping overlap, and the simulation runs up to queue_depth Frames ahead of the display
 class Animator {
     public:
-        Animator(std::chrono::milliseconds refresh_period);
-        virtual void animate(Universe* universe, size_t time_steps) = 0;
+        Animator(std::chrono::milliseconds refresh_period, size_t queue_depth = 8, int fd = STDOUT_FILENO);
+        // draws generations 0 to time_steps - 1 and leaves universe time_steps generations on
+        // rethrows what the simulation thread threw
+        void animate(Universe* universe, size_t time_steps);
+        // the most Frames waiting to be drawn during the last animate()
+        size_t maxQueuedFrames() const { return m_max_queued; }
+        virtual ~Animator() = default;
     protected:
+        // fills frame, whose cells may hold a previous Frame's, from universe, on the simulation thread
+        virtual void makeFrame(const Universe& universe, Frame& frame) = 0;
+        // paints frame on m_painter, on the drawing thread
+        virtual void drawFrame(const Frame& frame) = 0;
         void printRowOffset(size_t offset, Color color=Color::yellow);
         void printColOffset(size_t offset, Color color=Color::yellow);
         void paintLeftMargin(size_t row_count, size_t thickness, Color color);
@@ -21,25 +52,40 @@ class Animator {
         std::chrono::milliseconds m_refresh_period;
         size_t m_time_steps;
         GridPainter m_painter;
+    private:
+        void simulate(Universe* universe, size_t time_steps);
+        SpscQueue<Frame> m_frames;
+        std::atomic<bool> m_stopping{false}; // the drawing thread failed, the simulation gives up
+        std::atomic<bool> m_simulation_done{false};
+        std::exception_ptr m_simulation_error;
+        size_t m_max_queued{0};
 };
 
 class FullViewAnimator: public Animator {
     public:
-        FullViewAnimator(std::chrono::milliseconds refresh_period);
-        void animate(Universe* universe, size_t time_steps) override;
+        FullViewAnimator(std::chrono::milliseconds refresh_period, size_t queue_depth = 8, int fd = STDOUT_FILENO);
+    protected:
+        void makeFrame(const Universe& universe, Frame& frame) override;
+        void drawFrame(const Frame& frame) override;
 };
 
 class AutoPanAnimator: public Animator {
     public:
-        AutoPanAnimator(std::chrono::milliseconds refresh_period);
-        void animate(Universe* universe, size_t time_steps) override;
+        AutoPanAnimator(std::chrono::milliseconds refresh_period, size_t queue_depth = 8, int fd = STDOUT_FILENO);
+    protected:
+        void makeFrame(const Universe& universe, Frame& frame) override;
+        void drawFrame(const Frame& frame) override;
 };
 
 class CenterAutoPanAnimator: public Animator {
     public:
-        CenterAutoPanAnimator(std::chrono::milliseconds refresh_period);
-        void animate(Universe* universe, size_t time_steps) override;
+        CenterAutoPanAnimator(std::chrono::milliseconds refresh_period, size_t queue_depth = 8, int fd = STDOUT_FILENO);
+    protected:
+        void makeFrame(const Universe& universe, Frame& frame) override;
+        void drawFrame(const Frame& frame) override;
+    private:
+        static constexpr size_t viewport_rows = 40;
+        static constexpr size_t viewport_cols = 40;
 };
 
 #endif
-
@@ -0,0 +1,48 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// bump allocator for everything that lives for one generation, deallocate is a no-op
+// reset() rewinds it in one go and keeps the memory, folding several chunks into one
+// so that a steady population stops reaching the heap
+class Arena: public std::pmr::memory_resource {
+    public:
+        Arena() = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        // only once nothing allocated from the arena is used anymore
+        void reset();
+        size_t bytesReserved() const;
+    private:
+        static constexpr size_t min_chunk_size = 64 * 1024;
+        struct Chunk {
+            std::unique_ptr<std::byte[]> data;
+            size_t size;
+        };
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void*, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+        std::vector<Chunk> m_chunks;
+        size_t m_used{0}; // bytes taken from the last chunk
+};
+
+// one arena per side of a double buffer, a side's arena is reset whenever that side is cleared
+// disabled arenas hand out the default heap instead, for comparisons
+class PingPongArena {
+    public:
+        std::pmr::memory_resource* resource(size_t side);
+        void reset(size_t side);
+        bool enabled() const { return m_enabled; }
+        // only while nothing is allocated from either side
+        void setEnabled(bool enabled) { m_enabled = enabled; }
+    private:
+        std::array<Arena, 2> m_arenas;
+        bool m_enabled{true};
+};
+
+#endif
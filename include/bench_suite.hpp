@@ -0,0 +1,49 @@
+#ifndef BENCH_SUITE_HPP
+#define BENCH_SUITE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// the engine benchmark suite behind `bench suite`: every engine over soups of several sizes and densities
+// and over canonical patterns, each scenario repeated to measure its spread
+// results print as a table and optionally go to a JSON file, which a later run can compare against
+struct BenchSuiteOptions {
+    std::vector<std::string> engines; // empty runs every engine
+    std::vector<size_t> sizes{256, 1024};
+    std::vector<double> densities{0.1, 0.3, 0.5};
+    size_t repetitions{5};
+    double min_seconds{0.2}; // the first repetition runs at least this long, the rest run as many generations
+    std::filesystem::path pattern_directory; // holds gosper_glider.univ
+    std::filesystem::path json_path;
+    std::filesystem::path baseline_path;
+    double tolerance{0.1}; // slowdown beyond which a result counts as a regression, widened by noise
+};
+
+struct BenchResult {
+    std::string engine;
+    std::string scenario;
+    size_t size{0};
+    size_t generations{0};
+    size_t repetitions{0};
+    double gen_per_sec{0.0}; // mean over repetitions
+    double gen_per_sec_stddev{0.0};
+    double live_cells_per_sec{0.0}; // population averaged over the timed generations, times gen/s
+    double bytes_per_live_cell{0.0}; // heap held by the engine over its final population
+    size_t population{0}; // after the last generation
+};
+
+// live heap bytes, counted by the bench executable's operator new
+using HeapBytesFn = size_t (*)();
+
+std::vector<BenchResult> runBenchSuite(const BenchSuiteOptions& options, HeapBytesFn heap_bytes);
+void writeBenchJson(const std::filesystem::path& json_path, const std::vector<BenchResult>& results);
+std::vector<BenchResult> readBenchJson(const std::filesystem::path& json_path);
+// prints every result found in both, returns the number of regressions
+size_t compareBenchResults(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& results,
+        double tolerance);
+// parses `bench suite` arguments, runs, writes and compares, returns the process exit code
+int benchSuiteMain(int argc, const char** argv, const std::filesystem::path& pattern_directory, HeapBytesFn heap_bytes);
+
+#endif
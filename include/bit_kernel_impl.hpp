@@ -0,0 +1,207 @@
+#ifndef BIT_KERNEL_IMPL_HPP
+#define BIT_KERNEL_IMPL_HPP
+
+// shared body of the row kernels, included by one translation unit per instruction set
+// everything here has internal linkage so differently compiled copies never get merged
+// the rule only comes in as its plain table, an inline function of a shared header such as a member of Rule
+// would be emitted as a weak symbol by each translation unit, and the linker could keep the one compiled
+// with the widest instruction set for every caller
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "bit_kernels.hpp"
+#include "rule.hpp"
+
+namespace {
+
+// V is uint64_t or a GCC vector of uint64_t lanes, all operators act lane-wise
+template <typename V>
+inline V loadWords(uint64_t const* words) {
+    V v;
+    __builtin_memcpy(&v, words, sizeof(V));
+    return v;
+}
+
+template <typename V>
+inline void storeWords(uint64_t* words, V v) {
+    __builtin_memcpy(words, &v, sizeof(V));
+}
+
+// next state of the cells in `alive` from their 8 neighbor words
+// sums the 8 neighbor bits with full adders and applies B3/S23 without branching
+template <typename V>
+inline V nextCells(V alive,
+        V above_west, V above, V above_east,
+        V west, V east,
+        V below_west, V below, V below_east) {
+    // per row partial sums, bit weights 1 and 2
+    V above_ones = above_west ^ above ^ above_east;
+    V above_twos = (above_west & above) | (above_east & (above_west ^ above));
+    V below_ones = below_west ^ below ^ below_east;
+    V below_twos = (below_west & below) | (below_east & (below_west ^ below));
+    V mid_ones = west ^ east;
+    V mid_twos = west & east;
+    // fold the ones, their carry joins the twos
+    V ones = above_ones ^ below_ones ^ mid_ones;
+    V ones_carry = (above_ones & below_ones) | (mid_ones & (above_ones ^ below_ones));
+    // exactly one of the four weight-2 bits set <=> neighbor count is 2 or 3
+    V twos_lo = above_twos ^ below_twos;
+    V twos_hi = mid_twos ^ ones_carry;
+    V exactly_one_two = (twos_lo ^ twos_hi) & ~(above_twos & below_twos) & ~(mid_twos & ones_carry);
+    return exactly_one_two & (ones | alive);
+}
+
+// the full neighbor count of each bit as four bit planes
+template <typename V>
+struct NeighborCount {
+    V ones;
+    V twos;
+    V fours;
+    V eights;
+};
+
+template <typename V>
+inline NeighborCount<V> countNeighbors(
+        V above_west, V above, V above_east,
+        V west, V east,
+        V below_west, V below, V below_east) {
+    V above_ones = above_west ^ above ^ above_east;
+    V above_twos = (above_west & above) | (above_east & (above_west ^ above));
+    V below_ones = below_west ^ below ^ below_east;
+    V below_twos = (below_west & below) | (below_east & (below_west ^ below));
+    V mid_ones = west ^ east;
+    V mid_twos = west & east;
+    V ones = above_ones ^ below_ones ^ mid_ones;
+    V ones_carry = (above_ones & below_ones) | (mid_ones & (above_ones ^ below_ones));
+    // four weight-2 bits, at most two of their carries can be set
+    V twos_lo = above_twos ^ below_twos;
+    V twos_lo_carry = above_twos & below_twos;
+    V twos_hi = mid_twos ^ ones_carry;
+    V twos_hi_carry = mid_twos & ones_carry;
+    V twos_carry = twos_lo & twos_hi;
+    V fours = twos_lo_carry ^ twos_hi_carry ^ twos_carry;
+    V eights = (twos_lo_carry & twos_hi_carry) | (twos_carry & (twos_lo_carry ^ twos_hi_carry));
+    return {ones, twos_lo ^ twos_hi, fours, eights};
+}
+
+// bits whose neighbor count is Count, a count of 8 leaves the lower planes clear
+template <typename V, size_t Count>
+inline V countEquals(const NeighborCount<V>& count) {
+    if constexpr (Count == 8) {
+        return count.eights;
+    }
+    else {
+        return ((Count & 1) ? count.ones : ~count.ones)
+            & ((Count & 2) ? count.twos : ~count.twos)
+            & ((Count & 4) ? count.fours : ~count.fours)
+            & ~count.eights;
+    }
+}
+
+// bits that are alive next generation if their neighbor count is Count
+// a known table folds to alive, ~alive, all or nothing, so unused counts drop out of the kernel
+// the run time table is broadcast into masks instead of branched on
+template <typename V, uint32_t Table, size_t Count>
+inline V nextIfCount(V alive, uint32_t table) {
+    V zero{};
+    if constexpr (Table == dynamic_rule_table) {
+        V born = zero | (0 - uint64_t{(table >> Count) & 1});
+        V survives = zero | (0 - uint64_t{(table >> (9 + Count)) & 1});
+        return (born & ~alive) | (survives & alive);
+    }
+    else {
+        constexpr bool born = (Table >> Count) & 1;
+        constexpr bool survives = (Table >> (9 + Count)) & 1;
+        if constexpr (born && survives) {
+            return ~zero;
+        }
+        else if constexpr (born) {
+            return ~alive;
+        }
+        else if constexpr (survives) {
+            return alive;
+        }
+        else {
+            return zero;
+        }
+    }
+}
+
+template <typename V, uint32_t Table, size_t... Counts>
+inline V applyRule(V alive, const NeighborCount<V>& count, uint32_t table, std::index_sequence<Counts...>) {
+    V next{};
+    ((next |= countEquals<V, Counts>(count) & nextIfCount<V, Table, Counts>(alive, table)), ...);
+    return next;
+}
+
+// next state of the cells in `alive` under the rule with the given table
+// Table is the table as a compile time constant, or dynamic_rule_table to read the table argument
+// B3/S23 keeps the shorter adder above
+template <typename V, uint32_t Table>
+inline V nextCellsByRule(V alive,
+        V above_west, V above, V above_east,
+        V west, V east,
+        V below_west, V below, V below_east,
+        uint32_t table) {
+    if constexpr (Table == conway_life.table()) {
+        return nextCells<V>(alive, above_west, above, above_east, west, east, below_west, below, below_east);
+    }
+    else {
+        NeighborCount<V> count = countNeighbors<V>(above_west, above, above_east,
+                west, east, below_west, below, below_east);
+        return applyRule<V, Table>(alive, count, table, std::make_index_sequence<9>{});
+    }
+}
+
+// bit i of the result holds the west (col - 1) or east (col + 1) neighbor of column i
+template <typename V>
+inline V westWords(uint64_t const* words) {
+    return (loadWords<V>(words) << 1) | (loadWords<V>(words - 1) >> 63);
+}
+
+template <typename V>
+inline V eastWords(uint64_t const* words) {
+    return (loadWords<V>(words) >> 1) | (loadWords<V>(words + 1) << 63);
+}
+
+template <typename V, uint32_t Table>
+inline V stepWords(uint64_t const* above, uint64_t const* row, uint64_t const* below, uint32_t table) {
+    return nextCellsByRule<V, Table>(loadWords<V>(row),
+            westWords<V>(above), loadWords<V>(above), eastWords<V>(above),
+            westWords<V>(row), eastWords<V>(row),
+            westWords<V>(below), loadWords<V>(below), eastWords<V>(below),
+            table);
+}
+
+template <typename V, uint32_t Table>
+void advanceRowWith(uint64_t const* above, uint64_t const* row, uint64_t const* below,
+        uint64_t* next, size_t word_count, uint32_t table) {
+    constexpr size_t lanes = sizeof(V) / sizeof(uint64_t);
+    size_t w = 0;
+    for (; w + lanes <= word_count; w += lanes) {
+        storeWords<V>(next + w, stepWords<V, Table>(above + w, row + w, below + w, table));
+    }
+    for (; w < word_count; ++w) {
+        next[w] = stepWords<uint64_t, Table>(above + w, row + w, below + w, table);
+    }
+}
+
+// the kernel compiled for the rule with rule_table, or the one reading the table at run time
+template <typename V>
+RowKernel rowKernelFor(uint32_t rule_table) {
+    return withRuleTable(rule_table, [](auto table) -> RowKernel {
+        return advanceRowWith<V, decltype(table)::value>;
+    });
+}
+
+}
+
+// defined by each instruction set's translation unit, nullptr when not compiled in
+RowKernel scalarRowKernel(uint32_t rule_table);
+RowKernel sse2RowKernel(uint32_t rule_table);
+RowKernel avx2RowKernel(uint32_t rule_table);
+RowKernel avx512RowKernel(uint32_t rule_table);
+
+#endif
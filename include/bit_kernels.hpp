@@ -0,0 +1,29 @@
+#ifndef BIT_KERNELS_HPP
+#define BIT_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "rule.hpp"
+
+enum class KernelIsa {
+    scalar,
+    sse2,
+    avx2,
+    avx512,
+};
+
+// computes the next generation of one bit-packed row from the rows above and below it
+// every row pointer must have one readable word before index 0 and one after index word_count - 1
+// rule_table is Rule::table(), kernels compiled for one of the named rules ignore it
+using RowKernel = void (*)(uint64_t const* above, uint64_t const* row, uint64_t const* below,
+        uint64_t* next, size_t word_count, uint32_t rule_table);
+
+// nullptr when the kernel was not compiled in or the CPU lacks the instructions
+RowKernel getRowKernel(KernelIsa isa, Rule rule = conway_life);
+bool isKernelIsaSupported(KernelIsa isa);
+// widest supported kernel, checked once with CPUID
+KernelIsa bestKernelIsa();
+const char* kernelIsaName(KernelIsa isa);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef BIT_UNIVERSE_HPP
+#define BIT_UNIVERSE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "bit_kernels.hpp"
+#include "tile_activity.hpp"
+#include "universe.hpp"
+
+// keeps all Cells in memory, packed 64 to a word along each row
+// a generation is computed with bitwise adders by a SIMD row kernel picked at runtime
+// only tiles near a change in the last generation are recomputed
+class BitUniverse: public Universe {
+    public:
+        BitUniverse(size_t rows, size_t cols);
+        BitUniverse(const std::filesystem::path& file_path);
+        void advance() override;
+        // steps bands of tile rows temporalBlockDepth() generations at a time in a cache sized scratch grid,
+        // so the grid is read and written once per block of generations instead of once per generation
+        void advance(size_t generations) override;
+        bool isCellAlive(size_t row, size_t col) override;
+        void makeCellAlive(size_t row, size_t col) override;
+        void makeCellDead(size_t row, size_t col) override;
+        void forEachAliveCell(CellVisitor visit) const override;
+        // only the words of rect are read, counting is a popcount per word
+        void forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const override;
+        size_t countAliveIn(const CellRect& rect) const override;
+        // copies the current grid's words without the padding
+        void takeSnapshot(CellSnapshot& snapshot) const override;
+        // zeroes both grids and flags every tile
+        void makeAllCellsDead() override;
+        void save(const std::filesystem::path& file_path) const override;
+        void load(const std::filesystem::path& file_path) override;
+        void setRule(Rule rule) override;
+        // defaults to the widest kernel the CPU supports, throws if the requested one is unsupported
+        void setKernelIsa(KernelIsa isa);
+        KernelIsa kernelIsa() const { return m_kernel_isa; }
+        // generations per pass of advance(generations), 1 to 64, 1 steps one generation per pass like advance()
+        void setTemporalBlockDepth(size_t depth);
+        size_t temporalBlockDepth() const { return m_block_depth; }
+    private:
+        static constexpr size_t tile_rows = 64;
+        static constexpr size_t tile_words = 8; // 512 columns, one AVX-512 register
+        // both scratch grids of a band, about an L2 cache
+        static constexpr size_t temporal_block_bytes = size_t{1} << 20;
+        void initWords();
+        // re-sums the tiles changed since the last call, advance() only flags them
+        void settleSummary() const override;
+        void advanceTileRows(size_t begin_tile_row, size_t end_tile_row);
+        // depth generations in one pass, each band of tile rows with a halo of depth rows on either side
+        void advanceBlocked(size_t depth);
+        void advanceBlock(size_t begin_tile_row, size_t end_tile_row, size_t depth, std::vector<uint64_t>& scratch);
+        uint64_t* getCurrentRow(size_t row);
+        uint64_t const* getCurrentRow(size_t row) const;
+        uint64_t* getNextRow(size_t row);
+        // the bits of word w that lie in cols [left, right)
+        static uint64_t colMask(size_t w, size_t left, size_t right);
+        size_t m_words_per_row{0};
+        size_t m_row_stride{0}; // words per row including the padding
+        KernelIsa m_kernel_isa{KernelIsa::scalar};
+        RowKernel m_row_kernel{nullptr};
+        uint64_t m_last_word_mask{0}; // clears the bits past the last column
+        std::vector<uint64_t> m_word_grid_1;
+        std::vector<uint64_t> m_word_grid_2;
+        bool m_grid_1_is_current{true};
+        TileActivity m_activity;
+        size_t m_block_depth{8};
+        std::vector<std::vector<uint64_t>> m_block_scratch; // per thread
+        mutable std::vector<AliveSummary> m_tile_summaries; // as of each tile's last settling
+};
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef CELL_HPP
 #define CELL_HPP
 
+#include <memory>
 #include <vector>
 #include <cstddef>
 
@@ -8,12 +9,12 @@ class Cell {
     public:
         Cell();
         Cell(size_t row, size_t col, size_t flat_pos, bool alive=false);
-        bool isAlive() const;
+        bool isAlive() const { return m_is_alive; }
         size_t row() const { return m_row; }
         size_t col() const { return m_col; }
         size_t flatPos() const { return m_flat_pos; }
-        void makeAlive();
-        void makeDead();
+        void makeAlive() { m_is_alive = true; }
+        void makeDead() { m_is_alive = false; }
     private:
         size_t m_row; // tracks its position within the Universe
         size_t m_col;
@@ -21,6 +22,12 @@ class Cell {
         bool m_is_alive{false};
 };
 
-bool operator<(const std::unique_ptr<Cell>& a, const std::unique_ptr<Cell>& b);
+// orders Cells by position, and finds them by flat position without making a Cell
+struct CellFlatPosLess {
+    using is_transparent = void;
+    bool operator()(const Cell* a, const Cell* b) const { return a->flatPos() < b->flatPos(); }
+    bool operator()(const Cell* a, size_t flat_pos) const { return a->flatPos() < flat_pos; }
+    bool operator()(size_t flat_pos, const Cell* b) const { return flat_pos < b->flatPos(); }
+};
 
 #endif
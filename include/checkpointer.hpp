@@ -0,0 +1,60 @@
+#ifndef CHECKPOINTER_HPP
+#define CHECKPOINTER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "universe.hpp"
+
+// writes periodic checkpoints of a running Universe on a thread of its own
+// between generations the simulation only takes a CellSnapshot into a recycled buffer, which for BitUniverse
+// is a copy of its words, decoding, encoding, writing and fsync happen on the writer thread while advance() goes on
+// checkpoints go to directory/checkpoint_<generation>.univ in the binary format, through a temporary file
+// that is renamed once it is on disk, so a crash leaves the previous checkpoint intact
+class Checkpointer {
+    public:
+        // keeps the newest keep_count checkpoints, older ones are removed once a newer one is on disk
+        Checkpointer(const std::filesystem::path& directory, size_t interval, size_t keep_count = 2);
+        // call once per generation, snapshots universe when generation is a multiple of the interval
+        void onGeneration(const Universe& universe, size_t generation);
+        // snapshots universe now, a snapshot still waiting for the writer is replaced by this newer one
+        void checkpoint(const Universe& universe, size_t generation);
+        // blocks until every snapshot taken so far is on disk, rethrows the writer's error if it had one
+        void flush();
+        size_t writtenCount() const;
+        // snapshots replaced before the writer got to them
+        size_t supersededCount() const;
+        std::filesystem::path latestPath() const;
+        ~Checkpointer();
+    private:
+        struct Snapshot {
+            size_t generation{0};
+            CellSnapshot cells;
+        };
+        void writeLoop();
+        void write(Snapshot& snapshot);
+        std::filesystem::path m_directory;
+        size_t m_interval;
+        size_t m_keep_count;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_changed;
+        Snapshot m_pending;
+        bool m_has_pending{false};
+        bool m_writing{false};
+        bool m_stopping{false};
+        CellSnapshot m_spare; // the buffers the next snapshot is copied into
+        std::deque<std::filesystem::path> m_written;
+        size_t m_written_count{0};
+        size_t m_superseded_count{0};
+        std::exception_ptr m_error;
+        std::thread m_writer; // last, so it starts after everything it reads
+};
+
+#endif
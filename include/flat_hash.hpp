@@ -0,0 +1,234 @@
+#ifndef FLAT_HASH_HPP
+#define FLAT_HASH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+
+// open addressing over one flat array of 64-bit keys with linear probing, no per entry allocation
+// the all ones key marks an empty slot, so it is kept outside the array behind a flag
+// clear() keeps the capacity so that tables cleared every generation stop allocating once warm
+// the arrays come from the memory resource given at construction
+class FlatHashKeys {
+    public:
+        static constexpr uint64_t empty_key = ~uint64_t{0};
+        size_t size() const { return m_size + (m_has_empty_key ? 1 : 0); }
+        bool empty() const { return size() == 0; }
+        size_t capacity() const { return m_keys.size(); }
+    protected:
+        explicit FlatHashKeys(std::pmr::memory_resource* resource): m_keys(resource) {}
+        // fibonacci hashing, the top bits of key * 2^64 / phi pick the home slot
+        size_t homeSlot(uint64_t key) const { return (key * 0x9e3779b97f4a7c15ull) >> m_shift; }
+        // the slot holding key, or the empty slot that ends its probe run
+        size_t findSlot(uint64_t key) const {
+            size_t slot = homeSlot(key);
+            while (m_keys[slot] != key && m_keys[slot] != empty_key) {
+                slot = (slot + 1) & m_mask;
+            }
+            return slot;
+        }
+        // keeps the array at most 3/4 full
+        bool needsGrow() const { return (m_size + 1) * 4 > capacity() * 3; }
+        static size_t capacityFor(size_t count) {
+            size_t capacity = 16;
+            while (count * 4 > capacity * 3) {
+                capacity *= 2;
+            }
+            return capacity;
+        }
+        void resetKeys(size_t capacity) {
+            m_keys.assign(capacity, empty_key);
+            m_mask = capacity - 1;
+            m_shift = 64 - __builtin_ctzll(capacity);
+            m_size = 0;
+        }
+        void clearKeys() {
+            if (m_size != 0) {
+                std::fill(m_keys.begin(), m_keys.end(), empty_key);
+                m_size = 0;
+            }
+            m_has_empty_key = false;
+        }
+        // backward shift deletion: later entries of the probe run move into the hole, so no tombstones are needed
+        // move_slot(from, to) moves whatever the derived table stores next to the key
+        template <typename MoveSlot>
+        void eraseSlot(size_t hole, MoveSlot move_slot) {
+            for (size_t slot = (hole + 1) & m_mask; m_keys[slot] != empty_key; slot = (slot + 1) & m_mask) {
+                // the entry may fill the hole unless its home slot lies cyclically in (hole, slot]
+                size_t home = homeSlot(m_keys[slot]);
+                if (((slot - home) & m_mask) >= ((slot - hole) & m_mask)) {
+                    m_keys[hole] = m_keys[slot];
+                    move_slot(slot, hole);
+                    hole = slot;
+                }
+            }
+            m_keys[hole] = empty_key;
+            --m_size;
+        }
+        std::pmr::vector<uint64_t> m_keys;
+        size_t m_size{0}; // keys in the array, the empty key is counted by its flag
+        size_t m_mask{0};
+        unsigned m_shift{64};
+        bool m_has_empty_key{false};
+};
+
+class FlatHashSet: public FlatHashKeys {
+    public:
+        explicit FlatHashSet(std::pmr::memory_resource* resource = std::pmr::get_default_resource()):
+            FlatHashKeys(resource) {}
+        bool contains(uint64_t key) const {
+            if (key == empty_key) {
+                return m_has_empty_key;
+            }
+            return m_size != 0 && m_keys[findSlot(key)] == key;
+        }
+        // returns false when the key was already there
+        bool insert(uint64_t key) {
+            if (key == empty_key) {
+                return !std::exchange(m_has_empty_key, true);
+            }
+            if (needsGrow()) {
+                rehash(capacityFor(m_size + 1));
+            }
+            size_t slot = findSlot(key);
+            if (m_keys[slot] == key) {
+                return false;
+            }
+            m_keys[slot] = key;
+            ++m_size;
+            return true;
+        }
+        bool erase(uint64_t key) {
+            if (key == empty_key) {
+                return std::exchange(m_has_empty_key, false);
+            }
+            if (m_size == 0) {
+                return false;
+            }
+            size_t slot = findSlot(key);
+            if (m_keys[slot] != key) {
+                return false;
+            }
+            eraseSlot(slot, [](size_t, size_t) {});
+            return true;
+        }
+        void clear() { clearKeys(); }
+        void reserve(size_t count) {
+            if (capacityFor(count) > capacity()) {
+                rehash(capacityFor(count));
+            }
+        }
+        template <typename Visitor>
+        void forEach(Visitor&& visit) const {
+            for (uint64_t key: m_keys) {
+                if (key != empty_key) {
+                    visit(key);
+                }
+            }
+            if (m_has_empty_key) {
+                visit(empty_key);
+            }
+        }
+    private:
+        void rehash(size_t capacity) {
+            std::pmr::vector<uint64_t> old_keys = std::move(m_keys);
+            resetKeys(capacity);
+            for (uint64_t key: old_keys) {
+                if (key != empty_key) {
+                    m_keys[findSlot(key)] = key;
+                    ++m_size;
+                }
+            }
+        }
+};
+
+// values sit in a parallel array so that probing only touches keys
+template <typename Value>
+class FlatHashMap: public FlatHashKeys {
+    public:
+        explicit FlatHashMap(std::pmr::memory_resource* resource = std::pmr::get_default_resource()):
+            FlatHashKeys(resource), m_values(resource) {}
+        Value* find(uint64_t key) {
+            if (key == empty_key) {
+                return m_has_empty_key ? &m_empty_key_value : nullptr;
+            }
+            if (m_size == 0) {
+                return nullptr;
+            }
+            size_t slot = findSlot(key);
+            return m_keys[slot] == key ? &m_values[slot] : nullptr;
+        }
+        const Value* find(uint64_t key) const { return const_cast<FlatHashMap*>(this)->find(key); }
+        bool contains(uint64_t key) const { return find(key) != nullptr; }
+        // value initializes a missing entry, like std::unordered_map
+        Value& operator[](uint64_t key) {
+            if (key == empty_key) {
+                if (!std::exchange(m_has_empty_key, true)) {
+                    m_empty_key_value = Value{};
+                }
+                return m_empty_key_value;
+            }
+            if (needsGrow()) {
+                rehash(capacityFor(m_size + 1));
+            }
+            size_t slot = findSlot(key);
+            if (m_keys[slot] != key) {
+                m_keys[slot] = key;
+                m_values[slot] = Value{};
+                ++m_size;
+            }
+            return m_values[slot];
+        }
+        bool erase(uint64_t key) {
+            if (key == empty_key) {
+                return std::exchange(m_has_empty_key, false);
+            }
+            if (m_size == 0) {
+                return false;
+            }
+            size_t slot = findSlot(key);
+            if (m_keys[slot] != key) {
+                return false;
+            }
+            eraseSlot(slot, [this](size_t from, size_t to) { m_values[to] = std::move(m_values[from]); });
+            return true;
+        }
+        void clear() { clearKeys(); }
+        void reserve(size_t count) {
+            if (capacityFor(count) > capacity()) {
+                rehash(capacityFor(count));
+            }
+        }
+        template <typename Visitor>
+        void forEach(Visitor&& visit) const {
+            for (size_t slot = 0; slot < m_keys.size(); ++slot) {
+                if (m_keys[slot] != empty_key) {
+                    visit(m_keys[slot], m_values[slot]);
+                }
+            }
+            if (m_has_empty_key) {
+                visit(empty_key, m_empty_key_value);
+            }
+        }
+    private:
+        void rehash(size_t capacity) {
+            std::pmr::vector<uint64_t> old_keys = std::move(m_keys);
+            std::pmr::vector<Value> old_values = std::move(m_values);
+            resetKeys(capacity);
+            m_values.resize(capacity);
+            for (size_t slot = 0; slot < old_keys.size(); ++slot) {
+                if (old_keys[slot] != empty_key) {
+                    size_t new_slot = findSlot(old_keys[slot]);
+                    m_keys[new_slot] = old_keys[slot];
+                    m_values[new_slot] = std::move(old_values[slot]);
+                    ++m_size;
+                }
+            }
+        }
+        std::pmr::vector<Value> m_values;
+        Value m_empty_key_value{};
+};
+
+#endif
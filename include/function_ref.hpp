@@ -0,0 +1,28 @@
+#ifndef FUNCTION_REF_HPP
+#define FUNCTION_REF_HPP
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature>
+class FunctionRef;
+
+// non-owning reference to any callable, two pointers passed by value and never allocates
+// the callable must outlive the FunctionRef, so it is meant for parameters only
+template <typename Result, typename... Args>
+class FunctionRef<Result(Args...)> {
+    public:
+        template <typename Fn, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Fn>, FunctionRef>>>
+        FunctionRef(Fn&& fn):
+            m_callable(const_cast<void*>(static_cast<const void*>(std::addressof(fn)))),
+            m_call([](void* callable, Args... args) -> Result {
+                return (*static_cast<std::remove_reference_t<Fn>*>(callable))(std::forward<Args>(args)...);
+            }) {}
+        Result operator()(Args... args) const { return m_call(m_callable, std::forward<Args>(args)...); }
+    private:
+        void* m_callable;
+        Result (*m_call)(void*, Args...);
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef HASHLIFE_HPP
+#define HASHLIFE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "universe.hpp"
+
+// keeps the Universe as a canonicalized quadtree, identical subtrees are stored once
+// and their future is memoized, so repetitive patterns advance 2^k generations in O(k) node visits
+class HashLifeUniverse: public Universe {
+    public:
+        HashLifeUniverse(size_t rows, size_t cols);
+        HashLifeUniverse(const std::filesystem::path& file_path);
+        void advance() override;
+        // advances in power of two jumps, one per set bit of generations
+        void advance(size_t generations) override;
+        bool isCellAlive(size_t row, size_t col) override;
+        void makeCellAlive(size_t row, size_t col) override;
+        void makeCellDead(size_t row, size_t col) override;
+        void forEachAliveCell(CellVisitor visit) const override;
+        // descends only into nodes that overlap rect and hold alive Cells
+        void forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const override;
+        // adds up the population of nodes inside rect without descending into them
+        size_t countAliveIn(const CellRect& rect) const override;
+        // the root's population, no Cell is ever visited
+        size_t population() const override { return m_root->population; }
+        // from one pass over the distinct nodes of the root, memoized until the root changes
+        // so a pattern of repeating subtrees costs its node count rather than its population
+        std::pair<double, double> centroid() const override;
+        CellRect boundingBox() const override;
+        // the root's hash, composed from its quadrants' when the root was joined, no Cell is ever visited
+        uint64_t stateHash() const override { return m_root->hash; }
+        // the canonical root, kept alive through garbage collections while the copy holds it
+        void copyState(StateCopy& copy) const override;
+        // starts over from an empty root
+        void makeAllCellsDead() override;
+        void save(const std::filesystem::path& file_path) const override;
+        void load(const std::filesystem::path& file_path) override;
+        void setRule(Rule rule) override;
+        // builds each touched node once per batch instead of once per Cell
+        void insertAliveCells(const std::pair<size_t, size_t>* cells, size_t count) override;
+        // grafts the tree's nodes into the quadtree as they are, a pattern of repeating
+        // subtrees costs its node count rather than its population
+        void insertMacrocell(const MacrocellTree& tree) override;
+        // the quadtree as a macrocell node table, walls read as dead Cells
+        MacrocellTree toMacrocell() const;
+        size_t nodeCount() const { return m_node_ids.size(); }
+    private:
+        // level 0 nodes are single cells, a level k node covers 2^k x 2^k cells
+        // cells outside the Universe are walls: always dead and never born
+        enum class CellState: uint8_t { dead, alive, wall };
+        struct Node {
+            Node* nw{nullptr};
+            Node* ne{nullptr};
+            Node* sw{nullptr};
+            Node* se{nullptr};
+            Node* result{nullptr}; // center after 2^(level - 2) generations
+            uint64_t population{0};
+            uint64_t hash{0}; // sum of the cellHash of the alive Cells, relative to the top left corner
+            uint32_t level{0};
+            CellState state{CellState::dead}; // only meaningful for level 0
+            bool marked{false};
+        };
+        struct NodeKey {
+            Node* nw;
+            Node* ne;
+            Node* sw;
+            Node* se;
+            bool operator==(const NodeKey& other) const;
+        };
+        struct NodeKeyHash {
+            size_t operator()(const NodeKey& key) const;
+        };
+        // coordinate sums and bounds of a node's alive Cells, relative to its top left corner
+        struct NodeSummary {
+            CellSum row_sum{0};
+            CellSum col_sum{0};
+            CellRect bounds;
+        };
+        struct StepKey {
+            Node* node;
+            uint32_t step_log2;
+            bool operator==(const StepKey& other) const;
+        };
+        struct StepKeyHash {
+            size_t operator()(const StepKey& key) const;
+        };
+        void initRoot();
+        Node* newNode();
+        Node* join(Node* nw, Node* ne, Node* sw, Node* se);
+        Node* emptyNode(uint32_t level);
+        Node* wallNode(uint32_t level);
+        Node* buildRegion(uint32_t level, int64_t rows_left, int64_t cols_left);
+        Node* centeredNode(Node* node);
+        Node* expandWithWalls(Node* node);
+        Node* baseStep(Node* node);
+        Node* successor(Node* node, uint32_t step_log2);
+        void advancePow2(uint32_t step_log2);
+        Node* setCell(Node* node, size_t row, size_t col, CellState state);
+        using CellIterator = std::vector<std::pair<size_t, size_t>>::iterator;
+        Node* insertCells(Node* node, size_t top, size_t left, CellIterator begin, CellIterator end);
+        Node* leafNode(uint64_t bits, uint32_t level, size_t top, size_t left);
+        Node* graft(Node* dst, Node* src, std::unordered_map<NodeKey, Node*, NodeKeyHash>& grafted);
+        size_t exportNode(Node const* node, MacrocellTree& tree, std::unordered_map<Node const*, size_t>& indices) const;
+        void visitAliveCells(Node const* node, size_t top, size_t left, CellVisitor visit) const;
+        void visitAliveCellsIn(Node const* node, size_t top, size_t left, const CellRect& rect, CellVisitor visit) const;
+        uint64_t countAliveCellsIn(Node const* node, size_t top, size_t left, const CellRect& rect) const;
+        NodeSummary summarize(Node const* node, std::unordered_map<Node const*, NodeSummary>& summaries) const;
+        const NodeSummary& rootSummary() const;
+        void mark(Node* node);
+        void collectGarbage();
+        uint32_t m_root_level{1};
+        Node* m_root{nullptr};
+        Node* m_dead_cell{nullptr};
+        Node* m_alive_cell{nullptr};
+        Node* m_wall_cell{nullptr};
+        std::deque<Node> m_nodes; // stable addresses
+        std::vector<Node*> m_free_nodes;
+        std::unordered_map<NodeKey, Node*, NodeKeyHash> m_node_ids;
+        std::unordered_map<StepKey, Node*, StepKeyHash> m_partial_steps; // successors shorter than node->result
+        std::vector<Node*> m_empty_nodes;
+        std::vector<Node*> m_wall_nodes;
+        size_t m_gc_threshold{1 << 22};
+        // nodes never change, so their summaries carry over from one root to the next until nodes are freed
+        mutable std::unordered_map<Node const*, NodeSummary> m_summaries;
+        mutable Node const* m_summary_root{nullptr};
+        mutable NodeSummary m_root_summary;
+        // roots held by StateCopy identities, shared with their deleters so that they may outlive the Universe
+        struct RootPins {
+            std::unordered_map<Node*, size_t> counts;
+        };
+        std::shared_ptr<RootPins> m_root_pins{std::make_shared<RootPins>()};
+};
+
+#endif
@@ -1,7 +1,12 @@
 #ifndef PAINTER_HPP
 #define PAINTER_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
+
+#include <unistd.h>
 
 enum class Color {
     black = 30,
@@ -9,21 +14,57 @@ enum class Color {
     green = 32,
     yellow = 33,
     blue = 34,
+    none = 39, // the terminal's default
 };
 
+// draws frames of characters on a terminal through a framebuffer
+// paint() only fills the next frame, present() compares it with the frame on screen and emits the cells that
+// changed, cursor moves and colors included, as one buffer in a single write(2)
+// so the bytes and syscalls of a frame follow what changed rather than what is alive
 class GridPainter {
     public:
-        GridPainter();
+        explicit GridPainter(int fd = STDOUT_FILENO);
+        GridPainter(const GridPainter&) = delete;
+        GridPainter& operator=(const GridPainter&) = delete;
+        // zero based line and col, (0, 0) is top left, a Cell of the next frame not painted stays blank
         template <typename T>
         void paint(size_t row, size_t col, T cell_char, Color color);
-        template <typename T>
-        void paint(T cell_char, Color color);
+        // emits the difference to the frame on screen, writes nothing when the frames are the same
+        void present();
+        // blanks the whole terminal with the next present(), for when something else drew on it
         void clear();
-        void shiftCursor(size_t row, size_t col);
+        // moves the cursor to the line below the frames presented so far, for output after them
+        void moveBelowFrame();
+        size_t writeCount() const { return m_write_count; }
+        size_t bytesWritten() const { return m_bytes_written; }
+        // bytes of the last present(), 0 when nothing changed
+        size_t lastFrameBytes() const { return m_last_frame_bytes; }
         ~GridPainter();
     private:
-        inline static std::string m_esc{"\x1B["};
-        inline static std::string m_reset_style{"\x1B[0m"};
+        // a character of up to 4 UTF-8 bytes, packed so that cells compare as integers
+        struct FrameCell {
+            uint32_t glyph{' '};
+            Color color{Color::none};
+            bool operator==(const FrameCell& other) const { return glyph == other.glyph && color == other.color; }
+        };
+        static uint32_t packGlyph(char cell_char);
+        static uint32_t packGlyph(const char* cell_char);
+        void paintCell(size_t row, size_t col, FrameCell cell);
+        // grows both frames, they never shrink so that a frame smaller than the last blanks the difference
+        void resize(size_t rows, size_t cols);
+        void appendCursorMove(size_t row, size_t col);
+        void writeOut();
+        int m_fd;
+        size_t m_rows{0};
+        size_t m_cols{0};
+        std::vector<FrameCell> m_shown; // what the terminal shows
+        std::vector<FrameCell> m_next;
+        size_t m_painted_rows{0}; // lines the frames reached, for moveBelowFrame
+        bool m_clear_pending{true};
+        std::string m_out; // escape sequences and characters of a frame, kept for its capacity
+        size_t m_write_count{0};
+        size_t m_bytes_written{0};
+        size_t m_last_frame_bytes{0};
 };
 
 #endif
@@ -0,0 +1,56 @@
+#ifndef PATTERN_IO_HPP
+#define PATTERN_IO_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <optional>
+#include <vector>
+
+#include "rule.hpp"
+
+class Universe;
+
+// a Golly macrocell file as its table of distinct nodes, shared subtrees appear once
+// leaves are 8x8 level 3 nodes, a node of level k covers 2^k x 2^k Cells
+struct MacrocellTree {
+    struct Node {
+        uint32_t level{3};
+        uint64_t leaf_bits{0}; // level 3 only, bit 8 * row + col
+        std::array<size_t, 4> children{}; // nw, ne, sw, se as indices into nodes plus 1, 0 is an empty subtree
+    };
+    std::vector<Node> nodes; // children come before their parents, the last node is the root
+    std::optional<Rule> rule;
+    uint32_t rootLevel() const { return nodes.empty() ? 3 : nodes.back().level; }
+};
+
+// what a pattern file says about itself, rows and cols span from Cell (0, 0) to the far corner of the pattern
+struct PatternInfo {
+    size_t rows{0};
+    size_t cols{0};
+    std::optional<Rule> rule;
+};
+
+// run length encoded files (.rle) and Golly macrocell files (.mc)
+// readers place the pattern's top left corner on Cell (0, 0), set the Universe's rule when the file names one
+// and throw std::runtime_error on malformed input or Cells outside the Universe
+// RLE is decoded straight into Universe::insertAliveCells in small batches, never held whole
+// macrocell is held as its node table and handed to Universe::insertMacrocell, so HashLife keeps the sharing
+PatternInfo readRle(std::istream& in, Universe& universe);
+PatternInfo readMacrocell(std::istream& in, Universe& universe);
+MacrocellTree parseMacrocell(std::istream& in);
+// the header alone, to size a Universe before reading into it
+PatternInfo peekRle(std::istream& in);
+PatternInfo peekMacrocell(std::istream& in);
+// writers go in row major order, rule included
+void writeRle(std::ostream& out, const Universe& universe);
+void writeMacrocell(std::ostream& out, const Universe& universe);
+
+// picked by the .rle or .mc extension
+PatternInfo peekPattern(const std::filesystem::path& file_path);
+PatternInfo loadPattern(const std::filesystem::path& file_path, Universe& universe);
+void savePattern(const std::filesystem::path& file_path, const Universe& universe);
+
+#endif
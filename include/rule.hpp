@@ -0,0 +1,123 @@
+#ifndef RULE_HPP
+#define RULE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// an outer totalistic Life-like rule in B/S notation, e.g. B3/S23 for Conway's Life
+// the 2x9 table of next states is packed into 18 bits: bit 9 * alive + n is the next state
+// of a Cell with n alive neighbors, so applying the rule is a shift and a mask
+class Rule {
+    public:
+        constexpr Rule(uint16_t birth_mask, uint16_t survival_mask):
+            m_table((birth_mask & 0x1ffu) | (uint32_t{survival_mask} & 0x1ffu) << 9) {}
+        // "B36/S23", either half may come first, digits 0-8 in any order, case insensitive
+        // the bare "23/36" form lists survival then birth
+        static constexpr Rule parse(std::string_view rulestring);
+        constexpr bool nextState(bool alive, size_t alive_neighbors) const {
+            return (m_table >> (9 * alive + alive_neighbors)) & 1;
+        }
+        constexpr uint16_t birthMask() const { return m_table & 0x1ff; }
+        constexpr uint16_t survivalMask() const { return m_table >> 9; }
+        constexpr uint32_t table() const { return m_table; }
+        // dead Cells far from anything alive are born, which engines that only track alive Cells cannot follow
+        constexpr bool birthsFromNothing() const { return m_table & 1; }
+        std::string toString() const {
+            std::string text = "B";
+            for (size_t count = 0; count < 9; ++count) {
+                if (nextState(false, count)) {
+                    text += static_cast<char>('0' + count);
+                }
+            }
+            text += "/S";
+            for (size_t count = 0; count < 9; ++count) {
+                if (nextState(true, count)) {
+                    text += static_cast<char>('0' + count);
+                }
+            }
+            return text;
+        }
+        constexpr bool operator==(Rule other) const { return m_table == other.m_table; }
+        constexpr bool operator!=(Rule other) const { return m_table != other.m_table; }
+    private:
+        static constexpr uint16_t parseCounts(std::string_view digits) {
+            uint16_t mask = 0;
+            for (char digit: digits) {
+                if (digit < '0' || digit > '8') {
+                    throw std::runtime_error("Invalid neighbor count in rulestring");
+                }
+                mask |= uint16_t{1} << (digit - '0');
+            }
+            return mask;
+        }
+        uint32_t m_table;
+};
+
+constexpr Rule Rule::parse(std::string_view rulestring) {
+    size_t slash = rulestring.find('/');
+    if (slash == std::string_view::npos || rulestring.find('/', slash + 1) != std::string_view::npos) {
+        throw std::runtime_error("Rulestring must have the form B<counts>/S<counts>");
+    }
+    std::string_view halves[2] = {rulestring.substr(0, slash), rulestring.substr(slash + 1)};
+    auto is_letter = [](std::string_view half, char upper) {
+        return !half.empty() && (half[0] == upper || half[0] == upper - 'A' + 'a');
+    };
+    if (!is_letter(halves[0], 'B') && !is_letter(halves[0], 'S')
+            && !is_letter(halves[1], 'B') && !is_letter(halves[1], 'S')) {
+        return Rule(parseCounts(halves[1]), parseCounts(halves[0])); // survival/birth
+    }
+    uint16_t birth = 0;
+    uint16_t survival = 0;
+    bool seen_birth = false;
+    bool seen_survival = false;
+    for (std::string_view half: halves) {
+        if (is_letter(half, 'B') && !seen_birth) {
+            birth = parseCounts(half.substr(1));
+            seen_birth = true;
+        }
+        else if (is_letter(half, 'S') && !seen_survival) {
+            survival = parseCounts(half.substr(1));
+            seen_survival = true;
+        }
+        else {
+            throw std::runtime_error("Rulestring must have the form B<counts>/S<counts>");
+        }
+    }
+    return Rule(birth, survival);
+}
+
+inline constexpr Rule conway_life = Rule::parse("B3/S23");
+inline constexpr Rule high_life = Rule::parse("B36/S23");
+inline constexpr Rule seeds = Rule::parse("B2/S");
+inline constexpr Rule day_and_night = Rule::parse("B3678/S34678");
+inline constexpr Rule life_without_death = Rule::parse("B3/S012345678");
+
+// stands in for a table that is only known at run time
+inline constexpr uint32_t dynamic_rule_table = ~uint32_t{0};
+
+// calls visit(std::integral_constant<uint32_t, table>) with the table of a Rule as a compile time constant
+// when it is one of the named rules above, which get their own compiled kernels, or with dynamic_rule_table
+// takes the plain table so that the kernels compiled with instruction set flags call no member of Rule
+template <typename Visitor>
+decltype(auto) withRuleTable(uint32_t table, Visitor&& visit) {
+    switch (table) {
+        case conway_life.table():
+            return visit(std::integral_constant<uint32_t, conway_life.table()>{});
+        case high_life.table():
+            return visit(std::integral_constant<uint32_t, high_life.table()>{});
+        case seeds.table():
+            return visit(std::integral_constant<uint32_t, seeds.table()>{});
+        case day_and_night.table():
+            return visit(std::integral_constant<uint32_t, day_and_night.table()>{});
+        case life_without_death.table():
+            return visit(std::integral_constant<uint32_t, life_without_death.table()>{});
+        default:
+            return visit(std::integral_constant<uint32_t, dynamic_rule_table>{});
+    }
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef SORTED_UNIVERSE_HPP
+#define SORTED_UNIVERSE_HPP
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "universe.hpp"
+
+// keeps only the flat positions of alive Cells, as one sorted vector
+// a generation emits the 8 neighbor positions of every alive Cell, radix sorts them
+// and reads each position's alive neighbor count off the length of its run, no hashing involved
+class SortedUniverse: public Universe {
+    public:
+        SortedUniverse(size_t rows, size_t cols);
+        SortedUniverse(const std::filesystem::path& file_path);
+        using Universe::advance;
+        void advance() override;
+        bool isCellAlive(size_t row, size_t col) override;
+        // cheapest in row major order, anything else shifts the positions after it
+        void makeCellAlive(size_t row, size_t col) override;
+        void makeCellDead(size_t row, size_t col) override;
+        // appends, then sorts and merges once instead of inserting one by one
+        void insertAliveCells(const std::pair<size_t, size_t>* cells, size_t count) override;
+        void forEachAliveCell(CellVisitor visit) const override;
+        // binary searches the start of each row of rect
+        void forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const override;
+        // a plain copy, the positions are already kept sorted
+        void takeSnapshot(CellSnapshot& snapshot) const override;
+        // empties the vector instead of erasing one position at a time
+        void makeAllCellsDead() override;
+        void save(const std::filesystem::path& file_path) const override;
+        void load(const std::filesystem::path& file_path) override;
+        void setRule(Rule rule) override;
+    private:
+        static constexpr unsigned radix_bits = 11;
+        static constexpr size_t bucket_count = size_t{1} << radix_bits;
+        void emitNeighbors();
+        void radixSort();
+        void keepAlone(uint64_t flat_pos, bool survives_alone);
+        std::vector<uint64_t> m_alive_cells; // sorted flat positions
+        std::vector<uint64_t> m_next_alive_cells;
+        std::vector<uint64_t> m_neighbor_keys; // kept between generations to reuse their capacity
+        std::vector<uint64_t> m_sort_scratch;
+        std::vector<std::array<size_t, bucket_count>> m_histograms; // one per radix digit
+};
+
+#endif
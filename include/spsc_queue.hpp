@@ -0,0 +1,60 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// bounded lock-free queue between exactly one producer thread and one consumer thread
+// a ring of slots with a power of two capacity, the producer only writes m_tail and the consumer only m_head,
+// each on its own cache line, a release store of one publishes the slot to the acquire load of the other
+// elements are swapped in and out rather than copied: a pop leaves the consumer's old value in the slot and the
+// push that reuses the slot hands it back to the producer, so elements holding buffers recycle them
+template <typename T>
+class SpscQueue {
+    public:
+        explicit SpscQueue(size_t capacity): m_slots(roundUpPow2(capacity)), m_mask(m_slots.size() - 1) {}
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+        size_t capacity() const { return m_slots.size(); }
+        // producer only, value receives what the consumer left in the slot
+        // returns false and leaves value alone when the queue is full
+        bool tryPush(T& value) {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_head.load(std::memory_order_acquire) == m_slots.size()) {
+                return false;
+            }
+            std::swap(m_slots[tail & m_mask], value);
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+        // consumer only, returns false when the queue is empty
+        // value receives the element and the element's slot keeps what value held
+        bool tryPop(T& value) {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            std::swap(value, m_slots[head & m_mask]);
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+        // a snapshot that may be stale by the time it returns, exact only from a thread while the other is idle
+        size_t size() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+    private:
+        static size_t roundUpPow2(size_t capacity) {
+            size_t pow2 = 1;
+            while (pow2 < capacity) {
+                pow2 *= 2;
+            }
+            return pow2;
+        }
+        static constexpr size_t cache_line = 64;
+        std::vector<T> m_slots;
+        size_t m_mask;
+        alignas(cache_line) std::atomic<size_t> m_head{0}; // next slot to pop, counts up forever
+        alignas(cache_line) std::atomic<size_t> m_tail{0}; // next slot to push
+};
+
+#endif
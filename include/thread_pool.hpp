@@ -0,0 +1,36 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// persistent workers that split an index range into one contiguous band per thread
+// the calling thread works on band 0, so a pool of 1 thread spawns nothing
+class ThreadPool {
+    public:
+        using BandTask = std::function<void(size_t band, size_t begin, size_t end)>;
+        ThreadPool(size_t thread_count);
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ~ThreadPool();
+        size_t threadCount() const { return m_workers.size() + 1; }
+        // band b gets [count * b / threads, count * (b + 1) / threads), returns once every band is done
+        void parallelFor(size_t count, const BandTask& task);
+    private:
+        void workerLoop(size_t band);
+        void runBand(size_t band);
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_work_ready;
+        std::condition_variable m_work_done;
+        BandTask const* m_task{nullptr};
+        size_t m_count{0};
+        size_t m_round{0}; // bumped for every parallelFor so workers can tell new work apart
+        size_t m_pending{0};
+        bool m_stopping{false};
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef TILE_ACTIVITY_HPP
+#define TILE_ACTIVITY_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// change flags of a grid of tiles between generations, for dense engines that skip stable regions
+// a tile can only change if it or one of its 8 neighbors changed in the last generation
+// a tile that did not change holds the same cells in both buffers, so skipping it needs no copy
+class TileActivity {
+    public:
+        // every tile starts changed, so the first generation computes everything
+        void reset(size_t tile_rows, size_t tile_cols) {
+            m_tile_rows = tile_rows;
+            m_tile_cols = tile_cols;
+            m_changed.assign(tile_rows * tile_cols, 1);
+            m_next_changed.assign(tile_rows * tile_cols, 0);
+            m_row_changed.assign(tile_rows, 1);
+            m_next_row_changed.assign(tile_rows, 0);
+            m_unsettled.assign(tile_rows * tile_cols, 1);
+            m_row_unsettled.assign(tile_rows, 1);
+        }
+        size_t tileRows() const { return m_tile_rows; }
+        size_t tileCols() const { return m_tile_cols; }
+        bool isChanged(size_t tile_row, size_t tile_col) const { return m_changed[tile_row * m_tile_cols + tile_col]; }
+        // for cells set from outside advance(), the other buffer is stale for this tile now
+        void markChanged(size_t tile_row, size_t tile_col) {
+            m_changed[tile_row * m_tile_cols + tile_col] = 1;
+            m_row_changed[tile_row] = 1;
+            m_unsettled[tile_row * m_tile_cols + tile_col] = 1;
+            m_row_unsettled[tile_row] = 1;
+        }
+        void markAllChanged() {
+            m_changed.assign(m_changed.size(), 1);
+            m_row_changed.assign(m_row_changed.size(), 1);
+            m_unsettled.assign(m_unsettled.size(), 1);
+            m_row_unsettled.assign(m_row_unsettled.size(), 1);
+        }
+        // call before the tiles of a row, returns false when none of them can change
+        // and the row is then already done, so whole quiet rows cost O(1)
+        bool startTileRow(size_t tile_row) {
+            bool active = false;
+            for (size_t row = tile_row == 0 ? 0 : tile_row - 1; row <= tile_row + 1 && row < m_tile_rows; ++row) {
+                active = active || m_row_changed[row];
+            }
+            if (!active && m_next_row_changed[tile_row]) {
+                std::fill_n(m_next_changed.begin() + tile_row * m_tile_cols, m_tile_cols, 0);
+            }
+            m_next_row_changed[tile_row] = 0;
+            return active;
+        }
+        bool isActive(size_t tile_row, size_t tile_col) const {
+            for (size_t row = tile_row == 0 ? 0 : tile_row - 1; row <= tile_row + 1 && row < m_tile_rows; ++row) {
+                for (size_t col = tile_col == 0 ? 0 : tile_col - 1; col <= tile_col + 1 && col < m_tile_cols; ++col) {
+                    if (m_changed[row * m_tile_cols + col]) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+        // every tile of a started row must be set once per generation
+        // flags are bytes and a row belongs to one thread, so threads never share a write
+        void setNextChanged(size_t tile_row, size_t tile_col, bool changed) {
+            m_next_changed[tile_row * m_tile_cols + tile_col] = changed;
+            m_next_row_changed[tile_row] |= changed;
+            m_unsettled[tile_row * m_tile_cols + tile_col] |= changed;
+            m_row_unsettled[tile_row] |= changed;
+        }
+        void swap() {
+            m_changed.swap(m_next_changed);
+            m_row_changed.swap(m_next_row_changed);
+        }
+        // calls visit(tile_row, tile_col) for each tile changed since the last call, for engines that
+        // keep something per tile and only bring it up to date when asked, quiet tile rows cost O(1)
+        // const since the flags are only the engine's bookkeeping of what it already has
+        template <typename Visit>
+        void takeUnsettled(Visit&& visit) const {
+            for (size_t tile_row = 0; tile_row < m_tile_rows; ++tile_row) {
+                if (!m_row_unsettled[tile_row]) {
+                    continue;
+                }
+                m_row_unsettled[tile_row] = 0;
+                for (size_t tile_col = 0; tile_col < m_tile_cols; ++tile_col) {
+                    if (m_unsettled[tile_row * m_tile_cols + tile_col]) {
+                        m_unsettled[tile_row * m_tile_cols + tile_col] = 0;
+                        visit(tile_row, tile_col);
+                    }
+                }
+            }
+        }
+    private:
+        size_t m_tile_rows{0};
+        size_t m_tile_cols{0};
+        std::vector<uint8_t> m_changed; // changed in the last generation
+        std::vector<uint8_t> m_next_changed;
+        std::vector<uint8_t> m_row_changed; // any tile of the row changed
+        std::vector<uint8_t> m_next_row_changed;
+        mutable std::vector<uint8_t> m_unsettled; // changed since the last takeUnsettled
+        mutable std::vector<uint8_t> m_row_unsettled;
+};
+
+#endif
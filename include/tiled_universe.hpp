@@ -0,0 +1,68 @@
+#ifndef TILED_UNIVERSE_HPP
+#define TILED_UNIVERSE_HPP
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+#include "universe.hpp"
+
+// keeps only 64x64 tiles holding alive Cells in memory, each tile is a bitboard of 64 row words
+// only tiles that changed in the last generation and their neighbors are evaluated
+class TiledUniverse: public Universe {
+    public:
+        TiledUniverse(size_t rows, size_t cols);
+        TiledUniverse(const std::filesystem::path& file_path);
+        using Universe::advance;
+        void advance() override;
+        bool isCellAlive(size_t row, size_t col) override;
+        void makeCellAlive(size_t row, size_t col) override;
+        void makeCellDead(size_t row, size_t col) override;
+        void forEachAliveCell(CellVisitor visit) const override;
+        // looks up the tiles rect overlaps, or walks the tiles when there are fewer of them
+        void forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const override;
+        size_t countAliveIn(const CellRect& rect) const override;
+        // drops every tile
+        void makeAllCellsDead() override;
+        void save(const std::filesystem::path& file_path) const override;
+        void load(const std::filesystem::path& file_path) override;
+        void setRule(Rule rule) override;
+        size_t tileCount() const { return m_tiles.size(); }
+    private:
+        static constexpr size_t tile_size = 64;
+        struct Tile {
+            std::array<uint64_t, tile_size> rows{}; // bit i of a row word is column i of the tile
+            std::array<uint64_t, tile_size> next_rows{};
+            bool changed{false}; // already listed in m_changed_tiles
+            mutable AliveSummary summary; // as of the tile's last settling
+            mutable bool unsettled{false}; // already listed in m_unsettled_tiles
+        };
+        // next rows of a tile from rows -1..64 of its own column band and of the bands to the west and east
+        using TileStep = void (*)(uint64_t const* west, uint64_t const* center, uint64_t const* east,
+                uint64_t* next_rows, Rule rule);
+        void initTiles();
+        // re-sums the tiles changed since the last call, advance() only lists them
+        void settleSummary() const override;
+        static uint64_t tileKey(size_t tile_row, size_t tile_col) { return (uint64_t{tile_row} << 32) | tile_col; }
+        Tile* findTile(size_t tile_row, size_t tile_col);
+        Tile* findTile(uint64_t key);
+        // calls visit(top, left, tile, first_row, end_row, col_mask) for each tile rect overlaps,
+        // with the tile's rows and the bits of its row words that lie in rect
+        template <typename Visit>
+        void forEachTileIn(const CellRect& rect, Visit&& visit) const;
+        Tile& getOrMakeTile(uint64_t key);
+        bool computeNextRows(uint64_t key, std::array<uint64_t, tile_size>& next_rows);
+        void markChanged(uint64_t key, Tile& tile);
+        size_t m_tile_rows{0};
+        size_t m_tile_cols{0};
+        uint64_t m_last_col_mask{0}; // clears the columns past the Universe in the last tile column
+        size_t m_last_tile_row_count{0}; // Universe rows in the last tile row
+        std::unordered_map<uint64_t, Tile> m_tiles;
+        std::vector<uint64_t> m_changed_tiles; // tiles whose contents changed since they were last evaluated
+        mutable std::vector<uint64_t> m_unsettled_tiles; // tiles whose contents changed since they were last settled
+        TileStep m_tile_step{nullptr}; // compiled for the rule when it is a named one
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef TRAJECTORY_HPP
+#define TRAJECTORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "rule.hpp"
+#include "universe.hpp"
+
+// a recorded run, one record per generation, all fixed width fields little endian:
+//   header   magic "GoLTraj\0", u32 version, u32 rule table, u64 rows, u64 cols, u32 keyframe interval
+//   records  u8 kind, varint payload bytes, payload
+//            keyframe: varint population, then the sorted flat positions row * cols + col as varint gaps
+//            delta:    varint births, their gaps, varint deaths, their gaps, against the generation before
+//   index    u8 kind, u64 generation count, u64 keyframe count, per keyframe u64 generation and u64 file offset
+//   trailer  u64 file offset of the index, magic "GoLTIdx\0"
+// a delta costs bytes per changed Cell, so the file grows with activity rather than area
+// a generation is rebuilt from the keyframe at or before it, a run cut short without an index is scanned instead
+class TrajectoryWriter {
+    public:
+        // takes the size and rule of universe, records nothing yet
+        TrajectoryWriter(const std::filesystem::path& file_path, const Universe& universe, size_t keyframe_interval = 64);
+        // appends universe's current Cells as the next generation, the first call records generation 0
+        // a delta larger than the population it leads to is written as a keyframe instead
+        void record(const Universe& universe);
+        size_t generationCount() const { return m_generation_count; }
+        // writes the index and trailer, called by the destructor when not called before
+        void close();
+        ~TrajectoryWriter();
+    private:
+        void writeRecord(uint8_t kind, const std::string& payload);
+        std::ofstream m_file;
+        uint64_t m_offset{0};
+        size_t m_keyframe_interval;
+        size_t m_generation_count{0};
+        size_t m_since_keyframe{0};
+        std::vector<uint64_t> m_previous; // sorted flat positions of the last generation
+        CellSnapshot m_current;
+        std::vector<std::pair<uint64_t, uint64_t>> m_keyframes; // generation, file offset
+        bool m_closed{false};
+};
+
+class TrajectoryReader {
+    public:
+        explicit TrajectoryReader(const std::filesystem::path& file_path);
+        size_t rowCount() const { return m_rows; }
+        size_t colCount() const { return m_cols; }
+        Rule rule() const { return m_rule; }
+        size_t generationCount() const { return m_generation_count; }
+        size_t keyframeCount() const { return m_keyframes.size(); }
+        // sorted flat positions of the generation's alive Cells
+        // reading forward from the last generation asked for only applies the deltas in between
+        const std::vector<uint64_t>& flatPositionsAt(size_t generation);
+        // replaces the Cells of universe, which must have the recorded size, with those of the generation
+        void restore(size_t generation, Universe& universe);
+    private:
+        void buildIndex(uint64_t file_size);
+        // reads the record at m_next_offset into m_cells and moves past it
+        void applyNextRecord();
+        std::ifstream m_file;
+        size_t m_rows{0};
+        size_t m_cols{0};
+        Rule m_rule{conway_life};
+        size_t m_generation_count{0};
+        std::vector<std::pair<uint64_t, uint64_t>> m_keyframes;
+        uint64_t m_records_end{0};
+        std::vector<uint64_t> m_cells;
+        std::vector<uint64_t> m_scratch;
+        std::string m_payload;
+        size_t m_cells_generation{0};
+        uint64_t m_next_offset{0};
+        bool m_has_cells{false};
+};
+
+#endif
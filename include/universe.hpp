@@ -1,19 +1,203 @@
 #ifndef UNIVERSE_HPP
 #define UNIVERSE_HPP
 
+#include <algorithm>
+#include <array>
+#include <deque>
 #include <filesystem>
+#include <limits>
 #include <vector>
 #include <memory>
+#include <memory_resource>
 #include <set>
+#include <stdexcept>
 #include <unordered_map>
 #include <optional>
 
+#include "arena.hpp"
 #include "cell.hpp"
+#include "flat_hash.hpp"
+#include "function_ref.hpp"
+#include "rule.hpp"
+#include "thread_pool.hpp"
+#include "tile_activity.hpp"
+#include "universe_file.hpp"
+#include "universe_stats.hpp"
 
-struct UniverseFileData {
-    size_t rows;
-    size_t cols;
-    std::vector<std::pair<size_t, size_t>> alive_cells_pos;
+using CellVisitor = FunctionRef<void(size_t row, size_t col)>;
+
+struct MacrocellTree;
+
+// the Cells with top <= row < bottom and left <= col < right
+struct CellRect {
+    size_t top{0};
+    size_t left{0};
+    size_t bottom{0};
+    size_t right{0};
+    bool contains(size_t row, size_t col) const { return row >= top && row < bottom && col >= left && col < right; }
+    bool empty() const { return top >= bottom || left >= right; }
+    // saturates, a 2^32 by 2^32 rect would wrap to 0
+    size_t area() const {
+        if (empty()) {
+            return 0;
+        }
+        size_t height = bottom - top;
+        size_t width = right - left;
+        return height > std::numeric_limits<size_t>::max() / width ? std::numeric_limits<size_t>::max() : height * width;
+    }
+    // grows to hold Cell (row, col), an empty rect becomes just that Cell
+    void include(size_t row, size_t col) {
+        if (empty()) {
+            *this = {row, col, row + 1, col + 1};
+            return;
+        }
+        top = std::min(top, row);
+        left = std::min(left, col);
+        bottom = std::max(bottom, row + 1);
+        right = std::max(right, col + 1);
+    }
+    void include(const CellRect& other) {
+        if (!other.empty()) {
+            include(other.top, other.left);
+            include(other.bottom - 1, other.right - 1);
+        }
+    }
+};
+
+// exact for every Cell of a 2^32 x 2^32 Universe alive
+using CellSum = __int128;
+
+// base^(b << 8k) for each byte b of an exponent below 2^32
+using HashKeyPowers = std::array<std::array<uint64_t, 256>, 4>;
+
+constexpr HashKeyPowers makeHashKeyPowers(uint64_t base) {
+    HashKeyPowers powers{};
+    for (size_t k = 0; k < 4; ++k) {
+        powers[k][0] = 1;
+        for (size_t b = 1; b < 256; ++b) {
+            powers[k][b] = powers[k][b - 1] * base;
+        }
+        for (size_t step = 0; step < 8; ++step) {
+            base *= base;
+        }
+    }
+    return powers;
+}
+
+// odd bases of multiplicative order 2^62 mod 2^64, so no two Cells of a Universe share a key
+// sets of Cells can still share a sum: 1 - A^(2^k) is divisible by 2^(k + 2) for any odd A, so expanding a product
+// of a few such factors for rows and cols gives two sets of Cells whose keys add up to the same hash,
+// a hash match is therefore only taken for a repeat once CycleDetector compared the states themselves
+inline constexpr uint64_t row_hash_base = 0x9e3779b97f4a7c15ULL;
+inline constexpr uint64_t col_hash_base = 0x94d049bb133111ebULL;
+inline constexpr HashKeyPowers row_hash_powers = makeHashKeyPowers(row_hash_base);
+inline constexpr HashKeyPowers col_hash_powers = makeHashKeyPowers(col_hash_base);
+
+inline uint64_t hashKeyPower(const HashKeyPowers& powers, uint64_t exponent) {
+    return powers[0][exponent & 0xff] * powers[1][(exponent >> 8) & 0xff] * powers[2][(exponent >> 16) & 0xff]
+        * powers[3][(exponent >> 24) & 0xff];
+}
+
+inline uint64_t rowHashKey(size_t row) { return hashKeyPower(row_hash_powers, row); }
+inline uint64_t colHashKey(size_t col) { return hashKeyPower(col_hash_powers, col); }
+
+// the key of Cell (row, col) in the state hash, A^row * B^col mod 2^64, the hash of a set of Cells is the sum
+// of their keys, so births add and deaths subtract their keys, and moving a set by (rows, cols)
+// multiplies its hash by rowHashKey(rows) * colHashKey(cols), which lets HashLife compose it per node
+inline uint64_t cellHash(size_t row, size_t col) {
+    return rowHashKey(row) * colHashKey(col);
+}
+
+// the population, coordinate sums, bounds and state hash of a set of alive Cells
+struct AliveSummary {
+    size_t population{0};
+    CellSum row_sum{0};
+    CellSum col_sum{0};
+    CellRect bounds;
+    uint64_t hash{0}; // sum of the cellHash of each Cell
+    void add(size_t row, size_t col) {
+        population++;
+        row_sum += row;
+        col_sum += col;
+        bounds.include(row, col);
+        hash += cellHash(row, col);
+    }
+    // the set bits of bits are Cells col, col + 1, ... of row
+    void addWord(size_t row, size_t col, uint64_t bits);
+};
+
+// Cells that came alive and Cells that died, handed to Universe::applyChanges
+// engines that step on several threads fill one per thread
+struct AliveChanges {
+    AliveSummary births;
+    AliveSummary deaths;
+    void birth(size_t row, size_t col) { births.add(row, col); }
+    void death(size_t row, size_t col) { deaths.add(row, col); }
+};
+
+// visits the Cells of a range sorted by flat position row * cols + col that lie in rect, which must fit the Universe
+// lower_bound(from, flat_pos) skips the stretches of a row outside rect, so the cost is the Cells visited
+// plus one search per row of rect that holds alive Cells
+template <typename Iterator, typename LowerBound, typename FlatPos, typename Visit>
+void forEachSortedInRect(Iterator begin, Iterator end, const CellRect& rect, size_t cols, LowerBound&& lower_bound,
+        FlatPos&& flat_pos, Visit&& visit) {
+    if (rect.empty()) {
+        return;
+    }
+    Iterator it = lower_bound(begin, uint64_t{rect.top} * cols + rect.left);
+    while (it != end) {
+        uint64_t pos = flat_pos(*it);
+        size_t row = pos / cols;
+        size_t col = pos % cols;
+        if (row >= rect.bottom) {
+            return;
+        }
+        if (col < rect.left) {
+            it = lower_bound(it, uint64_t{row} * cols + rect.left);
+        }
+        else if (col >= rect.right) {
+            it = lower_bound(it, uint64_t{row + 1} * cols + rect.left);
+        }
+        else {
+            visit(row, col);
+            ++it;
+        }
+    }
+}
+
+// the alive Cells of one generation, copied out of an engine between generations
+// either as flat positions row * cols + col or, when words_per_row is set, as rows of 64 Cell words
+// so that the engine only pays for a copy and any decoding can happen later on another thread
+struct CellSnapshot {
+    size_t rows{0};
+    size_t cols{0};
+    std::vector<uint64_t> flat_positions;
+    size_t words_per_row{0};
+    std::vector<uint64_t> words;
+    // decodes words if there are any, then sorts the flat positions
+    void normalize();
+};
+
+// one generation's alive Cells as CycleDetector keeps them to confirm that a state hash match is a repeat
+struct StateCopy {
+    CellSnapshot cells; // what takeSnapshot gives, normalized only once compared
+    // set instead of cells by engines whose equal states are one and the same object, compared by address
+    std::shared_ptr<const void> identity;
+    // normalizes the cells of both copies
+    bool sameState(StateCopy& other);
+};
+
+// how Universe::advanceDetectingCycles ended, or what CycleDetector found
+struct StabilityReport {
+    bool stabilized{false}; // the alive Cells repeated those of an earlier generation
+    uint64_t generation{0}; // the first generation of the repeating states
+    uint64_t period{0}; // 1 for a still life or an empty Universe
+};
+
+// what advanceDetectingCycles does once the states repeat
+enum class CycleAction {
+    fast_forward, // steps only what is left of the run modulo the period
+    stop, // returns right away
 };
 
 // defines the interface for a Universe of Cells
@@ -22,64 +206,252 @@ class Universe {
         Universe(size_t rows, size_t cols);
         Universe(const std::filesystem::path& file_path);
         virtual void advance() = 0;
+        // advances generations at once, the default calls advance() that many times
+        // engines that can share work between generations override it
+        virtual void advance(size_t generations);
         virtual bool isCellAlive(size_t row, size_t col) = 0;
         virtual void makeCellAlive(size_t row, size_t col) = 0;
         virtual void makeCellDead(size_t row, size_t col) = 0;
-        virtual std::vector<std::pair<size_t, size_t>> getAliveCellsPos() const = 0;
+        // visits every alive Cell once, in an order of the engine's choosing, without materializing them
+        virtual void forEachAliveCell(CellVisitor visit) const = 0;
+        virtual std::vector<std::pair<size_t, size_t>> getAliveCellsPos() const;
+        // visits every alive Cell inside rect once, parts of rect outside the Universe are ignored
+        // the default filters forEachAliveCell, engines override it so that the cost follows the rect
+        virtual void forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const;
+        // the default counts what forEachAliveCellIn visits
+        virtual size_t countAliveIn(const CellRect& rect) const;
+        // replaces the contents of snapshot, reusing its buffers, with no formatting or I/O
+        // the default visits every alive Cell, engines that can copy their storage as it is override it
+        virtual void takeSnapshot(CellSnapshot& snapshot) const;
+        // makes count Cells alive at once, engines that pay per insertion override it
+        virtual void insertAliveCells(const std::pair<size_t, size_t>* cells, size_t count);
+        // makes the Cells of the tree alive with its top left corner on Cell (0, 0)
+        // throws if an alive Cell of the tree lies outside the Universe
+        virtual void insertMacrocell(const MacrocellTree& tree);
+        // makes every Cell dead, the default kills the alive Cells one at a time,
+        // engines that can drop their storage at once override it
+        virtual void makeAllCellsDead();
         virtual void save(const std::filesystem::path& file_path) const;
+        // the default takes a snapshot, engines with canonical states keep an identity instead
+        virtual void copyState(StateCopy& copy) const;
+        // the binary .univ format, constructors and load() tell the formats apart on their own
+        void saveBinary(const std::filesystem::path& file_path) const;
         virtual void load(const std::filesystem::path& file_path) = 0;
         size_t rowCount() const { return m_rows; }
         size_t colCount() const { return m_cols; }
+        // engines that can split advance() across threads use this many, 1 runs serially
+        void setThreadCount(size_t thread_count);
+        size_t threadCount() const { return m_thread_pool ? m_thread_pool->threadCount() : 1; }
+        // the Life-like rule applied by advance(), B3/S23 unless set
+        virtual void setRule(Rule rule);
+        Rule rule() const { return m_rule; }
+        // records a GenerationStats per advance() of the engines with hooks: the dense and sparse Universes
+        // needs a build with GOL_STATS, throws otherwise, disabling drops what was recorded
+        void setStatsEnabled(bool enabled);
+        bool statsEnabled() const { return m_stats != nullptr; }
+        // empty unless enabled
+        const std::vector<GenerationStats>& generationStats() const;
+        // the alive Cells at a glance, kept current by advance() and the edits, or by re-summing only
+        // the tiles that changed on the grid engines, instead of counted over every Cell on demand
+        virtual size_t population() const {
+            settleSummary();
+            return m_population;
+        }
+        // a 64-bit hash of the alive Cells, the sum of their cellHash, kept current along with population()
+        virtual uint64_t stateHash() const {
+            settleSummary();
+            return m_hash;
+        }
+        // generations advanced since construction, including the ones a fast-forward skipped
+        uint64_t generation() const { return m_generation; }
+        // advances generations one at a time while a CycleDetector watches for a repeated state,
+        // once one turns up the rest of the run is known, so only what on_cycle asks for is stepped
+        StabilityReport advanceDetectingCycles(size_t generations, CycleAction on_cycle = CycleAction::fast_forward);
+        // mean row and col of the alive Cells, (0, 0) when there are none
+        virtual std::pair<double, double> centroid() const;
+        // the smallest rect holding every alive Cell, empty when there are none
+        // a death on its edge leaves the kept bounds loose, the next call pulls that edge in with countAliveIn
+        // one strip at a time, so it costs a few strips per generation rather than a pass over the alive Cells
+        virtual CellRect boundingBox() const;
         virtual ~Universe() {};
     protected:
+        // the engines report every Cell that comes alive or dies, through these or applyChanges
+        void noteBirth(size_t row, size_t col) {
+            m_population++;
+            m_row_sum += row;
+            m_col_sum += col;
+            m_bounds.include(row, col);
+            m_hash += cellHash(row, col);
+        }
+        void noteDeath(size_t row, size_t col) {
+            m_population--;
+            m_row_sum -= row;
+            m_col_sum -= col;
+            m_hash -= cellHash(row, col);
+            m_bounds_loose = m_bounds_loose || onBoundsEdge(CellRect{row, col, row + 1, col + 1});
+            if (m_population == 0) {
+                m_bounds = {};
+                m_bounds_loose = false;
+            }
+        }
+        // const so that settleSummary can call it
+        void applyChanges(const AliveChanges& changes) const;
+        // starts the summary over from forEachAliveCell, for loads and bulk inserts that bypass the notes
+        void recountAlive();
+        // empties the summary, for engines that drop their cells along with the summaries they settled
+        void clearSummary();
+        // engines that leave the summary behind during advance() catch it up here, the accessors call it first
+        // so it must cost next to nothing when nothing changed since the last call
+        virtual void settleSummary() const {}
+        // pulls the edges of bounds, which holds every alive Cell, in to the alive Cells
+        // the default probes one row or col strip of bounds at a time with countAliveIn
+        virtual void tightenBounds(CellRect& bounds) const;
+        // the bounds from one pass over the alive Cells, for engines whose strip queries cost more than that
+        CellRect scanBounds() const;
+        // the record of the generation advance() is about to compute, null when not recording
+        GenerationStats* beginGenerationStats() { return m_stats ? &m_stats->beginGeneration() : nullptr; }
+        // the record beginGenerationStats returned last, null when not recording
+        GenerationStats* currentGenerationStats() { return m_stats ? m_stats->current() : nullptr; }
+        uint64_t statsNowNs() const { return m_stats->nowNs(); }
+        // rect cut down to the Universe
+        CellRect clampRect(const CellRect& rect) const;
+        // engines that only visit the neighborhood of alive Cells call this from setRule
+        static void rejectBirthsFromNothing(Rule rule);
         UniverseFileData parseFile(const std::filesystem::path& file_path);
-        std::array<std::optional<std::pair<size_t, size_t>>, 8>& getNeighborsPos(size_t row, size_t col);
+        // fills and returns the caller's array so that each thread can bring its own
+        std::array<std::optional<std::pair<size_t, size_t>>, 8>& getNeighborsPos(size_t row, size_t col,
+                std::array<std::optional<std::pair<size_t, size_t>>, 8>& neighbor_pos) const;
         size_t m_rows;
         size_t m_cols;
-        std::array<std::optional<std::pair<size_t, size_t>>, 8> m_neighbor_pos;
-        std::array<std::optional<Cell*>, 8> m_neighbors;
+        std::unique_ptr<ThreadPool> m_thread_pool; // null when serial
+        Rule m_rule{conway_life};
+        std::unique_ptr<StatsRecorder> m_stats; // null when not recording
+        uint64_t m_generation{0}; // every advance() adds the generations it steps
+    private:
+        // whether rect, which lies in m_bounds, reaches one of its edges
+        bool onBoundsEdge(const CellRect& rect) const {
+            return rect.top == m_bounds.top || rect.left == m_bounds.left || rect.bottom == m_bounds.bottom
+                || rect.right == m_bounds.right;
+        }
+        // mutable for settleSummary
+        mutable size_t m_population{0};
+        mutable CellSum m_row_sum{0};
+        mutable CellSum m_col_sum{0};
+        mutable uint64_t m_hash{0};
+        mutable CellRect m_bounds; // holds every alive Cell, possibly with empty edges while loose
+        mutable bool m_bounds_loose{false};
+};
+
+// remembers the state hashes of the last history_size generations it was shown, so it finds any period
+// up to that long, each with a StateCopy that a hash match is compared against before it counts as a repeat
+// so the history holds up to history_size snapshots of the alive Cells, or HashLife roots
+class CycleDetector {
+    public:
+        static constexpr size_t default_history_size = 1024;
+        explicit CycleDetector(size_t history_size = default_history_size): m_recent(history_size) {
+            if (history_size == 0) {
+                throw std::runtime_error("A cycle detector needs room for at least one generation");
+            }
+        }
+        // call once per generation, stabilized once the universe repeats a state still in the table
+        // the Universe must not be edited between calls, or the repeat says nothing about the future
+        StabilityReport observe(const Universe& universe);
+        void clear();
+    private:
+        struct Entry {
+            uint64_t hash{0};
+            uint64_t generation{0};
+            StateCopy state;
+        };
+        // state hash to the observation number of the latest state with it, colliding states keep the latest
+        FlatHashMap<uint64_t> m_seen;
+        std::vector<Entry> m_recent; // a ring in observation order
+        StateCopy m_current; // the state being observed, swapped into the ring to reuse the buffers
+        size_t m_observed{0};
+};
+
+// what lies past the edges of a dense Universe
+enum class Topology {
+    bounded, // dead Cells forever
+    torus, // the opposite edge
 };
 
-// keeps all Cells in memory
+// keeps all Cells in memory, each grid is one contiguous block with a ghost border of Cells around it
+// so the stencil reads all 8 neighbors of every Cell without bounds checks
+// the ghost border stays dead, or is refreshed from the opposite edges on a torus
+// only tiles near a change in the last generation are recomputed
 class DenseUniverse: public Universe {
     public:
         DenseUniverse(size_t rows, size_t cols);
         DenseUniverse(const std::filesystem::path& file_path);
+        using Universe::advance;
         void advance() override;
         bool isCellAlive(size_t row, size_t col) override;
         void makeCellAlive(size_t row, size_t col) override;
         void makeCellDead(size_t row, size_t col) override;
-        std::vector<std::pair<size_t, size_t>> getAliveCellsPos() const override;
+        void forEachAliveCell(CellVisitor visit) const override;
+        void forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const override;
+        // one pass over the grid, with every tile flagged so that the summary settles to empty
+        void makeAllCellsDead() override;
         void save(const std::filesystem::path& file_path) const override;
         void load(const std::filesystem::path& file_path) override;
+        void setRule(Rule rule) override;
+        void setTopology(Topology topology);
+        Topology topology() const { return m_topology; }
     protected:
+        static constexpr size_t tile_size = 16;
         virtual void initCells() = 0;
-        virtual std::array<std::optional<Cell*>, 8>& getNeighbors(const Cell& cell) = 0;
+        void initTiles();
+        // re-sums the tiles changed since the last call, advance() only flags them
+        void settleSummary() const override;
+        // band is the thread pool's band, whose slot of m_band_counts receives the counts in a GOL_STATS build
+        void advanceTileRows(size_t begin_tile_row, size_t end_tile_row, size_t band);
+        // returns whether any Cell of the rectangle changed, counts are only added to in a GOL_STATS build
+        bool advanceRect(size_t begin_row, size_t end_row, size_t begin_col, size_t end_col, StepCounts& counts);
+        void finishStats(GenerationStats& stats, uint64_t stencil_start_ns, uint64_t activity_start_ns,
+                uint64_t swap_start_ns);
+        // copies the edge Cells of the current grid into the ghost border on the opposite side
+        void wrapGhostBorder();
+        // an edge tile that changed wakes the tiles across the opposite edge
+        void wrapActivity();
+        // Cells per grid row including the ghost Cell on either side
+        size_t rowStride() const { return m_cols + 2; }
+        // the padded grids, the ghost corner above and left of Cell (0, 0) comes first
+        virtual Cell* getCurrentGrid() = 0;
+        virtual Cell const* getCurrentGrid() const = 0;
+        virtual Cell* getNextGrid() = 0;
         virtual Cell* getCurrentGridCell(size_t row, size_t col) = 0;
         virtual Cell const* getCurrentGridCell(size_t row, size_t col) const = 0;
         virtual Cell* getNextGridCell(size_t row, size_t col) = 0;
         bool m_grid_1_is_current{true};
+        TileActivity m_activity;
+        Topology m_topology{Topology::bounded};
+        std::vector<StepCounts> m_band_counts; // per thread, only filled in a GOL_STATS build
+        mutable std::vector<AliveSummary> m_tile_summaries; // as of each tile's last settling
 };
 
 class DenseUniverseV1: public DenseUniverse {
     public:
         DenseUniverseV1(size_t rows, size_t cols);
         DenseUniverseV1(const std::filesystem::path& file_path);
+        using Universe::advance;
         void advance() override;
         bool isCellAlive(size_t row, size_t col) override;
         void makeCellAlive(size_t row, size_t col) override;
         void makeCellDead(size_t row, size_t col) override;
-        std::vector<std::pair<size_t, size_t>> getAliveCellsPos() const override;
+        void forEachAliveCell(CellVisitor visit) const override;
         void save(const std::filesystem::path& file_path) const override;
         void load(const std::filesystem::path& file_path) override;
     private:
         void initCells() override;
-        std::array<std::optional<Cell*>, 8>& getNeighbors(const Cell& cell) override;
+        Cell* getCurrentGrid() override;
+        Cell const* getCurrentGrid() const override;
+        Cell* getNextGrid() override;
         Cell* getCurrentGridCell(size_t row, size_t col) override;
         Cell const* getCurrentGridCell(size_t row, size_t col) const override;
         Cell* getNextGridCell(size_t row, size_t col) override;
-        std::vector<std::vector<Cell>> m_cell_grid_1;
-        std::vector<std::vector<Cell>> m_cell_grid_2;
+        std::vector<Cell> m_cell_grid_1;
+        std::vector<Cell> m_cell_grid_2;
 };
 
 // keeps only alive Cells in memory
@@ -87,15 +459,30 @@ class SparseUniverse: public Universe {
     public:
         SparseUniverse(size_t rows, size_t cols);
         SparseUniverse(const std::filesystem::path& file_path);
+        using Universe::advance;
         virtual void advance() override;
         virtual bool isCellAlive(size_t row, size_t col) override;
         virtual void makeCellAlive(size_t row, size_t col) override;
         virtual void makeCellDead(size_t row, size_t col) override;
-        std::vector<std::pair<size_t, size_t>> getAliveCellsPos() const = 0;
         void save(const std::filesystem::path& file_path) const;
         void load(const std::filesystem::path& file_path);
+        // drops the current buffer at once, resetting its arenas
+        void makeAllCellsDead() override;
+        // Cells of each buffer come from that buffer's arena, disabling it uses the heap, for comparisons
+        void setArenasEnabled(bool enabled);
+        bool arenasEnabled() const { return m_arenas.front().enabled(); }
+        void setRule(Rule rule) override;
     protected:
+        // below this many alive cells the thread handoff costs more than it saves
+        static constexpr size_t min_parallel_population = 4096;
+        void advanceParallel();
+        bool bandsBalanced(size_t band_count) const;
+        void finishStats(GenerationStats& stats, uint64_t population, uint64_t swap_start_ns);
         virtual std::vector<Cell*> getAliveCells() = 0;
+        virtual void forEachCurrentCell(FunctionRef<void(Cell& cell)> visit) = 0;
+        virtual void forEachCurrentCellInBand(size_t band, FunctionRef<void(Cell& cell)> visit) = 0;
+        virtual size_t currentBandSize(size_t band) const = 0;
+        virtual size_t aliveCellCount() const = 0;
         virtual Cell* findAliveCellByPos(size_t row, size_t col) = 0;
         virtual void makeAndInsertNextAliveCell(size_t row, size_t col) = 0;
         virtual void makeAndInsertAliveCell(size_t row, size_t col) = 0;
@@ -103,46 +490,84 @@ class SparseUniverse: public Universe {
         virtual void swapBuffers() = 0;
         virtual void clearBuffer() = 0;
         virtual void clearNextBuffer() = 0;
+        // drops everything in a side of the double buffer, resets its arenas and starts it empty again
+        virtual void resetBuffer(size_t side) = 0;
+        // each side is split into bands of rows, each with its own container and arena, so that
+        // advanceParallel fills the bands of the next generation on their own threads
+        // band b holds the rows from m_band_starts[side][b - 1] up to m_band_starts[side][b]
+        size_t bandCount(size_t side) const { return m_band_starts[side].size() + 1; }
+        size_t bandOf(size_t side, size_t row) const {
+            const std::vector<size_t>& starts = m_band_starts[side];
+            return starts.empty() ? 0 : std::upper_bound(starts.begin(), starts.end(), row) - starts.begin();
+        }
+        // only once the band's container on that side is gone
+        std::pmr::memory_resource* resetBandArena(size_t side, size_t band);
+        std::deque<PingPongArena> m_arenas = std::deque<PingPongArena>(1); // one per band, outlives the buffers
+        std::array<std::vector<size_t>, 2> m_band_starts; // none, so a single band, until a parallel step
+        size_t m_current_side{0}; // side of the double buffer holding the current generation
+        // alive neighbor counts of frontier cells, kept between generations to reuse their capacity
+        FlatHashMap<uint8_t> m_frontier_hit_count;
+        std::vector<std::vector<FlatHashMap<uint8_t>>> m_frontier_shards; // [band][owner band]
 };
 
 class SparseUniverseV1: public SparseUniverse {
     public:
         SparseUniverseV1(size_t rows, size_t cols);
         SparseUniverseV1(const std::filesystem::path& file_path);
+        ~SparseUniverseV1() override;
+        using Universe::advance;
         void advance() override;
         bool isCellAlive(size_t row, size_t col) override;
         void makeCellAlive(size_t row, size_t col) override;
         void makeCellDead(size_t row, size_t col) override;
-        std::vector<std::pair<size_t, size_t>> getAliveCellsPos() const override;
+        void forEachAliveCell(CellVisitor visit) const override;
+        void forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const override;
         void save(const std::filesystem::path& file_path) const override;
         void load(const std::filesystem::path& file_path) override;
     private:
+        using CellSet = std::pmr::set<Cell*, CellFlatPosLess>; // the Cells and the tree nodes share the arena
         std::vector<Cell*> getAliveCells() override;
+        void forEachCurrentCell(FunctionRef<void(Cell& cell)> visit) override;
+        void forEachCurrentCellInBand(size_t band, FunctionRef<void(Cell& cell)> visit) override;
+        size_t currentBandSize(size_t band) const override;
+        size_t aliveCellCount() const override;
         Cell* findAliveCellByPos(size_t row, size_t col) override;
-        std::set<std::unique_ptr<Cell>>::iterator findAliveCellIterByPos(size_t row, size_t col);
         void makeAndInsertNextAliveCell(size_t row, size_t col) override;
         void makeAndInsertAliveCell(size_t row, size_t col) override;
+        void insertCell(CellSet& cells, size_t row, size_t col);
+        void freeCells(CellSet& cells);
         void deleteCell(size_t row, size_t col) override;
         void swapBuffers() override;
         void clearBuffer() override;
         void clearNextBuffer() override;
-        std::set<std::unique_ptr<Cell>> m_alive_cells;
-        std::set<std::unique_ptr<Cell>> m_next_alive_cells;
+        void resetBuffer(size_t side) override;
+        CellSet& aliveCells(size_t row) { return m_cell_sets[m_current_side][bandOf(m_current_side, row)]; }
+        CellSet& nextAliveCells(size_t row) { return m_cell_sets[1 - m_current_side][bandOf(1 - m_current_side, row)]; }
+        // one set per band, each on its band's arena, rebuilt by resetBuffer
+        // bands follow each other in row order, so their sets do in flat position order
+        std::array<std::vector<CellSet>, 2> m_cell_sets;
 };
 
 class SparseUniverseV2: public SparseUniverse {
     public:
         SparseUniverseV2(size_t rows, size_t cols);
         SparseUniverseV2(const std::filesystem::path& file_path);
+        using Universe::advance;
         void advance() override;
         bool isCellAlive(size_t row, size_t col) override;
         void makeCellAlive(size_t row, size_t col) override;
         void makeCellDead(size_t row, size_t col) override;
-        std::vector<std::pair<size_t, size_t>> getAliveCellsPos() const override;
+        void forEachAliveCell(CellVisitor visit) const override;
+        void forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const override;
         void save(const std::filesystem::path& file_path) const override;
         void load(const std::filesystem::path& file_path) override;
     private:
+        void tightenBounds(CellRect& bounds) const override;
         std::vector<Cell*> getAliveCells() override;
+        void forEachCurrentCell(FunctionRef<void(Cell& cell)> visit) override;
+        void forEachCurrentCellInBand(size_t band, FunctionRef<void(Cell& cell)> visit) override;
+        size_t currentBandSize(size_t band) const override;
+        size_t aliveCellCount() const override;
         Cell* findAliveCellByPos(size_t row, size_t col) override;
         void makeAndInsertNextAliveCell(size_t row, size_t col) override;
         void makeAndInsertAliveCell(size_t row, size_t col) override;
@@ -150,8 +575,40 @@ class SparseUniverseV2: public SparseUniverse {
         void swapBuffers() override;
         void clearBuffer() override;
         void clearNextBuffer() override;
-        std::unordered_map<size_t, Cell> m_alive_cells;
-        std::unordered_map<size_t, Cell> m_next_alive_cells;
+        void resetBuffer(size_t side) override;
+        using CellMap = std::pmr::unordered_map<size_t, Cell>;
+        CellMap& aliveCells(size_t row) { return m_cell_maps[m_current_side][bandOf(m_current_side, row)]; }
+        const CellMap& aliveCells(size_t row) const {
+            return m_cell_maps[m_current_side][bandOf(m_current_side, row)];
+        }
+        CellMap& nextAliveCells(size_t row) { return m_cell_maps[1 - m_current_side][bandOf(1 - m_current_side, row)]; }
+        // one map per band, each on its band's arena, rebuilt by resetBuffer
+        std::array<std::vector<CellMap>, 2> m_cell_maps;
+};
+
+// keeps only the positions of alive Cells, as (row << 32) | col keys in flat open addressing tables
+// both buffers keep their capacity across generations, so a steady population stops allocating
+class SparseUniverseV3: public Universe {
+    public:
+        SparseUniverseV3(size_t rows, size_t cols);
+        SparseUniverseV3(const std::filesystem::path& file_path);
+        using Universe::advance;
+        void advance() override;
+        bool isCellAlive(size_t row, size_t col) override;
+        void makeCellAlive(size_t row, size_t col) override;
+        void makeCellDead(size_t row, size_t col) override;
+        void forEachAliveCell(CellVisitor visit) const override;
+        void forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const override;
+        void makeAllCellsDead() override;
+        void save(const std::filesystem::path& file_path) const override;
+        void load(const std::filesystem::path& file_path) override;
+        void setRule(Rule rule) override;
+    private:
+        static uint64_t cellKey(size_t row, size_t col) { return (uint64_t{row} << 32) | col; }
+        void tightenBounds(CellRect& bounds) const override;
+        FlatHashSet m_alive_cells;
+        FlatHashSet m_next_alive_cells;
+        FlatHashMap<uint8_t> m_frontier_hit_count;
 };
 
 template <size_t Rows, size_t Cols>
@@ -159,22 +616,25 @@ class DenseUniverseV2: public DenseUniverse {
     public:
         DenseUniverseV2();
         DenseUniverseV2(const std::filesystem::path& file_path);
+        using Universe::advance;
         void advance() override;
         bool isCellAlive(size_t row, size_t col) override;
         void makeCellAlive(size_t row, size_t col) override;
         void makeCellDead(size_t row, size_t col) override;
-        // the only dynamic alloc part
-        std::vector<std::pair<size_t, size_t>> getAliveCellsPos() const override;
+        void forEachAliveCell(CellVisitor visit) const override;
         void save(const std::filesystem::path& file_path) const override;
         void load(const std::filesystem::path& file_path) override;
     private:
+        static constexpr size_t padded_cell_count = (Rows + 2) * (Cols + 2);
         void initCells() override;
-        std::array<std::optional<Cell*>, 8>& getNeighbors(const Cell& cell) override;
+        Cell* getCurrentGrid() override;
+        Cell const* getCurrentGrid() const override;
+        Cell* getNextGrid() override;
         Cell* getCurrentGridCell(size_t row, size_t col) override;
         Cell const* getCurrentGridCell(size_t row, size_t col) const override;
         Cell* getNextGridCell(size_t row, size_t col) override;
-        std::array<std::array<Cell, Cols>, Rows> m_cell_grid_1;
-        std::array<std::array<Cell, Cols>, Rows> m_cell_grid_2;
+        std::array<Cell, padded_cell_count> m_cell_grid_1;
+        std::array<Cell, padded_cell_count> m_cell_grid_2;
 };
 
 // no dynamic allocation in this universe
@@ -186,6 +646,9 @@ DenseUniverseV2<Rows, Cols>::DenseUniverseV2(): DenseUniverse(Rows, Cols) {
 template <size_t Rows, size_t Cols>
 DenseUniverseV2<Rows, Cols>::DenseUniverseV2(const std::filesystem::path& file_path): DenseUniverse(file_path) {
     auto fdata = Universe::parseFile(file_path);
+    if (fdata.rows > Rows || fdata.cols > Cols) {
+        throw std::runtime_error("Universe file does not fit the grid");
+    }
     m_rows = fdata.rows;
     m_cols = fdata.cols;
     initCells();
@@ -196,32 +659,44 @@ DenseUniverseV2<Rows, Cols>::DenseUniverseV2(const std::filesystem::path& file_p
 
 template <size_t Rows, size_t Cols>
 void DenseUniverseV2<Rows, Cols>::initCells() {
+    size_t stride = rowStride();
     for (size_t row = 0; row < m_rows; ++row) {
         for (size_t col = 0; col < m_cols; ++col) {
-            m_cell_grid_1[row][col] = Cell(row, col, m_cols * row + col, false);
-            m_cell_grid_2[row][col] = Cell(row, col, m_cols * row + col, false);
+            m_cell_grid_1[(row + 1) * stride + col + 1] = Cell(row, col, m_cols * row + col, false);
+            m_cell_grid_2[(row + 1) * stride + col + 1] = Cell(row, col, m_cols * row + col, false);
         }
     }
+    initTiles();
 }
 
 template <size_t Rows, size_t Cols>
-Cell* DenseUniverseV2<Rows, Cols>::getCurrentGridCell(size_t row, size_t col) {
-    return m_grid_1_is_current ? &m_cell_grid_1[row][col] : &m_cell_grid_2[row][col];
+Cell* DenseUniverseV2<Rows, Cols>::getCurrentGrid() {
+    return m_grid_1_is_current ? m_cell_grid_1.data() : m_cell_grid_2.data();
 }
 
 template <size_t Rows, size_t Cols>
-Cell const* DenseUniverseV2<Rows, Cols>::getCurrentGridCell(size_t row, size_t col) const {
-    return m_grid_1_is_current ? &m_cell_grid_1[row][col] : &m_cell_grid_2[row][col];
+Cell const* DenseUniverseV2<Rows, Cols>::getCurrentGrid() const {
+    return m_grid_1_is_current ? m_cell_grid_1.data() : m_cell_grid_2.data();
 }
 
 template <size_t Rows, size_t Cols>
-Cell* DenseUniverseV2<Rows, Cols>::getNextGridCell(size_t row, size_t col) {
-    return m_grid_1_is_current ? &m_cell_grid_2[row][col] : &m_cell_grid_1[row][col];
+Cell* DenseUniverseV2<Rows, Cols>::getNextGrid() {
+    return m_grid_1_is_current ? m_cell_grid_2.data() : m_cell_grid_1.data();
+}
+
+template <size_t Rows, size_t Cols>
+Cell* DenseUniverseV2<Rows, Cols>::getCurrentGridCell(size_t row, size_t col) {
+    return getCurrentGrid() + (row + 1) * rowStride() + col + 1;
 }
 
 template <size_t Rows, size_t Cols>
-std::array<std::optional<Cell*>, 8>& DenseUniverseV2<Rows, Cols>::getNeighbors(const Cell& cell) {
-    return DenseUniverse::getNeighbors(cell);
+Cell const* DenseUniverseV2<Rows, Cols>::getCurrentGridCell(size_t row, size_t col) const {
+    return getCurrentGrid() + (row + 1) * rowStride() + col + 1;
+}
+
+template <size_t Rows, size_t Cols>
+Cell* DenseUniverseV2<Rows, Cols>::getNextGridCell(size_t row, size_t col) {
+    return getNextGrid() + (row + 1) * rowStride() + col + 1;
 }
 
 template <size_t Rows, size_t Cols>
@@ -245,8 +720,8 @@ void DenseUniverseV2<Rows, Cols>::advance() {
 }
 
 template <size_t Rows, size_t Cols>
-std::vector<std::pair<size_t, size_t>> DenseUniverseV2<Rows, Cols>::getAliveCellsPos() const {
-    return DenseUniverse::getAliveCellsPos();
+void DenseUniverseV2<Rows, Cols>::forEachAliveCell(CellVisitor visit) const {
+    DenseUniverse::forEachAliveCell(visit);
 }
 
 template <size_t Rows, size_t Cols>
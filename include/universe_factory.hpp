@@ -0,0 +1,18 @@
+#ifndef UNIVERSE_FACTORY_HPP
+#define UNIVERSE_FACTORY_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "universe.hpp"
+
+// engine is a class name, e.g. "BitUniverse", rulestring is parsed by Rule::parse
+// the engine picks its kernels for the rule once here, never per cell
+// throws on an unknown engine, a malformed rulestring or a rule the engine cannot run
+std::unique_ptr<Universe> makeUniverse(const std::string& engine, size_t rows, size_t cols,
+        const std::string& rulestring = "B3/S23");
+// engines makeUniverse knows, DenseUniverseV2 is sized at compile time so it is not one of them
+std::vector<std::string> universeEngineNames();
+
+#endif
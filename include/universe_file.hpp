@@ -0,0 +1,39 @@
+#ifndef UNIVERSE_FILE_HPP
+#define UNIVERSE_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+struct UniverseFileData {
+    size_t rows;
+    size_t cols;
+    std::vector<std::pair<size_t, size_t>> alive_cells_pos;
+};
+
+// both formats use the .univ extension and are told apart by their first bytes
+// text: "GameOfLifeUniverse", rows, cols and the population on their own lines, then one "row,col" line per alive Cell
+// binary, version 2, all fixed width fields little endian:
+//   header      magic "GoLUniv\0", u32 version, u32 chunk count, u64 rows, u64 cols, u64 population
+//   chunk table per chunk: u64 payload offset from the end of the table, u64 payload bytes, u64 cells
+//   payloads    the sorted flat positions row * cols + col of the chunk's Cells as LEB128 varints,
+//               the first one absolute and every other one the gap to its predecessor
+// chunks decode independently, so a large file is parsed by several threads
+enum class UniverseFormat {
+    text,
+    binary,
+};
+
+// throws if the file cannot be opened or is neither format
+UniverseFormat detectUniverseFormat(const std::filesystem::path& file_path);
+// either format, binary chunks are decoded on the pool when there is one
+UniverseFileData readUniverseFile(const std::filesystem::path& file_path, ThreadPool* pool = nullptr);
+// flat_positions must be sorted and unique, chunk_cells of them go into each chunk
+void writeBinaryUniverseFile(const std::filesystem::path& file_path, size_t rows, size_t cols,
+        const std::vector<uint64_t>& flat_positions, size_t chunk_cells = size_t{1} << 16);
+
+#endif
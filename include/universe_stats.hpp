@@ -0,0 +1,72 @@
+#ifndef UNIVERSE_STATS_HPP
+#define UNIVERSE_STATS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// per generation counters from inside the engines' advance()
+// the hooks are compiled in only when GOL_STATS is defined, which the GOL_ENABLE_STATS CMake option does,
+// otherwise GOL_STATS_ONLY drops its arguments and the hot paths are the same code as without stats
+#ifdef GOL_STATS
+#define GOL_STATS_ONLY(...) __VA_ARGS__
+inline constexpr bool stats_compiled = true;
+#else
+#define GOL_STATS_ONLY(...)
+inline constexpr bool stats_compiled = false;
+#endif
+
+struct GenerationStats {
+    uint64_t generation{0}; // counted from when recording started
+    uint64_t live_cells{0}; // after the generation
+    uint64_t births{0};
+    uint64_t deaths{0};
+    // dead Cells next to alive ones for the sparse engines, Cells of the recomputed tiles for the dense ones
+    uint64_t frontier_cells{0};
+    uint64_t lookups{0}; // alive Cells looked up by position
+    uint64_t allocations{0}; // Cells allocated into the next buffer, or hash table growths
+    uint64_t start_ns{0}; // since recording started
+    uint64_t neighbor_ns{0}; // counting the neighbors of alive Cells, or running the stencil
+    uint64_t frontier_ns{0}; // births from the frontier, or tile activity bookkeeping
+    uint64_t swap_ns{0}; // swapping the buffers
+};
+
+// births, deaths and Cells visited by one thread of a dense step, summed once the step is done
+struct StepCounts {
+    uint64_t births{0};
+    uint64_t deaths{0};
+    uint64_t cells{0};
+    StepCounts& operator+=(const StepCounts& other) {
+        births += other.births;
+        deaths += other.deaths;
+        cells += other.cells;
+        return *this;
+    }
+};
+
+class StatsRecorder {
+    public:
+        StatsRecorder(): m_origin(std::chrono::steady_clock::now()) {}
+        // appends the record of the next generation, with its start time
+        GenerationStats& beginGeneration();
+        uint64_t nowNs() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_origin)
+                .count();
+        }
+        GenerationStats* current() { return m_generations.empty() ? nullptr : &m_generations.back(); }
+        const std::vector<GenerationStats>& generations() const { return m_generations; }
+    private:
+        std::chrono::steady_clock::time_point m_origin;
+        std::vector<GenerationStats> m_generations;
+};
+
+// one row per generation with a header row
+void writeStatsCsv(const std::filesystem::path& file_path, const std::vector<GenerationStats>& stats);
+// an array of one object per generation
+void writeStatsJson(const std::filesystem::path& file_path, const std::vector<GenerationStats>& stats);
+// the Trace Event Format read by chrome://tracing and Perfetto: each phase as a complete event
+// laid out back to back from the generation's start, and the counters as counter events
+void writeStatsChromeTrace(const std::filesystem::path& file_path, const std::vector<GenerationStats>& stats);
+
+#endif
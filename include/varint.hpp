@@ -0,0 +1,46 @@
+#ifndef VARINT_HPP
+#define VARINT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// byte helpers shared by the binary file formats, fixed width fields are little endian
+// and variable width ones are LEB128, 7 bits per byte with the high bit set on all but the last
+
+inline uint64_t loadLittleEndian(const char* bytes, size_t width) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; ++i) {
+        value |= uint64_t{static_cast<uint8_t>(bytes[i])} << (8 * i);
+    }
+    return value;
+}
+
+inline void storeLittleEndian(std::string& bytes, uint64_t value, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        bytes.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+inline void storeVarint(std::string& bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<char>(value));
+}
+
+// returns false when the bytes run out first
+inline bool loadVarint(const char*& cursor, const char* end, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && cursor != end; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*cursor++);
+        value |= uint64_t{byte & 0x7fu} << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
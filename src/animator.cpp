@@ -1,11 +1,90 @@
+#include <algorithm>
 #include <thread>
 
 #include "animator.hpp"
 #include "painter.hpp"
 #include "universe.hpp"
 
-Animator::Animator(std::chrono::milliseconds refresh_period):
-    m_refresh_period(refresh_period), m_painter(GridPainter()) {}
+namespace {
+
+// how long either thread sleeps when the queue is full or empty before looking again
+constexpr std::chrono::milliseconds poll_period{1};
+
+}
+
+Animator::Animator(std::chrono::milliseconds refresh_period, size_t queue_depth, int fd):
+    m_refresh_period(refresh_period), m_painter(fd), m_frames(queue_depth) {}
+
+// Frames come out of the queue in generation order, one per refresh period or slower when the simulation is
+void Animator::animate(Universe* universe, size_t time_steps) {
+    m_stopping = false;
+    m_simulation_done = false;
+    m_simulation_error = nullptr;
+    m_max_queued = 0;
+    m_painter.clear();
+    std::thread simulation(&Animator::simulate, this, universe, time_steps);
+    try {
+        Frame frame;
+        auto next_refresh = std::chrono::steady_clock::now();
+        for (size_t drawn = 0; drawn < time_steps; ++drawn) {
+            m_max_queued = std::max(m_max_queued, m_frames.size());
+            while (!m_frames.tryPop(frame)) {
+                // the simulation stops early only when it failed, a last Frame may have arrived meanwhile
+                if (m_simulation_done.load(std::memory_order_acquire) && !m_frames.tryPop(frame)) {
+                    drawn = time_steps;
+                    break;
+                }
+                std::this_thread::sleep_for(poll_period);
+            }
+            if (drawn == time_steps) {
+                break;
+            }
+            drawFrame(frame);
+            m_painter.present(); // only the cells that changed since the last frame
+            next_refresh += m_refresh_period;
+            auto now = std::chrono::steady_clock::now();
+            if (next_refresh < now) {
+                next_refresh = now; // behind, so the next Frame goes out when it is ready rather than in a burst
+            }
+            std::this_thread::sleep_until(next_refresh);
+        }
+    }
+    catch (...) {
+        m_stopping = true;
+        simulation.join();
+        throw;
+    }
+    simulation.join();
+    m_painter.moveBelowFrame();
+    if (m_simulation_error) {
+        std::rethrow_exception(m_simulation_error);
+    }
+}
+
+// frame changes hands with the queue slot, so it comes back holding a Frame the drawing thread is done with
+void Animator::simulate(Universe* universe, size_t time_steps) {
+    try {
+        Frame frame;
+        for (size_t generation = 0; generation < time_steps && !m_stopping; ++generation) {
+            frame.generation = generation;
+            frame.universe_rows = universe->rowCount();
+            frame.universe_cols = universe->colCount();
+            frame.cells.clear();
+            makeFrame(*universe, frame);
+            while (!m_frames.tryPush(frame)) {
+                if (m_stopping) {
+                    break;
+                }
+                std::this_thread::sleep_for(poll_period);
+            }
+            universe->advance();
+        }
+    }
+    catch (...) {
+        m_simulation_error = std::current_exception();
+    }
+    m_simulation_done.store(true, std::memory_order_release);
+}
 
 void Animator::printRowOffset(size_t offset, Color color) {
     std::string row_offset_str = std::to_string(offset);
@@ -53,142 +132,88 @@ void Animator::paintBottomMargin(size_t start_row, size_t col_count, size_t thic
     }
 }
 
-FullViewAnimator::FullViewAnimator(std::chrono::milliseconds refresh_period): Animator(refresh_period) {}
+FullViewAnimator::FullViewAnimator(std::chrono::milliseconds refresh_period, size_t queue_depth, int fd):
+    Animator(refresh_period, queue_depth, fd) {}
 
-void FullViewAnimator::animate(Universe* universe, size_t time_steps) {
-    size_t max_row = 0;
-    size_t max_col = 0;
-    size_t margin_thickness = 1;
+void FullViewAnimator::makeFrame(const Universe& universe, Frame& frame) {
+    CellRect bounds = universe.boundingBox();
+    frame.top_row = 0; // row, col offset is always zero
+    frame.left_col = 0;
+    frame.bottom_row = bounds.empty() ? 0 : bounds.bottom - 1;
+    frame.right_col = bounds.empty() ? 0 : bounds.right - 1;
+    universe.forEachAliveCell([&](size_t row, size_t col) { frame.cells.push_back({row, col}); });
+}
 
-    m_painter.clear();
-    for (size_t i = 0; i < time_steps; ++i) {
-        max_row = 0;
-        max_col = 0;
-        for (const auto& [row, col]: universe->getAliveCellsPos()) {
-            max_row = std::max(row, max_row);
-            max_col = std::max(col, max_col);
-        }
-        paintLeftMargin(max_row + 1 + margin_thickness, margin_thickness, Color::red);
-        paintTopMargin(max_col + 1 + margin_thickness, margin_thickness, Color::red);
-        printRowOffset(0); // row, col offset is always zero
-        printColOffset(0);
-        for (const auto& [row, col]: universe->getAliveCellsPos()) {
-            m_painter.paint(row + margin_thickness, col + margin_thickness, "█", Color::green); // add margins
-        }
-        std::this_thread::sleep_for(m_refresh_period);
-        universe->advance();
-        m_painter.shiftCursor(max_row + margin_thickness, max_col + margin_thickness); // since clear is from current cursor pos up, track max row col
-        m_painter.clear();
+void FullViewAnimator::drawFrame(const Frame& frame) {
+    size_t margin_thickness = 1;
+    paintLeftMargin(frame.bottom_row + 1 + margin_thickness, margin_thickness, Color::red);
+    paintTopMargin(frame.right_col + 1 + margin_thickness, margin_thickness, Color::red);
+    printRowOffset(0);
+    printColOffset(0);
+    for (const auto& [row, col]: frame.cells) {
+        m_painter.paint(row + margin_thickness, col + margin_thickness, "█", Color::green); // add margins
     }
-    m_painter.shiftCursor(max_row + margin_thickness, max_col + margin_thickness);
-    m_painter.clear();
-    m_painter.shiftCursor(max_row + margin_thickness + 1, 0);
 }
 
 
-AutoPanAnimator::AutoPanAnimator(std::chrono::milliseconds refresh_period): Animator(refresh_period) {}
+AutoPanAnimator::AutoPanAnimator(std::chrono::milliseconds refresh_period, size_t queue_depth, int fd):
+    Animator(refresh_period, queue_depth, fd) {}
 
-// simplest auto-pan is to create a bounding box around alive cells and translate to top left
-void AutoPanAnimator::animate(Universe* universe, size_t time_steps) {
-    size_t max_row = 0;
-    size_t max_col = 0;
-    size_t margin_thickness = 1;
-    int64_t min_row = universe->rowCount();
-    int64_t min_col = universe->colCount();
+// simplest auto-pan is to take the bounding box around alive cells and translate to top left
+void AutoPanAnimator::makeFrame(const Universe& universe, Frame& frame) {
+    CellRect bounds = universe.boundingBox();
+    if (bounds.empty()) {
+        frame.top_row = frame.left_col = frame.bottom_row = frame.right_col = 0;
+        return;
+    }
+    frame.top_row = bounds.top;
+    frame.left_col = bounds.left;
+    frame.bottom_row = bounds.bottom - 1;
+    frame.right_col = bounds.right - 1;
+    universe.forEachAliveCell([&](size_t row, size_t col) {
+        frame.cells.push_back({row - bounds.top, col - bounds.left});
+    });
+}
 
-    m_painter.clear();
-    for (size_t i = 0; i < time_steps; ++i) {
-        max_row = 0;
-        max_col = 0;
-        min_row = universe->rowCount();
-        min_col = universe->colCount();
-        std::vector<std::pair<size_t, size_t>> alive_cells_pos = universe->getAliveCellsPos();
-        for (const auto& [row, col]: alive_cells_pos) {
-            min_row = std::min(static_cast<int64_t>(row), min_row); // safe cast: max pos 2**32
-            max_row = std::max(row, max_row);
-            min_col = std::min(static_cast<int64_t>(col), min_col); // safe cast: max pos 2**32
-            max_col = std::max(col, max_col);
-        }
-        paintLeftMargin(max_row - min_row + 1 + margin_thickness, margin_thickness, min_col == 0 ? Color::red : Color::blue);
-        paintTopMargin(max_col - min_col + 1 + margin_thickness, margin_thickness, min_row == 0 ? Color::red : Color::blue);
-        printRowOffset(min_row);
-        printColOffset(min_col);
-        for (const auto& [row, col]: alive_cells_pos) {
-            size_t cell_row = row - min_row + margin_thickness;
-            size_t cell_col = col - min_col + margin_thickness;
-            m_painter.paint(cell_row, cell_col, "█", Color::green); // translate to top left with a margin
-        }
-        std::this_thread::sleep_for(m_refresh_period);
-        universe->advance();
-        m_painter.shiftCursor(max_row - min_row + margin_thickness, max_col - min_col + margin_thickness);
-        m_painter.clear();
+void AutoPanAnimator::drawFrame(const Frame& frame) {
+    size_t margin_thickness = 1;
+    paintLeftMargin(frame.bottom_row - frame.top_row + 1 + margin_thickness, margin_thickness,
+            frame.left_col == 0 ? Color::red : Color::blue);
+    paintTopMargin(frame.right_col - frame.left_col + 1 + margin_thickness, margin_thickness,
+            frame.top_row == 0 ? Color::red : Color::blue);
+    printRowOffset(frame.top_row);
+    printColOffset(frame.left_col);
+    for (const auto& [row, col]: frame.cells) {
+        m_painter.paint(row + margin_thickness, col + margin_thickness, "█", Color::green); // translate to top left with a margin
     }
-    m_painter.shiftCursor(max_row - min_row + margin_thickness, max_col - min_col + margin_thickness);
-    m_painter.clear();
-    m_painter.shiftCursor(max_row - min_row + 1, 0);
 }
 
 
 // Calculates mid-point of live-cells and centers the viewport on it
-CenterAutoPanAnimator::CenterAutoPanAnimator(std::chrono::milliseconds refresh_period): Animator(refresh_period) {}
+CenterAutoPanAnimator::CenterAutoPanAnimator(std::chrono::milliseconds refresh_period, size_t queue_depth, int fd):
+    Animator(refresh_period, queue_depth, fd) {}
+
+void CenterAutoPanAnimator::makeFrame(const Universe& universe, Frame& frame) {
+    auto [mid_row, mid_col] = universe.centroid();
+    frame.top_row = std::max(0.0, mid_row - viewport_rows / 2);
+    frame.bottom_row = std::min(static_cast<double>(universe.rowCount()) - 1, mid_row + viewport_rows / 2);
+    frame.left_col = std::max(0.0, mid_col - viewport_cols / 2);
+    frame.right_col = std::min(static_cast<double>(universe.colCount()) - 1, mid_col + viewport_cols / 2);
+    CellRect viewport{frame.top_row, frame.left_col, frame.bottom_row + 1, frame.right_col + 1};
+    universe.forEachAliveCellIn(viewport, [&](size_t row, size_t col) {
+        frame.cells.push_back({row - frame.top_row, col - frame.left_col});
+    });
+}
 
-void CenterAutoPanAnimator::animate(Universe* universe, size_t time_steps) {
-    size_t max_row = 0;
-    size_t max_col = 0;
+void CenterAutoPanAnimator::drawFrame(const Frame& frame) {
     size_t margin_thickness = 1;
-    int64_t min_row = universe->rowCount();
-    int64_t min_col = universe->colCount();
-    size_t row_count = universe->rowCount();
-    size_t col_count = universe->colCount();
-    size_t viewport_rows = 40;
-    size_t viewport_cols = 40;
-
-    m_painter.clear();
-    for (size_t i = 0; i < time_steps; ++i) {
-        max_row = 0;
-        max_col = 0;
-        min_row = row_count;
-        min_col = col_count;
-        std::vector<std::pair<size_t, size_t>> alive_cells_pos = universe->getAliveCellsPos();
-        double mid_row = 0.0;
-        double mid_col = 0.0;
-        for (const auto& [row, col]: alive_cells_pos) {
-            mid_row += row;
-            mid_col += col;
-            min_row = std::min(static_cast<int64_t>(row), min_row); // safe cast: max pos 2**32
-            max_row = std::max(row, max_row);
-            min_col = std::min(static_cast<int64_t>(col), min_col); // safe cast: max pos 2**32
-            max_col = std::max(col, max_col);
-        }
-        mid_row /= alive_cells_pos.size();
-        mid_col /= alive_cells_pos.size();
-        size_t viewport_top_row = std::max(0.0, mid_row - viewport_rows / 2);
-        size_t viewport_bot_row = std::min(static_cast<double>(universe->rowCount()) - 1, mid_row + viewport_rows / 2);
-        size_t viewport_left_col = std::max(0.0, mid_col - viewport_cols / 2);
-        size_t viewport_right_col = std::min(static_cast<double>(universe->colCount()) - 1, mid_col + viewport_cols / 2);
-        paintLeftMargin(viewport_rows + margin_thickness, margin_thickness, viewport_left_col == 0 ? Color::red : Color::blue);
-        paintTopMargin(viewport_cols + 2 * margin_thickness, margin_thickness, viewport_top_row == 0 ? Color::red : Color::blue);
-        paintRightMargin(viewport_cols + 2 * margin_thickness, viewport_rows + 2 * margin_thickness, margin_thickness, viewport_right_col == col_count - 1 ? Color::red : Color::blue);
-        paintBottomMargin(viewport_rows + margin_thickness, viewport_cols + 2 * margin_thickness, margin_thickness, viewport_bot_row == row_count - 1 ? Color::red : Color::blue);
-        printRowOffset(viewport_top_row);
-        printColOffset(viewport_left_col);
-        for (const auto& [row, col]: alive_cells_pos) {
-            if (row < viewport_top_row || row > viewport_bot_row) {
-                continue;
-            }
-            if (col < viewport_left_col || col > viewport_right_col) {
-                continue;
-            }
-            size_t cell_row = row - viewport_top_row + margin_thickness;
-            size_t cell_col = col - viewport_left_col + margin_thickness;
-            m_painter.paint(cell_row, cell_col, "█", Color::green); // translate to top left with a margin
-        }
-        std::this_thread::sleep_for(m_refresh_period);
-        universe->advance();
-        m_painter.shiftCursor(max_row - viewport_top_row + margin_thickness, max_col - viewport_left_col + margin_thickness);
-        m_painter.clear();
+    paintLeftMargin(viewport_rows + margin_thickness, margin_thickness, frame.left_col == 0 ? Color::red : Color::blue);
+    paintTopMargin(viewport_cols + 2 * margin_thickness, margin_thickness, frame.top_row == 0 ? Color::red : Color::blue);
+    paintRightMargin(viewport_cols + 2 * margin_thickness, viewport_rows + 2 * margin_thickness, margin_thickness, frame.right_col == frame.universe_cols - 1 ? Color::red : Color::blue);
+    paintBottomMargin(viewport_rows + margin_thickness, viewport_cols + 2 * margin_thickness, margin_thickness, frame.bottom_row == frame.universe_rows - 1 ? Color::red : Color::blue);
+    printRowOffset(frame.top_row);
+    printColOffset(frame.left_col);
+    for (const auto& [row, col]: frame.cells) {
+        m_painter.paint(row + margin_thickness, col + margin_thickness, "█", Color::green); // translate to top left with a margin
     }
-    m_painter.shiftCursor(viewport_rows + margin_thickness, viewport_cols + margin_thickness);
-    m_painter.clear();
-    m_painter.shiftCursor(viewport_rows + margin_thickness + 1, 0);
 }
@@ -0,0 +1,44 @@
+#include <algorithm>
+
+#include "arena.hpp"
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    if (!m_chunks.empty()) {
+        Chunk& chunk = m_chunks.back();
+        void* ptr = chunk.data.get() + m_used;
+        size_t space = chunk.size - m_used;
+        if (std::align(alignment, bytes, ptr, space)) {
+            m_used = chunk.size - space + bytes;
+            return ptr;
+        }
+    }
+    size_t size = std::max({min_chunk_size, bytes + alignment, m_chunks.empty() ? 0 : 2 * m_chunks.back().size});
+    m_chunks.push_back({std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+    m_used = 0;
+    return do_allocate(bytes, alignment);
+}
+
+void Arena::reset() {
+    if (m_chunks.size() > 1) {
+        size_t size = bytesReserved();
+        m_chunks.clear();
+        m_chunks.push_back({std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+    }
+    m_used = 0;
+}
+
+size_t Arena::bytesReserved() const {
+    size_t size = 0;
+    for (const Chunk& chunk: m_chunks) {
+        size += chunk.size;
+    }
+    return size;
+}
+
+std::pmr::memory_resource* PingPongArena::resource(size_t side) {
+    return m_enabled ? static_cast<std::pmr::memory_resource*>(&m_arenas[side]) : std::pmr::new_delete_resource();
+}
+
+void PingPongArena::reset(size_t side) {
+    m_arenas[side].reset();
+}
@@ -0,0 +1,467 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+#include "bench_suite.hpp"
+#include "pattern_io.hpp"
+#include "sorted_universe.hpp"
+#include "universe.hpp"
+#include "universe_factory.hpp"
+#include "universe_file.hpp"
+
+namespace {
+
+// DenseUniverseV2 fixes its size at compile time, so it only runs at the sizes instantiated here
+bool runsAtSize(const std::string& engine, size_t size) {
+    return engine != "DenseUniverseV2" || size == 128 || size == 256 || size == 512 || size == 1024;
+}
+
+std::unique_ptr<Universe> makeBenchUniverse(const std::string& engine, size_t size) {
+    if (engine != "DenseUniverseV2") {
+        return makeUniverse(engine, size, size);
+    }
+    switch (size) {
+        case 128: return std::make_unique<DenseUniverseV2<128, 128>>();
+        case 256: return std::make_unique<DenseUniverseV2<256, 256>>();
+        case 512: return std::make_unique<DenseUniverseV2<512, 512>>();
+        case 1024: return std::make_unique<DenseUniverseV2<1024, 1024>>();
+        default: throw std::runtime_error("DenseUniverseV2 is not instantiated at size " + std::to_string(size));
+    }
+}
+
+struct Scenario {
+    std::string name;
+    double density{0.0}; // a soup when above 0
+    std::vector<std::pair<size_t, size_t>> cells; // a pattern otherwise, offsets from the top left corner
+    double placement{0.5}; // where the pattern's corner sits, as a fraction of the Universe's side
+};
+
+std::vector<std::pair<size_t, size_t>> rleCells(const std::string& rle) {
+    std::istringstream header(rle);
+    PatternInfo info = peekRle(header);
+    SortedUniverse pattern(info.rows, info.cols);
+    std::istringstream in(rle);
+    readRle(in, pattern);
+    return pattern.getAliveCellsPos();
+}
+
+std::vector<Scenario> makeScenarios(const BenchSuiteOptions& options) {
+    std::vector<Scenario> scenarios;
+    for (double density: options.densities) {
+        scenarios.push_back({"soup-" + std::to_string(static_cast<int>(std::lround(100 * density))) + "%", density, {}, 0.5});
+    }
+    // methuselahs grow from a few Cells into a busy region before they settle
+    scenarios.push_back({"r-pentomino", 0.0, rleCells("x = 3, y = 3\nb2o$2o$bo!"), 0.5});
+    scenarios.push_back({"acorn", 0.0, rleCells("x = 7, y = 3\nbo5b$3bo3b$2o2b3o!"), 0.5});
+    // Max, a small spacefiller, grows at c/2 in every direction and fills the area behind it at a steady density
+    scenarios.push_back({"spacefiller", 0.0, rleCells("x = 27, y = 27\n"
+        "18bo$17b3o$12b3o4b2o$11bo2b3o2bob2o$10bo3bobo2bobo$10bo4bobobobob2o$12bo4bobo3b2o$"
+        "4o5bobo4bo3bob3o$o3b2obob3ob2o9b2o$o5b2o5bo$bo2b2obo2bo2bob2o$7bobobobobobo5b4o$"
+        "bo2b2obo2bo2bo2b2obob2o3bo$o5b2o3bobobo3b2o5bo$o3b2obob2o2bo2bo2bob2o2bo$4o5bobobobobobo$"
+        "10b2obo2bo2bob2o2bo$13bo5b2o5bo$b2o9b2ob3obob2o3bo$2b3obo3bo4bobo5b4o$2b2o3bobo4bo$"
+        "2b2obobobobo4bo$5bobo2bobo3bo$4b2obo2b3o2bo$6b2o4b3o$7b3o$8bo!"), 0.5});
+    // a gun keeps a small active core and a growing stream of gliders
+    if (!options.pattern_directory.empty()) {
+        UniverseFileData gun = readUniverseFile(options.pattern_directory / "gosper_glider.univ");
+        scenarios.push_back({"gosper-gun", 0.0, gun.alive_cells_pos, 0.0});
+    }
+    return scenarios;
+}
+
+void seedScenario(Universe* universe, const Scenario& scenario) {
+    size_t size = universe->rowCount();
+    if (scenario.density > 0.0) {
+        std::mt19937 rng(42);
+        std::bernoulli_distribution coin(scenario.density);
+        for (size_t row = 0; row < size; ++row) {
+            for (size_t col = 0; col < size; ++col) {
+                if (coin(rng)) {
+                    universe->makeCellAlive(row, col);
+                }
+            }
+        }
+        return;
+    }
+    size_t offset = static_cast<size_t>(scenario.placement * size);
+    for (const auto& [row, col]: scenario.cells) {
+        if (offset + row < size && offset + col < size) {
+            universe->makeCellAlive(offset + row, offset + col);
+        }
+    }
+}
+
+struct Repetition {
+    size_t generations;
+    double seconds;
+    double mean_population;
+    size_t population;
+    size_t heap_bytes;
+};
+
+// generations 0 means run until min_seconds have passed
+Repetition runRepetition(const std::string& engine, size_t size, const Scenario& scenario, size_t generations,
+        double min_seconds, HeapBytesFn heap_bytes) {
+    size_t heap_before = heap_bytes();
+    std::unique_ptr<Universe> universe = makeBenchUniverse(engine, size);
+    seedScenario(universe.get(), scenario);
+    universe->advance(); // engines that skip quiet tiles start with every tile marked changed
+    size_t done = 0;
+    double seconds = 0.0;
+    double population_sum = 0.0;
+    // only advance() is timed, settling the population afterwards costs the dense engines a pass over changed tiles
+    while (generations == 0 ? done == 0 || seconds < min_seconds : done < generations) {
+        auto start = std::chrono::steady_clock::now();
+        universe->advance();
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++done;
+        population_sum += universe->population();
+    }
+    size_t population = universe->population();
+    return {done, seconds, population_sum / done, population, heap_bytes() - heap_before};
+}
+
+BenchResult runScenario(const std::string& engine, size_t size, const Scenario& scenario,
+        const BenchSuiteOptions& options, HeapBytesFn heap_bytes) {
+    BenchResult result{engine, scenario.name, size};
+    std::vector<double> rates;
+    double live_cells_per_sec = 0.0;
+    for (size_t i = 0; i < options.repetitions; ++i) {
+        Repetition repetition = runRepetition(engine, size, scenario, result.generations, options.min_seconds, heap_bytes);
+        result.generations = repetition.generations;
+        rates.push_back(repetition.generations / repetition.seconds);
+        live_cells_per_sec += repetition.mean_population * rates.back();
+        result.population = repetition.population;
+        result.bytes_per_live_cell = repetition.population == 0 ? 0.0
+            : static_cast<double>(repetition.heap_bytes) / repetition.population;
+    }
+    result.repetitions = rates.size();
+    for (double rate: rates) {
+        result.gen_per_sec += rate / rates.size();
+    }
+    for (double rate: rates) {
+        result.gen_per_sec_stddev += (rate - result.gen_per_sec) * (rate - result.gen_per_sec);
+    }
+    result.gen_per_sec_stddev = rates.size() > 1 ? std::sqrt(result.gen_per_sec_stddev / (rates.size() - 1)) : 0.0;
+    result.live_cells_per_sec = live_cells_per_sec / rates.size();
+    return result;
+}
+
+void printResultHeader() {
+    std::cout << "          engine     scenario   size    gens       gen/s    +-%   live cells/s  B/live cell\n";
+}
+
+void printResult(const BenchResult& result) {
+    std::cout << std::setw(16) << result.engine << std::setw(13) << result.scenario << std::setw(7) << result.size
+        << std::setw(8) << result.generations << std::setprecision(4) << std::setw(12) << result.gen_per_sec
+        << std::setw(7) << std::setprecision(2) << 100 * result.gen_per_sec_stddev / result.gen_per_sec
+        << std::setprecision(4) << std::setw(15) << result.live_cells_per_sec
+        << std::setw(13) << result.bytes_per_live_cell << '\n';
+}
+
+// a JSON reader for the files written below: objects, arrays, strings, numbers and literals
+struct JsonValue {
+    enum class Kind { null, boolean, number, string, array, object };
+    Kind kind{Kind::null};
+    double number{0.0};
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+    const JsonValue& at(std::string_view key) const {
+        for (const auto& [name, value]: members) {
+            if (name == key) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Missing JSON member " + std::string(key));
+    }
+};
+
+class JsonParser {
+    public:
+        explicit JsonParser(std::string_view text): m_text(text) {}
+        JsonValue parseDocument() {
+            JsonValue value = parseValue();
+            skipSpace();
+            if (m_pos != m_text.size()) {
+                fail();
+            }
+            return value;
+        }
+    private:
+        [[noreturn]] void fail() const {
+            throw std::runtime_error("Invalid JSON at offset " + std::to_string(m_pos));
+        }
+        void skipSpace() {
+            while (m_pos < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_pos]))) {
+                ++m_pos;
+            }
+        }
+        void expect(char c) {
+            skipSpace();
+            if (m_pos >= m_text.size() || m_text[m_pos] != c) {
+                fail();
+            }
+            ++m_pos;
+        }
+        bool consume(char c) {
+            skipSpace();
+            if (m_pos < m_text.size() && m_text[m_pos] == c) {
+                ++m_pos;
+                return true;
+            }
+            return false;
+        }
+        std::string parseString() {
+            expect('"');
+            std::string text;
+            while (m_pos < m_text.size() && m_text[m_pos] != '"') {
+                char c = m_text[m_pos++];
+                if (c == '\\') {
+                    if (m_pos >= m_text.size()) {
+                        fail();
+                    }
+                    c = m_text[m_pos++];
+                    c = c == 'n' ? '\n' : c == 't' ? '\t' : c; // \", \\ and \/ stand for themselves
+                }
+                text += c;
+            }
+            expect('"');
+            return text;
+        }
+        JsonValue parseValue() {
+            skipSpace();
+            if (m_pos >= m_text.size()) {
+                fail();
+            }
+            JsonValue value;
+            char c = m_text[m_pos];
+            if (c == '{') {
+                value.kind = JsonValue::Kind::object;
+                ++m_pos;
+                if (!consume('}')) {
+                    do {
+                        std::string name = parseString();
+                        expect(':');
+                        value.members.push_back({name, parseValue()});
+                    } while (consume(','));
+                    expect('}');
+                }
+            }
+            else if (c == '[') {
+                value.kind = JsonValue::Kind::array;
+                ++m_pos;
+                if (!consume(']')) {
+                    do {
+                        value.items.push_back(parseValue());
+                    } while (consume(','));
+                    expect(']');
+                }
+            }
+            else if (c == '"') {
+                value.kind = JsonValue::Kind::string;
+                value.text = parseString();
+            }
+            else if (m_text.substr(m_pos, 4) == "true" || m_text.substr(m_pos, 5) == "false") {
+                value.kind = JsonValue::Kind::boolean;
+                value.number = c == 't';
+                m_pos += c == 't' ? 4 : 5;
+            }
+            else if (m_text.substr(m_pos, 4) == "null") {
+                m_pos += 4;
+            }
+            else {
+                value.kind = JsonValue::Kind::number;
+                std::string number(m_text.substr(m_pos, 32));
+                size_t length = 0;
+                try {
+                    value.number = std::stod(number, &length);
+                }
+                catch (const std::logic_error&) {
+                    fail();
+                }
+                m_pos += length;
+            }
+            return value;
+        }
+        std::string_view m_text;
+        size_t m_pos{0};
+};
+
+std::string resultKey(const BenchResult& result) {
+    return result.engine + " " + result.scenario + " " + std::to_string(result.size);
+}
+
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    for (std::string item; std::getline(stream, item, ',');) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+}
+
+std::vector<BenchResult> runBenchSuite(const BenchSuiteOptions& options, HeapBytesFn heap_bytes) {
+    std::vector<std::string> engines = options.engines;
+    if (engines.empty()) {
+        engines = universeEngineNames();
+        engines.insert(engines.begin() + 1, "DenseUniverseV2");
+    }
+    std::vector<Scenario> scenarios = makeScenarios(options);
+    std::vector<BenchResult> results;
+    printResultHeader();
+    for (const std::string& engine: engines) {
+        for (size_t size: options.sizes) {
+            if (!runsAtSize(engine, size)) {
+                continue;
+            }
+            for (const Scenario& scenario: scenarios) {
+                results.push_back(runScenario(engine, size, scenario, options, heap_bytes));
+                printResult(results.back());
+            }
+        }
+    }
+    return results;
+}
+
+void writeBenchJson(const std::filesystem::path& json_path, const std::vector<BenchResult>& results) {
+    std::ofstream file(json_path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + json_path.string());
+    }
+    file << std::setprecision(8) << "{\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& result = results[i];
+        file << "    {\"engine\": \"" << result.engine << "\", \"scenario\": \"" << result.scenario
+            << "\", \"size\": " << result.size << ", \"generations\": " << result.generations
+            << ", \"repetitions\": " << result.repetitions << ", \"gen_per_sec\": " << result.gen_per_sec
+            << ", \"gen_per_sec_stddev\": " << result.gen_per_sec_stddev
+            << ", \"live_cells_per_sec\": " << result.live_cells_per_sec
+            << ", \"bytes_per_live_cell\": " << result.bytes_per_live_cell
+            << ", \"population\": " << result.population << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+    if (!file) {
+        throw std::runtime_error("Failed to write " + json_path.string());
+    }
+}
+
+std::vector<BenchResult> readBenchJson(const std::filesystem::path& json_path) {
+    std::ifstream file(json_path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + json_path.string());
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    JsonValue document = JsonParser(text).parseDocument();
+    std::vector<BenchResult> results;
+    for (const JsonValue& entry: document.at("results").items) {
+        BenchResult result;
+        result.engine = entry.at("engine").text;
+        result.scenario = entry.at("scenario").text;
+        result.size = static_cast<size_t>(entry.at("size").number);
+        result.generations = static_cast<size_t>(entry.at("generations").number);
+        result.repetitions = static_cast<size_t>(entry.at("repetitions").number);
+        result.gen_per_sec = entry.at("gen_per_sec").number;
+        result.gen_per_sec_stddev = entry.at("gen_per_sec_stddev").number;
+        result.live_cells_per_sec = entry.at("live_cells_per_sec").number;
+        result.bytes_per_live_cell = entry.at("bytes_per_live_cell").number;
+        result.population = static_cast<size_t>(entry.at("population").number);
+        results.push_back(result);
+    }
+    return results;
+}
+
+// the allowed slowdown grows with the spread measured on either side, so noisy scenarios do not cry wolf
+size_t compareBenchResults(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& results,
+        double tolerance) {
+    std::map<std::string, const BenchResult*> baseline_by_key;
+    for (const BenchResult& result: baseline) {
+        baseline_by_key[resultKey(result)] = &result;
+    }
+    std::cout << "                               scenario  baseline gen/s       gen/s  change %  allowed %\n";
+    size_t regressions = 0;
+    for (const BenchResult& result: results) {
+        auto it = baseline_by_key.find(resultKey(result));
+        if (it == baseline_by_key.end() || it->second->gen_per_sec <= 0.0 || result.gen_per_sec <= 0.0) {
+            continue;
+        }
+        const BenchResult& before = *it->second;
+        double change = result.gen_per_sec / before.gen_per_sec - 1.0;
+        double allowed = tolerance + 2.0 * (before.gen_per_sec_stddev / before.gen_per_sec
+                + result.gen_per_sec_stddev / result.gen_per_sec);
+        bool regressed = change < -allowed;
+        regressions += regressed;
+        std::cout << std::setw(39) << resultKey(result) << std::setprecision(4) << std::setw(16) << before.gen_per_sec
+            << std::setw(12) << result.gen_per_sec << std::setprecision(3) << std::setw(10) << 100 * change
+            << std::setw(11) << 100 * allowed << (regressed ? "  REGRESSION" : change > allowed ? "  faster" : "")
+            << '\n';
+    }
+    std::cout << regressions << " regression" << (regressions == 1 ? "" : "s") << '\n';
+    return regressions;
+}
+
+// usage: bench suite [--quick] [--engines A,B] [--sizes 256,1024] [--repetitions N]
+//                    [--json out.json] [--compare baseline.json] [--tolerance 0.1]
+int benchSuiteMain(int argc, const char** argv, const std::filesystem::path& pattern_directory, HeapBytesFn heap_bytes) {
+    BenchSuiteOptions options;
+    options.pattern_directory = pattern_directory;
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error(arg + " needs a value");
+            }
+            return argv[++i];
+        };
+        if (arg == "--quick") {
+            options.sizes = {128};
+            options.repetitions = 3;
+            options.min_seconds = 0.05;
+        }
+        else if (arg == "--engines") {
+            options.engines = splitList(value());
+        }
+        else if (arg == "--sizes") {
+            options.sizes.clear();
+            for (const std::string& size: splitList(value())) {
+                options.sizes.push_back(std::stoul(size));
+            }
+        }
+        else if (arg == "--repetitions") {
+            options.repetitions = std::max<size_t>(1, std::stoul(value()));
+        }
+        else if (arg == "--json") {
+            options.json_path = value();
+        }
+        else if (arg == "--compare") {
+            options.baseline_path = value();
+        }
+        else if (arg == "--tolerance") {
+            options.tolerance = std::stod(value());
+        }
+        else {
+            throw std::runtime_error("Unknown bench suite option " + arg);
+        }
+    }
+    std::vector<BenchResult> results = runBenchSuite(options, heap_bytes);
+    if (!options.json_path.empty()) {
+        writeBenchJson(options.json_path, results);
+    }
+    if (!options.baseline_path.empty()) {
+        return compareBenchResults(readBenchJson(options.baseline_path), results, options.tolerance) == 0 ? 0 : 1;
+    }
+    return 0;
+}
@@ -1,20 +1,712 @@
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <malloc.h>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "universe.hpp"
+#include "bit_universe.hpp"
+#include "hashlife.hpp"
+#include "sorted_universe.hpp"
+#include "tiled_universe.hpp"
+#include "universe_factory.hpp"
+#include "universe_file.hpp"
+#include "trajectory.hpp"
+#include "checkpointer.hpp"
+#include "bench_suite.hpp"
+#include "painter.hpp"
+#include "animator.hpp"
+#include "universe_stats.hpp"
 #include "cell.hpp"
 
-int main(int argc, const char** argv) {
-    std::filesystem::path src_path(__FILE__);
-    std::unique_ptr<Universe> universe = std::make_unique<SparseUniverseV2>(src_path.parent_path() / "gosper_glider.univ");
-    size_t time_steps = argc == 1 ? 5000: std::stoi(argv[1]);
+// live heap bytes and allocations so far, kept by the replaced global operator new and delete below
+std::atomic<size_t> g_heap_bytes{0};
+std::atomic<size_t> g_alloc_count{0};
+
+void* operator new(size_t size) {
+    void* ptr = std::malloc(size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    g_heap_bytes.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed);
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr) {
+        g_heap_bytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+        std::free(ptr);
+    }
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+// std::pmr::new_delete_resource comes through these
+void* operator new(size_t size, std::align_val_t alignment) {
+    void* ptr = std::aligned_alloc(static_cast<size_t>(alignment),
+            (size + static_cast<size_t>(alignment) - 1) & ~(static_cast<size_t>(alignment) - 1));
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    g_heap_bytes.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed);
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    return ptr;
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    operator delete(ptr);
+}
+
+void seedRandomSoup(Universe* universe, double density) {
+    std::mt19937 rng(42);
+    std::bernoulli_distribution coin(density);
+    for (size_t row = 0; row < universe->rowCount(); ++row) {
+        for (size_t col = 0; col < universe->colCount(); ++col) {
+            if (coin(rng)) {
+                universe->makeCellAlive(row, col);
+            }
+        }
+    }
+}
+
+double timeSteps(Universe* universe, size_t time_steps) {
     auto start = std::chrono::steady_clock::now();
     for (size_t i = 0; i < time_steps; ++i) {
         universe->advance();
     }
     auto end = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration<double>(end - start);
-    std::cout << "Time to " << time_steps << " steps of Gosper's glider: " << duration.count() << " s\n";
-    std::cout << "Alive cell count: " << universe->getAliveCellsPos().size() << '\n';
+    return std::chrono::duration<double>(end - start).count();
+}
+
+void benchGosperGlider(const std::filesystem::path& pattern_path, size_t time_steps) {
+    std::unique_ptr<Universe> universe = std::make_unique<SparseUniverseV2>(pattern_path);
+    double duration = timeSteps(universe.get(), time_steps);
+    std::cout << "Time to " << time_steps << " steps of Gosper's glider: " << duration << " s\n";
+    std::cout << "Alive cell count: " << universe->population() << '\n';
+
+    auto hashlife = std::make_unique<HashLifeUniverse>(pattern_path);
+    auto start = std::chrono::steady_clock::now();
+    hashlife->advance(time_steps);
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "Time to jump " << time_steps << " steps with HashLife: "
+        << std::chrono::duration<double>(end - start).count() << " s\n";
+    std::cout << "Alive cell count: " << hashlife->population() << '\n';
+}
+
+// fixed problem size, 1 thread up to every core
+template <typename UnivT>
+void benchStrongScaling(const std::string& name, size_t rows, size_t cols, size_t time_steps) {
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> thread_counts;
+    for (size_t threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+    std::cout << name << " " << rows << "x" << cols << ", " << time_steps << " steps\n";
+    std::cout << "threads  time (s)  speedup  efficiency\n";
+    double serial_duration = 0.0;
+    for (size_t threads: thread_counts) {
+        auto universe = std::make_unique<UnivT>(rows, cols);
+        seedRandomSoup(universe.get(), 0.3);
+        universe->setThreadCount(threads);
+        double duration = timeSteps(universe.get(), time_steps);
+        serial_duration = threads == 1 ? duration : serial_duration;
+        double speedup = serial_duration / duration;
+        std::cout << std::setw(7) << threads << std::setw(10) << std::setprecision(4) << duration
+            << std::setw(9) << speedup << std::setw(12) << speedup / threads << '\n';
+    }
+}
+
+// heap held by a sparse engine per alive cell once its buffers are warm, and its speed on a soup
+template <typename UnivT>
+void benchSparseFootprint(const std::string& name, size_t rows, size_t cols, size_t time_steps) {
+    size_t heap_before = g_heap_bytes.load();
+    auto universe = std::make_unique<UnivT>(rows, cols);
+    seedRandomSoup(universe.get(), 0.3);
+    universe->advance();
+    double duration = timeSteps(universe.get(), time_steps);
+    size_t heap_bytes = g_heap_bytes.load() - heap_before;
+    size_t population = universe->population();
+    std::cout << std::setw(18) << name << std::setw(12) << population
+        << std::setw(16) << std::setprecision(4) << static_cast<double>(heap_bytes) / population
+        << std::setw(12) << time_steps / duration << '\n';
+}
+
+// heap allocations per generation of a sparse engine on a soup, once its buffers are warm
+template <typename UnivT>
+void benchAllocations(const std::string& name, size_t rows, size_t cols, size_t time_steps, bool arenas) {
+    auto universe = std::make_unique<UnivT>(rows, cols);
+    if constexpr (std::is_base_of_v<SparseUniverse, UnivT>) {
+        universe->setArenasEnabled(arenas);
+    }
+    seedRandomSoup(universe.get(), 0.3);
+    universe->advance();
+    universe->advance();
+    size_t allocs_before = g_alloc_count.load();
+    double duration = timeSteps(universe.get(), time_steps);
+    size_t allocs = g_alloc_count.load() - allocs_before;
+    std::cout << std::setw(18) << name << std::setw(8) << (arenas ? "on" : "off")
+        << std::setw(18) << std::setprecision(4) << static_cast<double>(allocs) / time_steps
+        << std::setw(12) << time_steps / duration << '\n';
+}
+
+// a Gosper gun in the corner of ever larger dense grids, the step cost should follow the gun's activity
+template <typename UnivT>
+void benchQuietBoard(const std::string& name, const std::filesystem::path& pattern_path,
+        const std::vector<size_t>& sizes, size_t time_steps) {
+    auto pattern = std::make_unique<SparseUniverseV2>(pattern_path);
+    for (size_t size: sizes) {
+        auto universe = std::make_unique<UnivT>(size, size);
+        pattern->forEachAliveCell([&universe](size_t row, size_t col) { universe->makeCellAlive(row, col); });
+        universe->advance(); // every tile starts out changed, so the first generation is a full one
+        double duration = timeSteps(universe.get(), time_steps);
+        std::cout << std::setw(16) << name << std::setw(8) << size
+            << std::setw(14) << std::setprecision(4) << 1e3 * duration / time_steps << '\n';
+    }
+}
+
+// milliseconds per generation of a soup, with the population it had at the start
+template <typename UnivT>
+std::pair<size_t, double> timeSoup(size_t size, size_t time_steps) {
+    auto universe = std::make_unique<UnivT>(size, size);
+    seedRandomSoup(universe.get(), 0.3);
+    universe->advance();
+    size_t population = universe->population();
+    return {population, 1e3 * timeSteps(universe.get(), time_steps) / time_steps};
+}
+
+// sparse engines on soups from a few hundred to about a million alive cells
+void benchSparseCrossover(size_t time_steps) {
+    std::cout << "ms per generation of a soup, " << time_steps << " steps\n";
+    std::cout << "   size  population  SparseUniverseV1  SparseUniverseV2  SparseUniverseV3    SortedUniverse\n";
+    for (size_t size: {32, 128, 512, 2048}) {
+        auto [population, v1_ms] = timeSoup<SparseUniverseV1>(size, time_steps);
+        std::cout << std::setw(7) << size << std::setw(12) << population << std::setprecision(4)
+            << std::setw(18) << v1_ms
+            << std::setw(18) << timeSoup<SparseUniverseV2>(size, time_steps).second
+            << std::setw(18) << timeSoup<SparseUniverseV3>(size, time_steps).second
+            << std::setw(18) << timeSoup<SortedUniverse>(size, time_steps).second << '\n';
+    }
+}
+
+// generations per second of a soup under each rule, B3/S23 runs the same kernels as before rules existed
+// the named rules have kernels of their own, B35/S1357 takes the generic one
+void benchRules(const std::string& engine, size_t size, size_t time_steps) {
+    std::cout << std::setw(16) << engine << std::setw(7) << size;
+    for (const char* rulestring: {"B3/S23", "B36/S23", "B3678/S34678", "B35/S1357"}) {
+        std::unique_ptr<Universe> universe = makeUniverse(engine, size, size, rulestring);
+        seedRandomSoup(universe.get(), 0.3);
+        universe->advance();
+        std::cout << std::setw(14) << std::setprecision(4) << time_steps / timeSteps(universe.get(), time_steps);
+    }
+    std::cout << '\n';
+}
+
+template <typename Action>
+double timeAction(Action&& action) {
+    auto start = std::chrono::steady_clock::now();
+    action();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// save and load a soup in the text and binary .univ formats
+void benchFileFormats(size_t size) {
+    auto universe = std::make_unique<SortedUniverse>(size, size);
+    seedRandomSoup(universe.get(), 0.3);
+    size_t population = universe->population();
+    std::cout << size << "x" << size << " soup, " << population << " alive cells\n";
+    std::cout << "format      save (s)    load (s)         bytes\n";
+    ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    for (bool binary: {false, true}) {
+        std::filesystem::path path = binary ? "bench_binary.univ" : "bench_text.univ";
+        double save_duration = timeAction([&] { binary ? universe->saveBinary(path) : universe->save(path); });
+        double load_duration = timeAction([&] { readUniverseFile(path, &pool); });
+        std::cout << std::setw(6) << (binary ? "binary" : "text") << std::setprecision(4)
+            << std::setw(14) << save_duration << std::setw(12) << load_duration
+            << std::setw(14) << std::filesystem::file_size(path) << '\n';
+        std::filesystem::remove(path);
+    }
+}
+
+// records a soup settling down, then compares reaching the last generation by replay and by re-simulation
+void benchTrajectory(size_t size, size_t time_steps) {
+    auto universe = std::make_unique<SortedUniverse>(size, size);
+    seedRandomSoup(universe.get(), 0.3);
+    std::filesystem::path path = "bench_trajectory.traj";
+    double record_duration = timeAction([&] {
+        TrajectoryWriter writer(path, *universe);
+        writer.record(*universe);
+        for (size_t i = 0; i < time_steps; ++i) {
+            universe->advance();
+            writer.record(*universe);
+        }
+    });
+    double simulate_duration = timeAction([&] {
+        auto replay = std::make_unique<SortedUniverse>(size, size);
+        seedRandomSoup(replay.get(), 0.3);
+        for (size_t i = 0; i < time_steps; ++i) {
+            replay->advance();
+        }
+    });
+    TrajectoryReader reader(path);
+    double seek_duration = timeAction([&] { reader.flatPositionsAt(time_steps); });
+    TrajectoryReader sequential_reader(path);
+    double playback_duration = timeAction([&] {
+        for (size_t generation = 0; generation <= time_steps; ++generation) {
+            sequential_reader.flatPositionsAt(generation);
+        }
+    });
+    std::cout << size << "x" << size << " soup, " << time_steps << " steps, " << reader.keyframeCount() << " keyframes, "
+        << std::filesystem::file_size(path) << " bytes, " << reader.flatPositionsAt(time_steps).size()
+        << " alive cells at the end\n";
+    std::cout << std::setprecision(4) << "record (s)        " << record_duration << '\n'
+        << "re-simulate (s)   " << simulate_duration << '\n'
+        << "seek last (s)     " << seek_duration << '\n'
+        << "play all (s)      " << playback_duration << '\n';
+    std::filesystem::remove(path);
+}
+
+// step time percentiles of a soup checkpointed every interval generations: not at all, by a blocking
+// saveBinary() between steps, and through a Checkpointer; a step's time includes whatever it waited for
+void benchCheckpointJitter(size_t size, size_t time_steps, size_t interval) {
+    std::cout << size << "x" << size << " soup, " << time_steps << " steps, a checkpoint every " << interval << "\n";
+    std::cout << "      mode   median ms      p99 ms      max ms\n";
+    for (const std::string mode: {"none", "blocking", "async"}) {
+        auto universe = std::make_unique<BitUniverse>(size, size);
+        seedRandomSoup(universe.get(), 0.3);
+        std::filesystem::path directory = "bench_checkpoints";
+        std::filesystem::create_directories(directory);
+        auto checkpointer = mode == "async" ? std::make_unique<Checkpointer>(directory, interval) : nullptr;
+        std::vector<double> step_durations;
+        for (size_t generation = 1; generation <= time_steps; ++generation) {
+            step_durations.push_back(1000 * timeAction([&] {
+                universe->advance();
+                if (generation % interval != 0) {
+                    return;
+                }
+                if (checkpointer) {
+                    checkpointer->checkpoint(*universe, generation);
+                }
+                else if (mode == "blocking") {
+                    universe->saveBinary(directory / "checkpoint.univ");
+                }
+            }));
+        }
+        checkpointer.reset();
+        std::filesystem::remove_all(directory);
+        std::sort(step_durations.begin(), step_durations.end());
+        std::cout << std::setw(10) << mode << std::setprecision(4) << std::setw(12) << step_durations[time_steps / 2]
+            << std::setw(12) << step_durations[time_steps * 99 / 100] << std::setw(12) << step_durations.back() << '\n';
+    }
+}
+
+// per generation stats of a soup on each engine with hooks, needs a build configured with -DGOL_ENABLE_STATS=ON
+// prints every tenth generation and the means, files given as --csv, --json or --trace take every generation
+int benchStats(int argc, const char** argv) {
+    if (!stats_compiled) {
+        std::cerr << "bench stats needs a build configured with -DGOL_ENABLE_STATS=ON\n";
+        return 1;
+    }
+    std::vector<std::string> engines{"DenseUniverseV1", "SparseUniverseV1", "SparseUniverseV2", "SparseUniverseV3"};
+    size_t size = 256;
+    size_t time_steps = 100;
+    std::filesystem::path csv_path, json_path, trace_path;
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error(arg + " needs a value");
+            }
+            return argv[++i];
+        };
+        if (arg == "--engine") {
+            engines = {value()};
+        }
+        else if (arg == "--size") {
+            size = std::stoul(value());
+        }
+        else if (arg == "--steps") {
+            time_steps = std::stoul(value());
+        }
+        else if (arg == "--csv") {
+            csv_path = value();
+        }
+        else if (arg == "--json") {
+            json_path = value();
+        }
+        else if (arg == "--trace") {
+            trace_path = value();
+        }
+        else {
+            throw std::runtime_error("Unknown bench stats option " + arg);
+        }
+    }
+    if ((!csv_path.empty() || !json_path.empty() || !trace_path.empty()) && engines.size() != 1) {
+        throw std::runtime_error("bench stats writes files for one --engine at a time");
+    }
+    std::cout << size << "x" << size << " soup, " << time_steps << " steps\n";
+    for (const std::string& engine: engines) {
+        std::unique_ptr<Universe> universe = makeUniverse(engine, size, size);
+        seedRandomSoup(universe.get(), 0.3);
+        universe->setStatsEnabled(true);
+        timeSteps(universe.get(), time_steps);
+        const std::vector<GenerationStats>& stats = universe->generationStats();
+        std::cout << engine << '\n';
+        std::cout << "     gen        live    births    deaths  frontier     lookups    allocs"
+            "  neighbor us  frontier us   swap us\n";
+        GenerationStats total;
+        auto printRow = [](const std::string& label, const GenerationStats& row, double scale) {
+            std::cout << std::setw(8) << label << std::setprecision(4)
+                << std::setw(12) << row.live_cells * scale << std::setw(10) << row.births * scale
+                << std::setw(10) << row.deaths * scale << std::setw(10) << row.frontier_cells * scale
+                << std::setw(12) << row.lookups * scale << std::setw(10) << row.allocations * scale
+                << std::setw(13) << row.neighbor_ns * scale / 1e3 << std::setw(13) << row.frontier_ns * scale / 1e3
+                << std::setw(10) << row.swap_ns * scale / 1e3 << '\n';
+        };
+        for (const GenerationStats& row: stats) {
+            if (row.generation % std::max<size_t>(1, time_steps / 10) == 0) {
+                printRow(std::to_string(row.generation), row, 1.0);
+            }
+            total.live_cells += row.live_cells;
+            total.births += row.births;
+            total.deaths += row.deaths;
+            total.frontier_cells += row.frontier_cells;
+            total.lookups += row.lookups;
+            total.allocations += row.allocations;
+            total.neighbor_ns += row.neighbor_ns;
+            total.frontier_ns += row.frontier_ns;
+            total.swap_ns += row.swap_ns;
+        }
+        printRow("mean", total, 1.0 / std::max<size_t>(1, stats.size()));
+        if (!csv_path.empty()) {
+            writeStatsCsv(csv_path, stats);
+        }
+        if (!json_path.empty()) {
+            writeStatsJson(json_path, stats);
+        }
+        if (!trace_path.empty()) {
+            writeStatsChromeTrace(trace_path, stats);
+        }
+    }
+    return 0;
+}
+
+// a soup painted frame after frame into /dev/null, bytes and writes per frame next to the population
+void benchRender(size_t size, size_t frames) {
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open /dev/null");
+    }
+    auto universe = std::make_unique<BitUniverse>(size, size);
+    seedRandomSoup(universe.get(), 0.3);
+    std::cout << size << "x" << size << " soup, " << frames << " frames\n";
+    std::cout << "   frame  population  bytes per frame  writes per frame\n";
+    {
+        GridPainter painter(fd);
+        for (size_t frame = 0; frame < frames; ++frame) {
+            size_t population = 0;
+            universe->forEachAliveCell([&](size_t row, size_t col) {
+                painter.paint(row, col, "█", Color::green);
+                population++;
+            });
+            size_t writes = painter.writeCount();
+            painter.present();
+            if (frame % std::max<size_t>(1, frames / 10) == 0) {
+                std::cout << std::setw(8) << frame << std::setw(12) << population << std::setw(17)
+                    << painter.lastFrameBytes() << std::setw(18) << painter.writeCount() - writes << '\n';
+            }
+            universe->advance();
+        }
+    }
+    close(fd);
+}
+
+// wall time of an animation with stepping and drawing overlapped, against stepping alone plus one
+// refresh period per frame, which is what drawing, sleeping and stepping in turn used to take
+void benchAnimate(size_t size, size_t frames, std::chrono::milliseconds refresh_period) {
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open /dev/null");
+    }
+    auto stepped = std::make_unique<SparseUniverseV2>(size, size);
+    seedRandomSoup(stepped.get(), 0.3);
+    double step_seconds = timeSteps(stepped.get(), frames);
+    auto universe = std::make_unique<SparseUniverseV2>(size, size);
+    seedRandomSoup(universe.get(), 0.3);
+    CenterAutoPanAnimator animator(refresh_period, 8, fd);
+    double animate_seconds = timeAction([&] { animator.animate(universe.get(), frames); });
+    close(fd);
+    double serial_seconds = step_seconds + frames * std::chrono::duration<double>(refresh_period).count();
+    std::cout << size << "x" << size << " soup, " << frames << " frames every " << refresh_period.count() << " ms\n";
+    std::cout << std::setprecision(4) << "stepping alone       " << step_seconds << " s\n";
+    std::cout << "serial, estimated    " << serial_seconds << " s\n";
+    std::cout << "pipelined            " << animate_seconds << " s, up to " << animator.maxQueuedFrames()
+        << " frames queued\n";
+}
+
+// microseconds per 40x40 viewport query of a soup, filtering every alive Cell against the engine's own query
+void benchRegionQuery(size_t size, size_t queries) {
+    std::cout << size << "x" << size << " soup at 5%, " << queries << " 40x40 queries\n";
+    std::cout << "          engine  filtered us   region us\n";
+    for (const std::string& engine: universeEngineNames()) {
+        if (engine == "DenseUniverseV1") {
+            continue; // a Cell object per position does not fit this size
+        }
+        std::unique_ptr<Universe> universe = makeUniverse(engine, size, size);
+        seedRandomSoup(universe.get(), 0.05);
+        CellRect viewport{size / 2, size / 2, size / 2 + 40, size / 2 + 40};
+        size_t filtered_count = 0;
+        double filtered = timeAction([&] {
+            for (size_t i = 0; i < std::max<size_t>(1, queries / 100); ++i) {
+                universe->forEachAliveCell([&](size_t row, size_t col) { filtered_count += viewport.contains(row, col); });
+            }
+        });
+        size_t region_count = 0;
+        double region = timeAction([&] {
+            for (size_t i = 0; i < queries; ++i) {
+                universe->forEachAliveCellIn(viewport, [&](size_t, size_t) { region_count++; });
+            }
+        });
+        std::cout << std::setw(16) << engine << std::setprecision(4)
+            << std::setw(13) << 1e6 * filtered / std::max<size_t>(1, queries / 100)
+            << std::setw(12) << 1e6 * region / queries << '\n';
+    }
+}
+
+// microseconds per generation for population, centroid and bounding box, from a pass over the alive Cells
+// against the engine's own accessors, which also pay for tightening the box after the step
+void benchSummary(size_t size, size_t time_steps) {
+    std::cout << size << "x" << size << " soup, " << time_steps << " steps\n";
+    std::cout << "          engine  population    step ms     pass us  accessor us\n";
+    for (const std::string& engine: universeEngineNames()) {
+        if (engine == "DenseUniverseV1") {
+            continue; // a Cell object per position does not fit this size
+        }
+        std::unique_ptr<Universe> universe = makeUniverse(engine, size, size);
+        seedRandomSoup(universe.get(), 0.3);
+        double step = 0.0;
+        double pass = 0.0;
+        double accessors = 0.0;
+        for (size_t i = 0; i < time_steps; ++i) {
+            step += timeAction([&] { universe->advance(); });
+            pass += timeAction([&] {
+                size_t population = 0;
+                double row_sum = 0.0;
+                CellRect bounds;
+                universe->forEachAliveCell([&](size_t row, size_t col) {
+                    population++;
+                    row_sum += row;
+                    bounds.include(row, col);
+                });
+            });
+            accessors += timeAction([&] {
+                universe->population();
+                universe->centroid();
+                universe->boundingBox();
+            });
+        }
+        std::cout << std::setw(16) << engine << std::setw(12) << universe->population() << std::setprecision(4)
+            << std::setw(11) << 1e3 * step / time_steps << std::setw(12) << 1e6 * pass / time_steps
+            << std::setw(13) << 1e6 * accessors / time_steps << '\n';
+    }
+}
+
+// gen/s of BitUniverse::advance(time_steps) at each temporal block depth, on soups whose word grids
+// range from cache sized to well past the last level cache, every depth starts from the same soup
+// the soup is a random word per row word, two thirds of them cleared, so seeding stays quick at any size
+void benchTemporalBlocking(size_t time_steps) {
+    std::vector<size_t> depths{1, 2, 4, 8, 16, 32, 64};
+    std::cout << "gen/s of a soup by temporal block depth, " << time_steps << " steps\n";
+    std::cout << std::setw(7) << "size" << std::setw(10) << "grid MiB";
+    for (size_t depth: depths) {
+        std::cout << std::setw(9) << depth;
+    }
+    std::cout << '\n';
+    for (size_t size: {4096, 16384, 32768}) {
+        std::cout << std::setw(7) << size << std::setw(10) << size * size / 8 / (1 << 20);
+        for (size_t depth: depths) {
+            BitUniverse universe(size, size);
+            std::mt19937_64 rng(42);
+            for (size_t row = 0; row < size; ++row) {
+                for (size_t col = 0; col < size; col += 64) {
+                    uint64_t word = rng();
+                    if (word % 3 != 0) {
+                        continue;
+                    }
+                    for (uint64_t bits = rng(); bits != 0; bits &= bits - 1) {
+                        universe.makeCellAlive(row, col + __builtin_ctzll(bits));
+                    }
+                }
+            }
+            universe.advance(); // every tile starts changed
+            universe.setTemporalBlockDepth(depth);
+            double seconds = timeAction([&] { universe.advance(time_steps); });
+            std::cout << std::setw(9) << std::setprecision(4) << time_steps / seconds << std::flush;
+        }
+        std::cout << '\n';
+    }
+}
+
+// a bounded soup settles into still lifes and oscillators long before time_steps, from there on
+// advanceDetectingCycles only steps what is left modulo the period while advance() keeps stepping
+void benchStabilization(size_t size, size_t time_steps) {
+    std::cout << size << "x" << size << " soup, " << time_steps << " steps\n";
+    std::cout << "          engine   blind s  detecting s  stable at  period\n";
+    for (const char* engine: {"SparseUniverseV3", "BitUniverse", "TiledUniverse", "HashLifeUniverse"}) {
+        std::unique_ptr<Universe> blind = makeUniverse(engine, size, size);
+        std::unique_ptr<Universe> detecting = makeUniverse(engine, size, size);
+        seedRandomSoup(blind.get(), 0.3);
+        seedRandomSoup(detecting.get(), 0.3);
+        double blind_seconds = timeAction([&] { blind->advance(time_steps); });
+        StabilityReport report;
+        double detecting_seconds = timeAction([&] { report = detecting->advanceDetectingCycles(time_steps); });
+        if (blind->stateHash() != detecting->stateHash()) {
+            std::cout << engine << " ended in a different state\n";
+        }
+        std::cout << std::setw(16) << engine << std::setprecision(4) << std::setw(10) << blind_seconds
+            << std::setw(13) << detecting_seconds;
+        if (report.stabilized) {
+            std::cout << std::setw(11) << report.generation << std::setw(8) << report.period << '\n';
+        }
+        else {
+            std::cout << std::setw(11) << "-" << std::setw(8) << "-" << '\n';
+        }
+    }
+}
+
+size_t liveHeapBytes() {
+    return g_heap_bytes.load();
+}
+
+// usage: bench suite [options], which bench with no arguments runs with its defaults, see bench_suite.cpp
+//        bench [time_steps], Gosper's glider gun alone
+//        bench scaling [time_steps]
+//        bench sparse [time_steps]
+//        bench allocs [time_steps]
+//        bench activity [time_steps]
+//        bench crossover [time_steps]
+//        bench rules [time_steps]
+//        bench io [size]
+//        bench trajectory [time_steps]
+//        bench checkpoint [time_steps]
+//        bench render [frames]
+//        bench animate [frames]
+//        bench region [queries]
+//        bench summary [time_steps]
+//        bench temporal [time_steps]
+//        bench stabilize [time_steps]
+//        bench stats [--engine name] [--size n] [--steps n] [--csv file] [--json file] [--trace file]
+int main(int argc, const char** argv) {
+    std::filesystem::path src_path(__FILE__);
+    if (argc == 1 || std::string(argv[1]) == "suite") {
+        return benchSuiteMain(std::max(0, argc - 2), argv + 2, src_path.parent_path(), liveHeapBytes);
+    }
+    if (argc > 1 && std::string(argv[1]) == "scaling") {
+        size_t time_steps = argc > 2 ? std::stoi(argv[2]) : 20;
+        benchStrongScaling<DenseUniverseV1>("DenseUniverseV1", 1024, 1024, time_steps);
+        benchStrongScaling<BitUniverse>("BitUniverse", 8192, 8192, 50 * time_steps);
+        benchStrongScaling<SparseUniverseV2>("SparseUniverseV2", 1024, 1024, time_steps);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "sparse") {
+        size_t time_steps = argc > 2 ? std::stoi(argv[2]) : 20;
+        std::cout << "2048x2048 soup, " << time_steps << " steps\n";
+        std::cout << "            engine  population  bytes per cell       gen/s\n";
+        benchSparseFootprint<SparseUniverseV2>("SparseUniverseV2", 2048, 2048, time_steps);
+        benchSparseFootprint<SparseUniverseV3>("SparseUniverseV3", 2048, 2048, time_steps);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "allocs") {
+        size_t time_steps = argc > 2 ? std::stoi(argv[2]) : 20;
+        std::cout << "512x512 soup, " << time_steps << " steps\n";
+        std::cout << "            engine  arenas  allocs per gen       gen/s\n";
+        for (bool arenas: {false, true}) {
+            benchAllocations<SparseUniverseV1>("SparseUniverseV1", 512, 512, time_steps, arenas);
+            benchAllocations<SparseUniverseV2>("SparseUniverseV2", 512, 512, time_steps, arenas);
+        }
+        benchAllocations<SparseUniverseV3>("SparseUniverseV3", 512, 512, time_steps, false);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "activity") {
+        size_t time_steps = argc > 2 ? std::stoi(argv[2]) : 200;
+        auto pattern_path = src_path.parent_path() / "gosper_glider.univ";
+        std::cout << "Gosper gun, " << time_steps << " steps\n";
+        std::cout << "          engine    size   ms per step\n";
+        benchQuietBoard<DenseUniverseV1>("DenseUniverseV1", pattern_path, {256, 512, 1024, 2048}, time_steps);
+        benchQuietBoard<BitUniverse>("BitUniverse", pattern_path, {1024, 4096, 16384, 32768}, time_steps);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "crossover") {
+        benchSparseCrossover(argc > 2 ? std::stoi(argv[2]) : 5);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "rules") {
+        size_t time_steps = argc > 2 ? std::stoi(argv[2]) : 20;
+        std::cout << "gen/s of a soup, " << time_steps << " steps\n";
+        std::cout << "          engine   size        B3/S23       B36/S23  B3678/S34678     B35/S1357\n";
+        benchRules("BitUniverse", 4096, 10 * time_steps);
+        benchRules("TiledUniverse", 2048, time_steps);
+        benchRules("DenseUniverseV1", 512, time_steps);
+        benchRules("SortedUniverse", 512, time_steps);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "io") {
+        benchFileFormats(argc > 2 ? std::stoi(argv[2]) : 4096);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "trajectory") {
+        benchTrajectory(1024, argc > 2 ? std::stoi(argv[2]) : 1000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "checkpoint") {
+        benchCheckpointJitter(4096, argc > 2 ? std::stoi(argv[2]) : 400, 20);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "render") {
+        benchRender(200, argc > 2 ? std::stoi(argv[2]) : 1000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "animate") {
+        benchAnimate(256, argc > 2 ? std::stoi(argv[2]) : 100, std::chrono::milliseconds(10));
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "region") {
+        benchRegionQuery(4096, argc > 2 ? std::stoi(argv[2]) : 1000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "summary") {
+        benchSummary(1024, argc > 2 ? std::stoi(argv[2]) : 20);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "temporal") {
+        benchTemporalBlocking(argc > 2 ? std::stoi(argv[2]) : 64);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "stabilize") {
+        benchStabilization(256, argc > 2 ? std::stoi(argv[2]) : 10000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "stats") {
+        return benchStats(argc - 2, argv + 2);
+    }
+    size_t time_steps = std::stoi(argv[1]);
+    benchGosperGlider(src_path.parent_path() / "gosper_glider.univ", time_steps);
     return 0;
 }
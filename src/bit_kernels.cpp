@@ -0,0 +1,77 @@
+#include <initializer_list>
+
+#include "bit_kernel_impl.hpp"
+
+RowKernel scalarRowKernel(uint32_t rule_table) {
+    return rowKernelFor<uint64_t>(rule_table);
+}
+
+namespace {
+
+bool cpuSupports(KernelIsa isa) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (isa) {
+        case KernelIsa::scalar:
+            return true;
+        case KernelIsa::sse2:
+            return __builtin_cpu_supports("sse2");
+        case KernelIsa::avx2:
+            return __builtin_cpu_supports("avx2");
+        case KernelIsa::avx512:
+            return __builtin_cpu_supports("avx512f");
+    }
+    return false;
+#else
+    return isa == KernelIsa::scalar;
+#endif
+}
+
+RowKernel compiledRowKernel(KernelIsa isa, Rule rule) {
+    switch (isa) {
+        case KernelIsa::scalar:
+            return scalarRowKernel(rule.table());
+        case KernelIsa::sse2:
+            return sse2RowKernel(rule.table());
+        case KernelIsa::avx2:
+            return avx2RowKernel(rule.table());
+        case KernelIsa::avx512:
+            return avx512RowKernel(rule.table());
+    }
+    return nullptr;
+}
+
+}
+
+RowKernel getRowKernel(KernelIsa isa, Rule rule) {
+    return cpuSupports(isa) ? compiledRowKernel(isa, rule) : nullptr;
+}
+
+bool isKernelIsaSupported(KernelIsa isa) {
+    return getRowKernel(isa) != nullptr;
+}
+
+KernelIsa bestKernelIsa() {
+    static const KernelIsa best = [] {
+        for (KernelIsa isa: {KernelIsa::avx512, KernelIsa::avx2, KernelIsa::sse2}) {
+            if (isKernelIsaSupported(isa)) {
+                return isa;
+            }
+        }
+        return KernelIsa::scalar;
+    }();
+    return best;
+}
+
+const char* kernelIsaName(KernelIsa isa) {
+    switch (isa) {
+        case KernelIsa::scalar:
+            return "scalar";
+        case KernelIsa::sse2:
+            return "sse2";
+        case KernelIsa::avx2:
+            return "avx2";
+        case KernelIsa::avx512:
+            return "avx512";
+    }
+    return "unknown";
+}
@@ -0,0 +1,18 @@
+// compiled with the instruction set enabled, see src/CMakeLists.txt
+#include "bit_kernel_impl.hpp"
+
+#ifdef __AVX512F__
+namespace {
+
+typedef uint64_t WordVec __attribute__((vector_size(64)));
+
+}
+
+RowKernel avx512RowKernel(uint32_t rule_table) {
+    return rowKernelFor<WordVec>(rule_table);
+}
+#else
+RowKernel avx512RowKernel(uint32_t) {
+    return nullptr;
+}
+#endif
@@ -0,0 +1,18 @@
+// SSE2 is part of the x86-64 baseline, no extra compile flags needed
+#include "bit_kernel_impl.hpp"
+
+#ifdef __SSE2__
+namespace {
+
+typedef uint64_t WordVec __attribute__((vector_size(16)));
+
+}
+
+RowKernel sse2RowKernel(uint32_t rule_table) {
+    return rowKernelFor<WordVec>(rule_table);
+}
+#else
+RowKernel sse2RowKernel(uint32_t) {
+    return nullptr;
+}
+#endif
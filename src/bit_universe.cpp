@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "bit_universe.hpp"
+
+BitUniverse::BitUniverse(size_t rows, size_t cols): Universe(rows, cols) {
+    setKernelIsa(bestKernelIsa());
+    initWords();
+}
+
+BitUniverse::BitUniverse(const std::filesystem::path& file_path): Universe(file_path) {
+    auto fdata = Universe::parseFile(file_path);
+    m_rows = fdata.rows;
+    m_cols = fdata.cols;
+    setKernelIsa(bestKernelIsa());
+    initWords();
+    for (const std::pair<size_t, size_t>& p: fdata.alive_cells_pos) {
+        makeCellAlive(p.first, p.second);
+    }
+}
+
+void BitUniverse::setKernelIsa(KernelIsa isa) {
+    RowKernel kernel = getRowKernel(isa, m_rule);
+    if (!kernel) {
+        throw std::runtime_error(std::string("Row kernel not supported on this CPU: ") + kernelIsaName(isa));
+    }
+    m_kernel_isa = isa;
+    m_row_kernel = kernel;
+}
+
+// picks the kernel compiled for the rule when there is one, quiet tiles were only quiet under the old rule
+void BitUniverse::setRule(Rule rule) {
+    Universe::setRule(rule);
+    m_row_kernel = getRowKernel(m_kernel_isa, rule);
+    m_activity.markAllChanged();
+}
+
+// each row is padded with a dead word on both sides and the grid with a dead row on top and bottom
+// so that the kernels never need bounds checks, the padding is never written
+void BitUniverse::initWords() {
+    m_words_per_row = (m_cols + 63) / 64;
+    m_row_stride = m_words_per_row + 2;
+    size_t tail_bits = m_cols % 64;
+    m_last_word_mask = tail_bits == 0 ? ~uint64_t{0} : (uint64_t{1} << tail_bits) - 1;
+    m_word_grid_1.assign((m_rows + 2) * m_row_stride, 0);
+    m_word_grid_2.assign((m_rows + 2) * m_row_stride, 0);
+    m_activity.reset((m_rows + tile_rows - 1) / tile_rows, (m_words_per_row + tile_words - 1) / tile_words);
+    m_tile_summaries.assign(m_activity.tileRows() * m_activity.tileCols(), AliveSummary{});
+}
+
+// a few popcounts per word of each tile that changed, the step itself never counts anything
+void BitUniverse::settleSummary() const {
+    m_activity.takeUnsettled([this](size_t tile_row, size_t tile_col) {
+        AliveChanges changes;
+        size_t end_word = std::min(m_words_per_row, (tile_col + 1) * tile_words);
+        for (size_t row = tile_row * tile_rows; row < std::min(m_rows, (tile_row + 1) * tile_rows); ++row) {
+            uint64_t const* words = getCurrentRow(row);
+            for (size_t w = tile_col * tile_words; w < end_word; ++w) {
+                changes.births.addWord(row, 64 * w, words[w]);
+            }
+        }
+        AliveSummary& settled = m_tile_summaries[tile_row * m_activity.tileCols() + tile_col];
+        changes.deaths = settled;
+        settled = changes.births;
+        applyChanges(changes);
+    });
+}
+
+uint64_t* BitUniverse::getCurrentRow(size_t row) {
+    return (m_grid_1_is_current ? m_word_grid_1.data() : m_word_grid_2.data()) + (row + 1) * m_row_stride + 1;
+}
+
+uint64_t const* BitUniverse::getCurrentRow(size_t row) const {
+    return (m_grid_1_is_current ? m_word_grid_1.data() : m_word_grid_2.data()) + (row + 1) * m_row_stride + 1;
+}
+
+uint64_t* BitUniverse::getNextRow(size_t row) {
+    return (m_grid_1_is_current ? m_word_grid_2.data() : m_word_grid_1.data()) + (row + 1) * m_row_stride + 1;
+}
+
+bool BitUniverse::isCellAlive(size_t row, size_t col) {
+    return (getCurrentRow(row)[col / 64] >> (col % 64)) & 1;
+}
+
+void BitUniverse::makeCellAlive(size_t row, size_t col) {
+    getCurrentRow(row)[col / 64] |= uint64_t{1} << (col % 64);
+    m_activity.markChanged(row / tile_rows, col / 64 / tile_words);
+}
+
+void BitUniverse::makeCellDead(size_t row, size_t col) {
+    getCurrentRow(row)[col / 64] &= ~(uint64_t{1} << (col % 64));
+    m_activity.markChanged(row / tile_rows, col / 64 / tile_words);
+}
+
+void BitUniverse::advance() {
+    m_generation++;
+    if (m_words_per_row == 0) {
+        return;
+    }
+    if (m_thread_pool) {
+        m_thread_pool->parallelFor(m_activity.tileRows(), [this](size_t, size_t begin_tile_row, size_t end_tile_row) {
+            advanceTileRows(begin_tile_row, end_tile_row);
+        });
+    }
+    else {
+        advanceTileRows(0, m_activity.tileRows());
+    }
+    m_activity.swap();
+    m_grid_1_is_current = !m_grid_1_is_current;
+}
+
+// each run of adjacent active tiles in a tile row goes through the kernel as one span of words per row
+void BitUniverse::advanceTileRows(size_t begin_tile_row, size_t end_tile_row) {
+    size_t tile_cols = m_activity.tileCols();
+    for (size_t tile_row = begin_tile_row; tile_row < end_tile_row; ++tile_row) {
+        if (!m_activity.startTileRow(tile_row)) {
+            continue;
+        }
+        size_t begin_row = tile_row * tile_rows;
+        size_t end_row = std::min(m_rows, begin_row + tile_rows);
+        size_t run_end = 0;
+        for (size_t tile_col = 0; tile_col < tile_cols; tile_col = run_end) {
+            run_end = tile_col + 1;
+            if (!m_activity.isActive(tile_row, tile_col)) {
+                m_activity.setNextChanged(tile_row, tile_col, false);
+                continue;
+            }
+            while (run_end < tile_cols && m_activity.isActive(tile_row, run_end)) {
+                ++run_end;
+            }
+            size_t begin_word = tile_col * tile_words;
+            size_t end_word = std::min(m_words_per_row, run_end * tile_words);
+            for (size_t row = begin_row; row < end_row; ++row) {
+                uint64_t const* current = getCurrentRow(row);
+                uint64_t* next = getNextRow(row);
+                // rows -1 and m_rows are the dead padding rows, words -1 and m_words_per_row the padding words
+                m_row_kernel(current - m_row_stride + begin_word, current + begin_word,
+                        current + m_row_stride + begin_word, next + begin_word, end_word - begin_word, m_rule.table());
+                if (end_word == m_words_per_row) {
+                    next[m_words_per_row - 1] &= m_last_word_mask; // no births past the last column
+                }
+            }
+            for (size_t tile = tile_col; tile < run_end; ++tile) {
+                uint64_t diff = 0;
+                for (size_t row = begin_row; row < end_row; ++row) {
+                    uint64_t const* current = getCurrentRow(row);
+                    uint64_t const* next = getNextRow(row);
+                    for (size_t w = tile * tile_words; w < std::min(m_words_per_row, (tile + 1) * tile_words); ++w) {
+                        diff |= current[w] ^ next[w];
+                    }
+                }
+                m_activity.setNextChanged(tile_row, tile, diff != 0);
+            }
+        }
+    }
+}
+
+void BitUniverse::setTemporalBlockDepth(size_t depth) {
+    if (depth == 0 || depth > tile_rows) {
+        throw std::runtime_error("Temporal block depth must be between 1 and " + std::to_string(tile_rows));
+    }
+    m_block_depth = depth;
+}
+
+void BitUniverse::advance(size_t generations) {
+    while (generations != 0) {
+        size_t depth = std::min(generations, m_block_depth);
+        if (depth == 1) {
+            advance();
+        }
+        else {
+            advanceBlocked(depth);
+        }
+        generations -= depth;
+    }
+}
+
+// a change spreads one row per generation, so with depth at most tile_rows a block of tile rows
+// can only change if startTileRow finds one of them active, the same test advance() makes
+void BitUniverse::advanceBlocked(size_t depth) {
+    m_generation += depth;
+    if (m_words_per_row == 0) {
+        return;
+    }
+    size_t fitting_rows = temporal_block_bytes / (2 * m_row_stride * sizeof(uint64_t));
+    size_t block_rows = fitting_rows > 2 * depth + 2 ? fitting_rows - 2 * depth - 2 : 0;
+    size_t block_tile_rows = std::max<size_t>(1, block_rows / tile_rows);
+    size_t block_count = (m_activity.tileRows() + block_tile_rows - 1) / block_tile_rows;
+    m_block_scratch.resize(threadCount());
+    auto advanceBlocks = [this, depth, block_tile_rows](size_t band, size_t begin_block, size_t end_block) {
+        for (size_t block = begin_block; block < end_block; ++block) {
+            advanceBlock(block * block_tile_rows, std::min(m_activity.tileRows(), (block + 1) * block_tile_rows),
+                    depth, m_block_scratch[band]);
+        }
+    };
+    if (m_thread_pool) {
+        m_thread_pool->parallelFor(block_count, advanceBlocks);
+    }
+    else {
+        advanceBlocks(0, 0, block_count);
+    }
+    m_activity.swap();
+    m_grid_1_is_current = !m_grid_1_is_current;
+}
+
+// the window holds rows [top - depth, bottom + depth) cut to the Universe, and each generation computes
+// one row less on either side that is not an edge of the Universe, so rows [top, bottom) come out exact
+// the current grid is only read and the next one only written, so blocks run in parallel
+void BitUniverse::advanceBlock(size_t begin_tile_row, size_t end_tile_row, size_t depth,
+        std::vector<uint64_t>& scratch) {
+    bool active = false;
+    for (size_t tile_row = begin_tile_row; tile_row < end_tile_row; ++tile_row) {
+        active = m_activity.startTileRow(tile_row) || active;
+    }
+    if (!active) {
+        return;
+    }
+    size_t top = begin_tile_row * tile_rows;
+    size_t bottom = std::min(m_rows, end_tile_row * tile_rows);
+    size_t window_top = top > depth ? top - depth : 0;
+    size_t window_bottom = std::min(m_rows, bottom + depth);
+    size_t window_rows = window_bottom - window_top;
+    // two padded grids of the window's rows, like the word grids
+    size_t grid_words = (window_rows + 2) * m_row_stride;
+    scratch.resize(std::max(scratch.size(), 2 * grid_words));
+    uint64_t* from = scratch.data();
+    uint64_t* to = from + grid_words;
+    for (uint64_t* grid: {from, to}) {
+        std::fill_n(grid, m_row_stride, 0);
+        std::fill_n(grid + (window_rows + 1) * m_row_stride, m_row_stride, 0);
+    }
+    for (size_t i = 0; i < window_rows; ++i) {
+        std::copy_n(getCurrentRow(window_top + i) - 1, m_row_stride, from + (i + 1) * m_row_stride);
+        to[(i + 1) * m_row_stride] = 0;
+        to[(i + 2) * m_row_stride - 1] = 0;
+    }
+    for (size_t generation = 1; generation <= depth; ++generation) {
+        size_t begin = window_top == 0 ? 0 : generation;
+        size_t end = window_bottom == m_rows ? window_rows : window_rows - generation;
+        for (size_t i = begin; i < end; ++i) {
+            uint64_t const* row = from + (i + 1) * m_row_stride + 1;
+            uint64_t* next = to + (i + 1) * m_row_stride + 1;
+            m_row_kernel(row - m_row_stride, row, row + m_row_stride, next, m_words_per_row, m_rule.table());
+            next[m_words_per_row - 1] &= m_last_word_mask; // no births past the last column
+        }
+        std::swap(from, to);
+    }
+    // from holds the last generation and to the one before it, the idle grid keeps the block's first one
+    // a tile is flagged if it changed in the last generation, which the next step needs to look at,
+    // or over the block, so that both buffers of an unflagged tile hold the same cells again
+    std::vector<uint64_t> tile_diffs(m_activity.tileCols());
+    for (size_t tile_row = begin_tile_row; tile_row < end_tile_row; ++tile_row) {
+        std::fill(tile_diffs.begin(), tile_diffs.end(), 0);
+        for (size_t row = tile_row * tile_rows; row < std::min(m_rows, (tile_row + 1) * tile_rows); ++row) {
+            uint64_t const* last = from + (row - window_top + 1) * m_row_stride + 1;
+            uint64_t const* before_last = to + (row - window_top + 1) * m_row_stride + 1;
+            uint64_t const* current = getCurrentRow(row);
+            uint64_t* next = getNextRow(row);
+            for (size_t w = 0; w < m_words_per_row; ++w) {
+                next[w] = last[w];
+                tile_diffs[w / tile_words] |= (last[w] ^ before_last[w]) | (last[w] ^ current[w]);
+            }
+        }
+        for (size_t tile = 0; tile < m_activity.tileCols(); ++tile) {
+            m_activity.setNextChanged(tile_row, tile, tile_diffs[tile] != 0);
+        }
+    }
+}
+
+void BitUniverse::forEachAliveCell(CellVisitor visit) const {
+    for (size_t row = 0; row < m_rows; ++row) {
+        uint64_t const* words = getCurrentRow(row);
+        for (size_t w = 0; w < m_words_per_row; ++w) {
+            for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1) {
+                visit(row, 64 * w + __builtin_ctzll(bits));
+            }
+        }
+    }
+}
+
+uint64_t BitUniverse::colMask(size_t w, size_t left, size_t right) {
+    size_t first = std::max(left, 64 * w) - 64 * w;
+    size_t last = std::min(right, 64 * (w + 1)) - 64 * w; // past the last bit
+    uint64_t below_last = last == 64 ? ~uint64_t{0} : (uint64_t{1} << last) - 1;
+    return below_last & ~((uint64_t{1} << first) - 1);
+}
+
+void BitUniverse::forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const {
+    CellRect clamped = clampRect(rect);
+    if (clamped.empty()) {
+        return;
+    }
+    size_t first_word = clamped.left / 64;
+    size_t end_word = (clamped.right + 63) / 64;
+    for (size_t row = clamped.top; row < clamped.bottom; ++row) {
+        uint64_t const* words = getCurrentRow(row);
+        for (size_t w = first_word; w < end_word; ++w) {
+            for (uint64_t bits = words[w] & colMask(w, clamped.left, clamped.right); bits != 0; bits &= bits - 1) {
+                visit(row, 64 * w + __builtin_ctzll(bits));
+            }
+        }
+    }
+}
+
+size_t BitUniverse::countAliveIn(const CellRect& rect) const {
+    CellRect clamped = clampRect(rect);
+    if (clamped.empty()) {
+        return 0;
+    }
+    size_t first_word = clamped.left / 64;
+    size_t end_word = (clamped.right + 63) / 64;
+    size_t count = 0;
+    for (size_t row = clamped.top; row < clamped.bottom; ++row) {
+        uint64_t const* words = getCurrentRow(row);
+        for (size_t w = first_word; w < end_word; ++w) {
+            count += __builtin_popcountll(words[w] & colMask(w, clamped.left, clamped.right));
+        }
+    }
+    return count;
+}
+
+void BitUniverse::takeSnapshot(CellSnapshot& snapshot) const {
+    snapshot.rows = m_rows;
+    snapshot.cols = m_cols;
+    snapshot.words_per_row = m_words_per_row;
+    snapshot.words.resize(m_rows * m_words_per_row);
+    for (size_t row = 0; row < m_rows; ++row) {
+        std::copy_n(getCurrentRow(row), m_words_per_row, snapshot.words.data() + row * m_words_per_row);
+    }
+}
+
+void BitUniverse::makeAllCellsDead() {
+    std::fill(m_word_grid_1.begin(), m_word_grid_1.end(), 0);
+    std::fill(m_word_grid_2.begin(), m_word_grid_2.end(), 0);
+    m_activity.markAllChanged();
+}
+
+void BitUniverse::save(const std::filesystem::path& file_path) const {
+    Universe::save(file_path);
+}
+
+void BitUniverse::load(const std::filesystem::path& file_path) {
+    auto fdata = Universe::parseFile(file_path);
+    if (fdata.rows != m_rows || fdata.cols != m_cols) {
+        throw std::runtime_error("Cannot load a universe with a mismatched size");
+    }
+    makeAllCellsDead();
+    for (const std::pair<size_t, size_t>& p: fdata.alive_cells_pos) {
+        makeCellAlive(p.first, p.second);
+    }
+}
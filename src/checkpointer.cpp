@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "checkpointer.hpp"
+#include "universe.hpp"
+#include "universe_file.hpp"
+
+namespace {
+
+void syncPath(const std::filesystem::path& path, int flags) {
+    int fd = ::open(path.c_str(), flags);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + path.string() + " for fsync");
+    }
+    int result = ::fsync(fd);
+    ::close(fd);
+    if (result != 0) {
+        throw std::runtime_error("Failed to fsync " + path.string());
+    }
+}
+
+}
+
+Checkpointer::Checkpointer(const std::filesystem::path& directory, size_t interval, size_t keep_count):
+    m_directory(directory), m_interval(interval), m_keep_count(keep_count) {
+    if (interval == 0 || keep_count == 0) {
+        throw std::runtime_error("Checkpoint interval and kept count must be at least 1");
+    }
+    std::filesystem::create_directories(directory);
+    m_writer = std::thread(&Checkpointer::writeLoop, this);
+}
+
+Checkpointer::~Checkpointer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_changed.notify_all();
+    m_writer.join(); // the pending snapshot is written first
+}
+
+void Checkpointer::onGeneration(const Universe& universe, size_t generation) {
+    if (generation % m_interval == 0) {
+        checkpoint(universe, generation);
+    }
+}
+
+void Checkpointer::checkpoint(const Universe& universe, size_t generation) {
+    CellSnapshot cells;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_error) {
+            std::rethrow_exception(m_error);
+        }
+        std::swap(cells, m_spare);
+    }
+    // the only work done on the simulation's time, the Universe cannot change under it
+    universe.takeSnapshot(cells);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_has_pending) {
+            ++m_superseded_count;
+            std::swap(m_spare, m_pending.cells);
+        }
+        std::swap(m_pending.cells, cells);
+        m_pending.generation = generation;
+        m_has_pending = true;
+    }
+    m_changed.notify_all();
+}
+
+void Checkpointer::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this] { return !m_has_pending && !m_writing; });
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+size_t Checkpointer::writtenCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_written_count;
+}
+
+size_t Checkpointer::supersededCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_superseded_count;
+}
+
+std::filesystem::path Checkpointer::latestPath() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_written.empty() ? std::filesystem::path() : m_written.back();
+}
+
+void Checkpointer::writeLoop() {
+    // on Linux the nice value is per thread, the writer gives way when it shares a core with advance()
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+    Snapshot snapshot;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_changed.wait(lock, [this] { return m_has_pending || m_stopping; });
+        if (!m_has_pending) {
+            return;
+        }
+        std::swap(snapshot, m_pending);
+        m_has_pending = false;
+        m_writing = true;
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+            write(snapshot);
+        }
+        catch (const std::exception&) {
+            error = std::current_exception();
+        }
+        lock.lock();
+        m_writing = false;
+        if (error) {
+            m_error = error;
+        }
+        std::swap(m_spare, snapshot.cells); // handed back for the next snapshot
+        m_changed.notify_all();
+    }
+}
+
+void Checkpointer::write(Snapshot& snapshot) {
+    CellSnapshot& cells = snapshot.cells;
+    cells.normalize();
+    std::string name = "checkpoint_" + std::to_string(snapshot.generation) + ".univ";
+    std::filesystem::path path = m_directory / name;
+    std::filesystem::path temporary_path = m_directory / (name + ".tmp");
+    writeBinaryUniverseFile(temporary_path, cells.rows, cells.cols, cells.flat_positions);
+    syncPath(temporary_path, O_RDONLY);
+    std::filesystem::rename(temporary_path, path);
+    syncPath(m_directory, O_RDONLY | O_DIRECTORY); // makes the rename durable
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_written_count;
+    if (std::find(m_written.begin(), m_written.end(), path) == m_written.end()) {
+        m_written.push_back(path);
+    }
+    while (m_written.size() > m_keep_count) {
+        std::filesystem::remove(m_written.front());
+        m_written.pop_front();
+    }
+}
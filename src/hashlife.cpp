@@ -0,0 +1,698 @@
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "hashlife.hpp"
+#include "pattern_io.hpp"
+
+namespace {
+
+// nodes of up to 16x16 Cells are cheaper to walk than to look up in the summaries
+constexpr uint32_t walked_summary_level = 4;
+
+// base^(2^k), the hash keys of a node's quadrant offsets at every level, including those above the root
+constexpr std::array<uint64_t, 64> makeHashKeyPow2s(uint64_t base) {
+    std::array<uint64_t, 64> powers{};
+    for (size_t k = 0; k < 64; ++k) {
+        powers[k] = base;
+        base *= base;
+    }
+    return powers;
+}
+
+constexpr std::array<uint64_t, 64> row_hash_pow2s = makeHashKeyPow2s(row_hash_base);
+constexpr std::array<uint64_t, 64> col_hash_pow2s = makeHashKeyPow2s(col_hash_base);
+
+inline size_t mixPointer(const void* p, size_t seed) {
+    size_t x = reinterpret_cast<size_t>(p) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    x ^= x >> 31;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 29;
+    return seed ^ x;
+}
+
+}
+
+bool HashLifeUniverse::NodeKey::operator==(const NodeKey& other) const {
+    return nw == other.nw && ne == other.ne && sw == other.sw && se == other.se;
+}
+
+size_t HashLifeUniverse::NodeKeyHash::operator()(const NodeKey& key) const {
+    size_t h = mixPointer(key.nw, 0);
+    h = mixPointer(key.ne, h);
+    h = mixPointer(key.sw, h);
+    return mixPointer(key.se, h);
+}
+
+bool HashLifeUniverse::StepKey::operator==(const StepKey& other) const {
+    return node == other.node && step_log2 == other.step_log2;
+}
+
+size_t HashLifeUniverse::StepKeyHash::operator()(const StepKey& key) const {
+    return mixPointer(key.node, key.step_log2);
+}
+
+HashLifeUniverse::HashLifeUniverse(size_t rows, size_t cols): Universe(rows, cols) {
+    initRoot();
+}
+
+HashLifeUniverse::HashLifeUniverse(const std::filesystem::path& file_path): Universe(file_path) {
+    auto fdata = Universe::parseFile(file_path);
+    m_rows = fdata.rows;
+    m_cols = fdata.cols;
+    initRoot();
+    for (const std::pair<size_t, size_t>& p: fdata.alive_cells_pos) {
+        makeCellAlive(p.first, p.second);
+    }
+}
+
+// the root covers the smallest 2^L square holding the Universe, the rest of it is wall
+void HashLifeUniverse::initRoot() {
+    m_dead_cell = newNode();
+    m_alive_cell = newNode();
+    m_alive_cell->state = CellState::alive;
+    m_alive_cell->population = 1;
+    m_alive_cell->hash = cellHash(0, 0);
+    m_wall_cell = newNode();
+    m_wall_cell->state = CellState::wall;
+    m_empty_nodes = {m_dead_cell};
+    m_wall_nodes = {m_wall_cell};
+    m_root_level = 1;
+    while ((size_t{1} << m_root_level) < std::max(m_rows, m_cols)) {
+        ++m_root_level;
+    }
+    m_root = buildRegion(m_root_level, m_rows, m_cols);
+}
+
+HashLifeUniverse::Node* HashLifeUniverse::newNode() {
+    Node* node;
+    if (!m_free_nodes.empty()) {
+        node = m_free_nodes.back();
+        m_free_nodes.pop_back();
+        *node = Node();
+    }
+    else {
+        node = &m_nodes.emplace_back();
+    }
+    return node;
+}
+
+HashLifeUniverse::Node* HashLifeUniverse::join(Node* nw, Node* ne, Node* sw, Node* se) {
+    NodeKey key{nw, ne, sw, se};
+    auto it = m_node_ids.find(key);
+    if (it != m_node_ids.end()) {
+        return it->second;
+    }
+    Node* node = newNode();
+    node->nw = nw;
+    node->ne = ne;
+    node->sw = sw;
+    node->se = se;
+    node->level = nw->level + 1;
+    node->population = nw->population + ne->population + sw->population + se->population;
+    // the eastern and southern quadrants' keys are those at the origin shifted by half the node
+    uint64_t east = col_hash_pow2s[nw->level];
+    node->hash = nw->hash + east * ne->hash + row_hash_pow2s[nw->level] * (sw->hash + east * se->hash);
+    m_node_ids.emplace(key, node);
+    return node;
+}
+
+HashLifeUniverse::Node* HashLifeUniverse::emptyNode(uint32_t level) {
+    while (m_empty_nodes.size() <= level) {
+        Node* child = m_empty_nodes.back();
+        m_empty_nodes.push_back(join(child, child, child, child));
+    }
+    return m_empty_nodes[level];
+}
+
+HashLifeUniverse::Node* HashLifeUniverse::wallNode(uint32_t level) {
+    while (m_wall_nodes.size() <= level) {
+        Node* child = m_wall_nodes.back();
+        m_wall_nodes.push_back(join(child, child, child, child));
+    }
+    return m_wall_nodes[level];
+}
+
+// rows_left/cols_left: Universe rows/cols remaining from this node's top left corner
+// nodes along an edge repeat, so only O(level) distinct straddling nodes get built
+HashLifeUniverse::Node* HashLifeUniverse::buildRegion(uint32_t level, int64_t rows_left, int64_t cols_left) {
+    int64_t size = int64_t{1} << level;
+    if (rows_left <= 0 || cols_left <= 0) {
+        return wallNode(level);
+    }
+    if (rows_left >= size && cols_left >= size) {
+        return emptyNode(level);
+    }
+    int64_t half = size / 2;
+    return join(buildRegion(level - 1, rows_left, cols_left),
+            buildRegion(level - 1, rows_left, cols_left - half),
+            buildRegion(level - 1, rows_left - half, cols_left),
+            buildRegion(level - 1, rows_left - half, cols_left - half));
+}
+
+HashLifeUniverse::Node* HashLifeUniverse::centeredNode(Node* node) {
+    return join(node->nw->se, node->ne->sw, node->sw->ne, node->se->nw);
+}
+
+// one level up, the node in the middle surrounded by walls
+HashLifeUniverse::Node* HashLifeUniverse::expandWithWalls(Node* node) {
+    Node* wall = wallNode(node->level - 1);
+    return join(join(wall, wall, wall, node->nw),
+            join(wall, wall, node->ne, wall),
+            join(wall, node->sw, wall, wall),
+            join(node->se, wall, wall, wall));
+}
+
+// level 2 node: center 2x2 after one generation
+HashLifeUniverse::Node* HashLifeUniverse::baseStep(Node* node) {
+    Node* quads[2][2] = {{node->nw, node->ne}, {node->sw, node->se}};
+    CellState cells[4][4];
+    for (size_t row = 0; row < 4; ++row) {
+        for (size_t col = 0; col < 4; ++col) {
+            Node* quad = quads[row / 2][col / 2];
+            Node* cell_quads[2][2] = {{quad->nw, quad->ne}, {quad->sw, quad->se}};
+            cells[row][col] = cell_quads[row % 2][col % 2]->state;
+        }
+    }
+    Node* next[2][2];
+    for (size_t row = 1; row < 3; ++row) {
+        for (size_t col = 1; col < 3; ++col) {
+            CellState state = cells[row][col];
+            if (state == CellState::wall) {
+                next[row - 1][col - 1] = m_wall_cell;
+                continue;
+            }
+            size_t alive_count = 0;
+            for (size_t nei_row = row - 1; nei_row <= row + 1; ++nei_row) {
+                for (size_t nei_col = col - 1; nei_col <= col + 1; ++nei_col) {
+                    if (nei_row == row && nei_col == col) {
+                        continue;
+                    }
+                    alive_count += cells[nei_row][nei_col] == CellState::alive ? 1 : 0;
+                }
+            }
+            bool alive = m_rule.nextState(state == CellState::alive, alive_count);
+            next[row - 1][col - 1] = alive ? m_alive_cell : m_dead_cell;
+        }
+    }
+    return join(next[0][0], next[0][1], next[1][0], next[1][1]);
+}
+
+// center half of node after 2^step_log2 generations, step_log2 <= level - 2
+HashLifeUniverse::Node* HashLifeUniverse::successor(Node* node, uint32_t step_log2) {
+    if (node->population == 0) {
+        return centeredNode(node); // nothing alive, dead cells and walls stay as they are
+    }
+    bool full_step = step_log2 == node->level - 2;
+    if (full_step && node->result) {
+        return node->result;
+    }
+    if (!full_step) {
+        auto it = m_partial_steps.find({node, step_log2});
+        if (it != m_partial_steps.end()) {
+            return it->second;
+        }
+    }
+    Node* result = nullptr;
+    if (node->level == 2) {
+        result = baseStep(node);
+    }
+    else {
+        // 9 overlapping sub-squares, each advanced by up to half the step
+        Node* n00 = node->nw;
+        Node* n01 = join(node->nw->ne, node->ne->nw, node->nw->se, node->ne->sw);
+        Node* n02 = node->ne;
+        Node* n10 = join(node->nw->sw, node->nw->se, node->sw->nw, node->sw->ne);
+        Node* n11 = join(node->nw->se, node->ne->sw, node->sw->ne, node->se->nw);
+        Node* n12 = join(node->ne->sw, node->ne->se, node->se->nw, node->se->ne);
+        Node* n20 = node->sw;
+        Node* n21 = join(node->sw->ne, node->se->nw, node->sw->se, node->se->sw);
+        Node* n22 = node->se;
+        uint32_t sub_step = full_step ? step_log2 - 1 : step_log2;
+        Node* c00 = successor(n00, std::min(sub_step, n00->level - 2));
+        Node* c01 = successor(n01, std::min(sub_step, n01->level - 2));
+        Node* c02 = successor(n02, std::min(sub_step, n02->level - 2));
+        Node* c10 = successor(n10, std::min(sub_step, n10->level - 2));
+        Node* c11 = successor(n11, std::min(sub_step, n11->level - 2));
+        Node* c12 = successor(n12, std::min(sub_step, n12->level - 2));
+        Node* c20 = successor(n20, std::min(sub_step, n20->level - 2));
+        Node* c21 = successor(n21, std::min(sub_step, n21->level - 2));
+        Node* c22 = successor(n22, std::min(sub_step, n22->level - 2));
+        if (full_step) {
+            // second half of the step on the 4 overlapping combinations
+            result = join(successor(join(c00, c01, c10, c11), sub_step),
+                    successor(join(c01, c02, c11, c12), sub_step),
+                    successor(join(c10, c11, c20, c21), sub_step),
+                    successor(join(c11, c12, c21, c22), sub_step));
+        }
+        else {
+            // the whole step is already done, only re-center
+            result = join(join(c00->se, c01->sw, c10->ne, c11->nw),
+                    join(c01->se, c02->sw, c11->ne, c12->nw),
+                    join(c10->se, c11->sw, c20->ne, c21->nw),
+                    join(c11->se, c12->sw, c21->ne, c22->nw));
+        }
+    }
+    if (full_step) {
+        node->result = result;
+    }
+    else {
+        m_partial_steps[{node, step_log2}] = result;
+    }
+    return result;
+}
+
+// pad with walls until the step fits, then crop the result back to the root's region
+void HashLifeUniverse::advancePow2(uint32_t step_log2) {
+    Node* root = m_root;
+    while (root->level < std::max(m_root_level + 1, step_log2 + 2)) {
+        root = expandWithWalls(root);
+    }
+    root = successor(root, step_log2);
+    while (root->level > m_root_level) {
+        root = centeredNode(root);
+    }
+    m_root = root;
+    m_generation += uint64_t{1} << step_log2;
+    if (m_node_ids.size() + m_partial_steps.size() > m_gc_threshold) {
+        collectGarbage();
+    }
+}
+
+void HashLifeUniverse::advance() {
+    advancePow2(0);
+}
+
+void HashLifeUniverse::advance(size_t generations) {
+    for (uint32_t step_log2 = 0; generations != 0; ++step_log2, generations >>= 1) {
+        if (generations & 1) {
+            advancePow2(step_log2);
+        }
+    }
+}
+
+HashLifeUniverse::Node* HashLifeUniverse::setCell(Node* node, size_t row, size_t col, CellState state) {
+    if (node->level == 0) {
+        return state == CellState::alive ? m_alive_cell : m_dead_cell;
+    }
+    size_t half = size_t{1} << (node->level - 1);
+    Node* nw = node->nw;
+    Node* ne = node->ne;
+    Node* sw = node->sw;
+    Node* se = node->se;
+    if (row < half) {
+        if (col < half) {
+            nw = setCell(nw, row, col, state);
+        }
+        else {
+            ne = setCell(ne, row, col - half, state);
+        }
+    }
+    else {
+        if (col < half) {
+            sw = setCell(sw, row - half, col, state);
+        }
+        else {
+            se = setCell(se, row - half, col - half, state);
+        }
+    }
+    return join(nw, ne, sw, se);
+}
+
+bool HashLifeUniverse::isCellAlive(size_t row, size_t col) {
+    Node const* node = m_root;
+    while (node->level > 0) {
+        size_t half = size_t{1} << (node->level - 1);
+        if (node->population == 0) {
+            return false;
+        }
+        if (row < half) {
+            node = col < half ? node->nw : node->ne;
+        }
+        else {
+            node = col < half ? node->sw : node->se;
+            row -= half;
+        }
+        col = col < half ? col : col - half;
+    }
+    return node->state == CellState::alive;
+}
+
+void HashLifeUniverse::makeCellAlive(size_t row, size_t col) {
+    m_root = setCell(m_root, row, col, CellState::alive);
+}
+
+void HashLifeUniverse::makeCellDead(size_t row, size_t col) {
+    m_root = setCell(m_root, row, col, CellState::dead);
+}
+
+void HashLifeUniverse::visitAliveCells(Node const* node, size_t top, size_t left, CellVisitor visit) const {
+    if (node->population == 0) {
+        return;
+    }
+    if (node->level == 0) {
+        visit(top, left);
+        return;
+    }
+    size_t half = size_t{1} << (node->level - 1);
+    visitAliveCells(node->nw, top, left, visit);
+    visitAliveCells(node->ne, top, left + half, visit);
+    visitAliveCells(node->sw, top + half, left, visit);
+    visitAliveCells(node->se, top + half, left + half, visit);
+}
+
+void HashLifeUniverse::forEachAliveCell(CellVisitor visit) const {
+    visitAliveCells(m_root, 0, 0, visit);
+}
+
+void HashLifeUniverse::visitAliveCellsIn(Node const* node, size_t top, size_t left, const CellRect& rect,
+        CellVisitor visit) const {
+    size_t size = size_t{1} << node->level;
+    if (node->population == 0 || top >= rect.bottom || left >= rect.right || top + size <= rect.top
+            || left + size <= rect.left) {
+        return;
+    }
+    if (top >= rect.top && left >= rect.left && top + size <= rect.bottom && left + size <= rect.right) {
+        visitAliveCells(node, top, left, visit); // inside, no more clipping
+        return;
+    }
+    size_t half = size / 2; // a level 0 node is either inside or outside
+    visitAliveCellsIn(node->nw, top, left, rect, visit);
+    visitAliveCellsIn(node->ne, top, left + half, rect, visit);
+    visitAliveCellsIn(node->sw, top + half, left, rect, visit);
+    visitAliveCellsIn(node->se, top + half, left + half, rect, visit);
+}
+
+void HashLifeUniverse::forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const {
+    visitAliveCellsIn(m_root, 0, 0, clampRect(rect), visit);
+}
+
+uint64_t HashLifeUniverse::countAliveCellsIn(Node const* node, size_t top, size_t left, const CellRect& rect) const {
+    size_t size = size_t{1} << node->level;
+    if (node->population == 0 || top >= rect.bottom || left >= rect.right || top + size <= rect.top
+            || left + size <= rect.left) {
+        return 0;
+    }
+    if (top >= rect.top && left >= rect.left && top + size <= rect.bottom && left + size <= rect.right) {
+        return node->population;
+    }
+    size_t half = size / 2;
+    return countAliveCellsIn(node->nw, top, left, rect) + countAliveCellsIn(node->ne, top, left + half, rect)
+        + countAliveCellsIn(node->sw, top + half, left, rect) + countAliveCellsIn(node->se, top + half, left + half, rect);
+}
+
+size_t HashLifeUniverse::countAliveIn(const CellRect& rect) const {
+    return countAliveCellsIn(m_root, 0, 0, clampRect(rect));
+}
+
+HashLifeUniverse::NodeSummary HashLifeUniverse::summarize(Node const* node,
+        std::unordered_map<Node const*, NodeSummary>& summaries) const {
+    if (node->population == 0) {
+        return {};
+    }
+    if (node->level <= walked_summary_level) {
+        NodeSummary summary;
+        visitAliveCells(node, 0, 0, [&summary](size_t row, size_t col) {
+            summary.row_sum += row;
+            summary.col_sum += col;
+            summary.bounds.include(row, col);
+        });
+        return summary;
+    }
+    auto it = summaries.find(node);
+    if (it != summaries.end()) {
+        return it->second;
+    }
+    size_t half = size_t{1} << (node->level - 1);
+    NodeSummary summary;
+    auto addChild = [&](Node const* child, size_t top, size_t left) {
+        NodeSummary child_summary = summarize(child, summaries);
+        summary.row_sum += child_summary.row_sum + CellSum{top} * child->population;
+        summary.col_sum += child_summary.col_sum + CellSum{left} * child->population;
+        const CellRect& bounds = child_summary.bounds;
+        summary.bounds.include({bounds.top + top, bounds.left + left, bounds.bottom + top, bounds.right + left});
+    };
+    addChild(node->nw, 0, 0);
+    addChild(node->ne, 0, half);
+    addChild(node->sw, half, 0);
+    addChild(node->se, half, half);
+    summaries.emplace(node, summary);
+    return summary;
+}
+
+// nodes are canonical and only freed by collectGarbage, so an unchanged root pointer is an unchanged Universe
+const HashLifeUniverse::NodeSummary& HashLifeUniverse::rootSummary() const {
+    if (m_summary_root != m_root) {
+        m_root_summary = summarize(m_root, m_summaries);
+        m_summary_root = m_root;
+    }
+    return m_root_summary;
+}
+
+std::pair<double, double> HashLifeUniverse::centroid() const {
+    size_t count = population();
+    if (count == 0) {
+        return {0.0, 0.0};
+    }
+    const NodeSummary& summary = rootSummary();
+    return {static_cast<double>(summary.row_sum) / count, static_cast<double>(summary.col_sum) / count};
+}
+
+CellRect HashLifeUniverse::boundingBox() const {
+    return rootSummary().bounds;
+}
+
+// equal states share one canonical root as long as it is not collected, so comparing addresses compares states
+void HashLifeUniverse::copyState(StateCopy& copy) const {
+    m_root_pins->counts[m_root]++;
+    copy.identity = std::shared_ptr<const void>(m_root, [pins = m_root_pins, root = m_root](const void*) {
+        auto it = pins->counts.find(root);
+        if (--it->second == 0) {
+            pins->counts.erase(it);
+        }
+    });
+}
+
+void HashLifeUniverse::makeAllCellsDead() {
+    m_root = buildRegion(m_root_level, m_rows, m_cols);
+}
+
+void HashLifeUniverse::save(const std::filesystem::path& file_path) const {
+    Universe::save(file_path);
+}
+
+void HashLifeUniverse::load(const std::filesystem::path& file_path) {
+    auto fdata = Universe::parseFile(file_path);
+    if (fdata.rows != m_rows || fdata.cols != m_cols) {
+        throw std::runtime_error("Cannot load a universe with a mismatched size");
+    }
+    makeAllCellsDead();
+    for (const std::pair<size_t, size_t>& p: fdata.alive_cells_pos) {
+        makeCellAlive(p.first, p.second);
+    }
+}
+
+// the Cells in [begin, end) all lie in node, whose top left corner is at (top, left)
+HashLifeUniverse::Node* HashLifeUniverse::insertCells(Node* node, size_t top, size_t left,
+        CellIterator begin, CellIterator end) {
+    if (begin == end) {
+        return node;
+    }
+    if (node == wallNode(node->level)) {
+        throw std::runtime_error("Cell lies outside the universe");
+    }
+    if (node->level == 0) {
+        return m_alive_cell;
+    }
+    size_t half = size_t{1} << (node->level - 1);
+    CellIterator south = std::partition(begin, end, [&](const auto& cell) { return cell.first < top + half; });
+    CellIterator north_east = std::partition(begin, south, [&](const auto& cell) { return cell.second < left + half; });
+    CellIterator south_east = std::partition(south, end, [&](const auto& cell) { return cell.second < left + half; });
+    return join(insertCells(node->nw, top, left, begin, north_east),
+            insertCells(node->ne, top, left + half, north_east, south),
+            insertCells(node->sw, top + half, left, south, south_east),
+            insertCells(node->se, top + half, left + half, south_east, end));
+}
+
+void HashLifeUniverse::insertAliveCells(const std::pair<size_t, size_t>* cells, size_t count) {
+    std::vector<std::pair<size_t, size_t>> batch(cells, cells + count);
+    m_root = insertCells(m_root, 0, 0, batch.begin(), batch.end());
+    if (m_node_ids.size() + m_partial_steps.size() > m_gc_threshold) {
+        collectGarbage();
+    }
+}
+
+// the level node at (top, left) of an 8x8 macrocell leaf
+HashLifeUniverse::Node* HashLifeUniverse::leafNode(uint64_t bits, uint32_t level, size_t top, size_t left) {
+    if (level == 0) {
+        return (bits >> (8 * top + left)) & 1 ? m_alive_cell : m_dead_cell;
+    }
+    size_t half = size_t{1} << (level - 1);
+    return join(leafNode(bits, level - 1, top, left), leafNode(bits, level - 1, top, left + half),
+            leafNode(bits, level - 1, top + half, left), leafNode(bits, level - 1, top + half, left + half));
+}
+
+// dst with the alive Cells of src, a node of the same level over the same region, added
+// empty regions of dst take src's node whole, so shared subtrees stay shared
+HashLifeUniverse::Node* HashLifeUniverse::graft(Node* dst, Node* src,
+        std::unordered_map<NodeKey, Node*, NodeKeyHash>& grafted) {
+    if (src->population == 0) {
+        return dst;
+    }
+    if (dst == emptyNode(dst->level)) {
+        return src;
+    }
+    if (dst == wallNode(dst->level)) {
+        throw std::runtime_error("Pattern does not fit the universe");
+    }
+    if (dst->level == 0) {
+        return m_alive_cell;
+    }
+    NodeKey key{dst, src, nullptr, nullptr};
+    auto it = grafted.find(key);
+    if (it != grafted.end()) {
+        return it->second;
+    }
+    Node* node = join(graft(dst->nw, src->nw, grafted), graft(dst->ne, src->ne, grafted),
+            graft(dst->sw, src->sw, grafted), graft(dst->se, src->se, grafted));
+    grafted.emplace(key, node);
+    return node;
+}
+
+void HashLifeUniverse::insertMacrocell(const MacrocellTree& tree) {
+    std::vector<Node*> nodes(tree.nodes.size());
+    for (size_t index = 0; index < tree.nodes.size(); ++index) {
+        const MacrocellTree::Node& mc_node = tree.nodes[index];
+        if (mc_node.level == 3) {
+            nodes[index] = leafNode(mc_node.leaf_bits, 3, 0, 0);
+            continue;
+        }
+        Node* children[4];
+        for (size_t quad = 0; quad < 4; ++quad) {
+            size_t child = mc_node.children[quad];
+            children[quad] = child == 0 ? emptyNode(mc_node.level - 1) : nodes[child - 1];
+        }
+        nodes[index] = join(children[0], children[1], children[2], children[3]);
+    }
+    Node* src = nodes.empty() ? emptyNode(m_root_level) : nodes.back();
+    // brought to the root's level with its top left corner kept on Cell (0, 0)
+    while (src->level < m_root_level) {
+        Node* empty = emptyNode(src->level);
+        src = join(src, empty, empty, empty);
+    }
+    while (src->level > m_root_level) {
+        if (src->ne->population + src->sw->population + src->se->population != 0) {
+            throw std::runtime_error("Pattern does not fit the universe");
+        }
+        src = src->nw;
+    }
+    std::unordered_map<NodeKey, Node*, NodeKeyHash> grafted;
+    m_root = graft(m_root, src, grafted);
+}
+
+size_t HashLifeUniverse::exportNode(Node const* node, MacrocellTree& tree,
+        std::unordered_map<Node const*, size_t>& indices) const {
+    if (node->population == 0) {
+        return 0;
+    }
+    auto it = indices.find(node);
+    if (it != indices.end()) {
+        return it->second;
+    }
+    MacrocellTree::Node mc_node;
+    mc_node.level = node->level;
+    if (node->level == 3) {
+        visitAliveCells(node, 0, 0, [&mc_node](size_t row, size_t col) {
+            mc_node.leaf_bits |= uint64_t{1} << (8 * row + col);
+        });
+    }
+    else {
+        mc_node.children = {exportNode(node->nw, tree, indices), exportNode(node->ne, tree, indices),
+                exportNode(node->sw, tree, indices), exportNode(node->se, tree, indices)};
+    }
+    tree.nodes.push_back(mc_node);
+    indices.emplace(node, tree.nodes.size());
+    return tree.nodes.size();
+}
+
+MacrocellTree HashLifeUniverse::toMacrocell() const {
+    MacrocellTree tree;
+    tree.rule = m_rule;
+    if (m_root->level < 3) {
+        // a Universe smaller than a leaf is written as one leaf
+        MacrocellTree::Node leaf;
+        visitAliveCells(m_root, 0, 0, [&leaf](size_t row, size_t col) {
+            leaf.leaf_bits |= uint64_t{1} << (8 * row + col);
+        });
+        tree.nodes.push_back(leaf);
+        return tree;
+    }
+    std::unordered_map<Node const*, size_t> indices;
+    if (exportNode(m_root, tree, indices) == 0) {
+        MacrocellTree::Node empty_root;
+        empty_root.level = m_root->level;
+        tree.nodes.push_back(empty_root);
+    }
+    return tree;
+}
+
+void HashLifeUniverse::mark(Node* node) {
+    if (node->marked) {
+        return;
+    }
+    node->marked = true;
+    if (node->level > 0) {
+        mark(node->nw);
+        mark(node->ne);
+        mark(node->sw);
+        mark(node->se);
+    }
+}
+
+// memoized futures were computed under the old rule
+void HashLifeUniverse::setRule(Rule rule) {
+    rejectBirthsFromNothing(rule);
+    Universe::setRule(rule);
+    m_partial_steps.clear();
+    for (auto& [key, node]: m_node_ids) {
+        node->result = nullptr;
+    }
+}
+
+// frees every node not reachable from the root, memoized results into freed nodes are dropped
+void HashLifeUniverse::collectGarbage() {
+    m_summary_root = nullptr;
+    m_summaries.clear();
+    mark(m_root);
+    for (Node* node: m_empty_nodes) {
+        mark(node);
+    }
+    for (Node* node: m_wall_nodes) {
+        mark(node);
+    }
+    for (const auto& [root, count]: m_root_pins->counts) {
+        mark(root);
+    }
+    m_partial_steps.clear();
+    for (auto it = m_node_ids.begin(); it != m_node_ids.end();) {
+        Node* node = it->second;
+        if (!node->marked) {
+            node->result = nullptr;
+            m_free_nodes.push_back(node);
+            it = m_node_ids.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    for (auto& [key, node]: m_node_ids) {
+        if (node->result && !node->result->marked) {
+            node->result = nullptr;
+        }
+    }
+    for (auto& [key, node]: m_node_ids) {
+        node->marked = false;
+    }
+    m_dead_cell->marked = m_alive_cell->marked = m_wall_cell->marked = false;
+    m_gc_threshold = std::max(m_gc_threshold, 2 * m_node_ids.size());
+}
@@ -6,6 +6,7 @@
 #include "universe.hpp"
 #include "cell.hpp"
 #include "animator.hpp"
+#include "trajectory.hpp"
 
 using namespace std::chrono_literals;
 
@@ -20,6 +21,25 @@ void visualizeUniverse(Universe* universe, size_t time_steps) {
     animator->animate(universe, time_steps);
 }
 
+// steps the Universe without drawing it, every generation goes into the trajectory file
+// until the alive Cells repeat, past that the file would only hold the same cycle over again
+void recordUniverse(Universe* universe, size_t time_steps, const std::filesystem::path& trajectory_path) {
+    TrajectoryWriter writer(trajectory_path, *universe);
+    writer.record(*universe);
+    CycleDetector detector;
+    detector.observe(*universe);
+    for (size_t i = 0; i < time_steps; ++i) {
+        universe->advance();
+        writer.record(*universe);
+        StabilityReport report = detector.observe(*universe);
+        if (report.stabilized) {
+            std::cout << "Stabilized at generation " << report.generation << " with period " << report.period << '\n';
+            break;
+        }
+    }
+}
+
+// usage: main [pattern [time_steps [trajectory_file]]]
 int main(int argc, char** argv) {
     std::map<std::string, std::vector<std::pair<int, int>>> pattern_seed {
         {"toad", {{2,2}, {2,3}, {2,4}, {3,1}, {3,2}, {3,3}}},
@@ -62,7 +82,12 @@ int main(int argc, char** argv) {
     else {
         seedUniverse(universe.get(), pattern_seed["gosper_glider"]);
     }
-    visualizeUniverse(universe.get(), time_steps);
+    if (argc > 3) {
+        recordUniverse(universe.get(), time_steps, argv[3]);
+    }
+    else {
+        visualizeUniverse(universe.get(), time_steps);
+    }
     universe->save("universe");
     return 0;
 }
@@ -1,38 +1,164 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
 
 #include "painter.hpp"
 
-GridPainter::GridPainter() {
-    std::cout << m_esc << "?25l" << std::flush; // hide cursor
+namespace {
+
+constexpr char esc[] = "\x1B[";
+
+void appendNumber(std::string& out, size_t value) {
+    char digits[20];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
 }
 
-GridPainter::~GridPainter() {
-    std::cout << m_esc << "?25h" << std::flush; // show cursor
 }
 
-void GridPainter::clear() {
-    std::cout << m_esc << "1J" << std::flush; // clear from cursor to top
+GridPainter::GridPainter(int fd): m_fd(fd) {
+    m_out = std::string(esc) + "?25l"; // hide cursor
+    writeOut();
 }
 
-void GridPainter::shiftCursor(size_t row, size_t col) { // zero based line, col (0, 0) is top left
-    std::cout << m_esc << std::to_string(row + 1) << ";" << std::to_string(col + 1) << "H" << std::flush;
+GridPainter::~GridPainter() {
+    std::string show_cursor = std::string(esc) + "0m" + esc + "?25h";
+    ssize_t ignored = ::write(m_fd, show_cursor.data(), show_cursor.size());
+    (void)ignored; // nothing to do about it here
 }
 
-template <typename T>
-void GridPainter::paint(T cell_char, Color color) {
-    std::string code = m_esc + std::to_string(static_cast<int>(color)) + "m";
-    std::cout << code << cell_char << m_reset_style << std::flush;
+uint32_t GridPainter::packGlyph(char cell_char) {
+    return static_cast<unsigned char>(cell_char);
+}
+
+// for printing multi-byte unicode characters
+uint32_t GridPainter::packGlyph(const char* cell_char) {
+    uint32_t glyph = 0;
+    std::memcpy(&glyph, cell_char, std::min<size_t>(std::strlen(cell_char), sizeof(glyph)));
+    return glyph;
 }
 
 template <typename T>
 void GridPainter::paint(size_t row, size_t col, T cell_char, Color color) {
-    shiftCursor(row, col);
-    paint(cell_char, color);
+    paintCell(row, col, FrameCell{packGlyph(cell_char), color});
 }
 
 template
 void GridPainter::paint<char>(size_t row, size_t col, char cell_char, Color color);
 
-// for printing multi-byte unicode characters
 template
 void GridPainter::paint<const char*>(size_t row, size_t col, const char* cell_char, Color color);
+
+void GridPainter::paintCell(size_t row, size_t col, FrameCell cell) {
+    if (row >= m_rows || col >= m_cols) {
+        resize(std::max(m_rows, row + 1), std::max(m_cols, col + 1));
+    }
+    m_next[row * m_cols + col] = cell;
+    m_painted_rows = std::max(m_painted_rows, row + 1);
+}
+
+void GridPainter::resize(size_t rows, size_t cols) {
+    std::vector<FrameCell> shown(rows * cols);
+    std::vector<FrameCell> next(rows * cols);
+    for (size_t row = 0; row < m_rows; ++row) {
+        std::copy_n(m_shown.begin() + row * m_cols, m_cols, shown.begin() + row * cols);
+        std::copy_n(m_next.begin() + row * m_cols, m_cols, next.begin() + row * cols);
+    }
+    m_shown.swap(shown);
+    m_next.swap(next);
+    m_rows = rows;
+    m_cols = cols;
+}
+
+void GridPainter::clear() {
+    m_clear_pending = true;
+}
+
+void GridPainter::appendCursorMove(size_t row, size_t col) {
+    m_out += esc;
+    appendNumber(m_out, row + 1);
+    m_out += ';';
+    appendNumber(m_out, col + 1);
+    m_out += 'H';
+}
+
+// the cursor moves only where the changed cells are not contiguous and the color is only set when it changes,
+// a blank keeps whatever color is set since it shows none
+void GridPainter::present() {
+    m_out.clear();
+    if (m_clear_pending) {
+        m_out = std::string(esc) + "H" + esc + "2J";
+        std::fill(m_shown.begin(), m_shown.end(), FrameCell{});
+        m_clear_pending = false;
+    }
+    size_t cursor_row = SIZE_MAX;
+    size_t cursor_col = SIZE_MAX;
+    Color current_color = Color::none;
+    bool color_set = false;
+    const FrameCell blank;
+    for (size_t row = 0; row < m_rows; ++row) {
+        FrameCell* shown = m_shown.data() + row * m_cols;
+        FrameCell* next = m_next.data() + row * m_cols;
+        for (size_t col = 0; col < m_cols; ++col) {
+            if (next[col] == shown[col]) {
+                continue;
+            }
+            if (row != cursor_row || col != cursor_col) {
+                appendCursorMove(row, col);
+                cursor_row = row;
+            }
+            if (next[col].glyph != blank.glyph && next[col].color != current_color) {
+                m_out += esc;
+                appendNumber(m_out, static_cast<int>(next[col].color));
+                m_out += 'm';
+                current_color = next[col].color;
+                color_set = true;
+            }
+            uint32_t glyph = next[col].glyph;
+            do {
+                m_out += static_cast<char>(glyph & 0xff);
+                glyph >>= 8;
+            } while (glyph != 0);
+            cursor_col = col + 1;
+            shown[col] = next[col];
+        }
+        std::fill(next, next + m_cols, blank);
+    }
+    if (color_set) {
+        m_out += esc;
+        m_out += "0m";
+    }
+    m_last_frame_bytes = m_out.size();
+    writeOut();
+}
+
+void GridPainter::moveBelowFrame() {
+    m_out.clear();
+    appendCursorMove(m_painted_rows, 0);
+    writeOut();
+}
+
+// a terminal takes the whole buffer in one write, the loop only covers partial writes and signals
+void GridPainter::writeOut() {
+    if (m_out.empty()) {
+        return;
+    }
+    std::cout.flush(); // anything printed before the frame goes first
+    size_t written = 0;
+    while (written < m_out.size()) {
+        ssize_t count = ::write(m_fd, m_out.data() + written, m_out.size() - written);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to write a frame: " + std::string(std::strerror(errno)));
+        }
+        written += count;
+        m_write_count++;
+    }
+    m_bytes_written += written;
+}
@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+#include "pattern_io.hpp"
+#include "hashlife.hpp"
+#include "universe.hpp"
+
+namespace {
+
+// Cells gathered before each Universe::insertAliveCells call
+constexpr size_t insert_batch = 4096;
+
+class CellBatch {
+    public:
+        explicit CellBatch(Universe& universe): m_universe(universe) { m_cells.reserve(insert_batch); }
+        void add(size_t row, size_t col) {
+            if (row >= m_universe.rowCount() || col >= m_universe.colCount()) {
+                throw std::runtime_error("Pattern does not fit the universe");
+            }
+            m_cells.push_back({row, col});
+            if (m_cells.size() == insert_batch) {
+                flush();
+            }
+        }
+        void flush() {
+            m_universe.insertAliveCells(m_cells.data(), m_cells.size());
+            m_cells.clear();
+        }
+    private:
+        Universe& m_universe;
+        std::vector<std::pair<size_t, size_t>> m_cells;
+};
+
+std::string trimmed(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+// "x = 36, y = 9, rule = B3/S23", the first line of an RLE body that is not a comment
+PatternInfo parseRleHeader(const std::string& line) {
+    PatternInfo info;
+    bool has_x = false;
+    bool has_y = false;
+    size_t begin = 0;
+    while (begin <= line.size()) {
+        size_t end = std::min(line.find(',', begin), line.size());
+        std::string field = line.substr(begin, end - begin);
+        size_t equals = field.find('=');
+        if (equals == std::string::npos) {
+            throw std::runtime_error("Invalid RLE header: " + line);
+        }
+        std::string key = trimmed(field.substr(0, equals));
+        std::string value = trimmed(field.substr(equals + 1));
+        try {
+            if (key == "x") {
+                info.cols = std::stoull(value);
+                has_x = true;
+            }
+            else if (key == "y") {
+                info.rows = std::stoull(value);
+                has_y = true;
+            }
+            else if (key == "rule") {
+                info.rule = Rule::parse(value);
+            }
+        }
+        catch (const std::logic_error&) {
+            throw std::runtime_error("Invalid RLE header: " + line);
+        }
+        begin = end + 1;
+    }
+    if (!has_x || !has_y) {
+        throw std::runtime_error("Invalid RLE header: " + line);
+    }
+    return info;
+}
+
+PatternInfo readRleHeaderLine(std::istream& in) {
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string text = trimmed(line);
+        if (!text.empty() && text[0] != '#') {
+            return parseRleHeader(text);
+        }
+    }
+    throw std::runtime_error("Missing RLE header");
+}
+
+// one 8x8 leaf, rows end with '$', trailing dead Cells and trailing empty rows may be left out
+uint64_t parseLeaf(const std::string& line) {
+    uint64_t bits = 0;
+    size_t row = 0;
+    size_t col = 0;
+    for (char c: line) {
+        if (c == '$') {
+            ++row;
+            col = 0;
+            continue;
+        }
+        if ((c != '.' && c != '*') || row >= 8 || col >= 8) {
+            throw std::runtime_error("Invalid macrocell leaf: " + line);
+        }
+        if (c == '*') {
+            bits |= uint64_t{1} << (8 * row + col);
+        }
+        ++col;
+    }
+    return bits;
+}
+
+void writeLeaf(std::ostream& out, uint64_t bits) {
+    std::string line = bits == 0 ? "$" : "";
+    size_t row_count = 8;
+    while (row_count > 0 && ((bits >> (8 * (row_count - 1))) & 0xff) == 0) {
+        --row_count;
+    }
+    for (size_t row = 0; row < row_count; ++row) {
+        uint64_t row_bits = (bits >> (8 * row)) & 0xff;
+        for (size_t col = 0; row_bits >> col; ++col) {
+            line += (row_bits >> col) & 1 ? '*' : '.';
+        }
+        line += '$';
+    }
+    out << line << '\n';
+}
+
+// the far corner of each node's alive Cells from its own top left corner, children before parents
+// so shared subtrees are measured once
+PatternInfo macrocellInfo(const MacrocellTree& tree) {
+    std::vector<std::pair<size_t, size_t>> extents(tree.nodes.size());
+    for (size_t index = 0; index < tree.nodes.size(); ++index) {
+        const MacrocellTree::Node& node = tree.nodes[index];
+        auto& [rows, cols] = extents[index];
+        if (node.level == 3) {
+            for (uint64_t bits = node.leaf_bits; bits != 0; bits &= bits - 1) {
+                size_t bit = __builtin_ctzll(bits);
+                rows = std::max(rows, bit / 8 + 1);
+                cols = std::max(cols, bit % 8 + 1);
+            }
+            continue;
+        }
+        size_t half = size_t{1} << (node.level - 1);
+        for (size_t quad = 0; quad < 4; ++quad) {
+            if (node.children[quad] != 0) {
+                const auto& [child_rows, child_cols] = extents[node.children[quad] - 1];
+                if (child_rows != 0) {
+                    rows = std::max(rows, (quad / 2) * half + child_rows);
+                    cols = std::max(cols, (quad % 2) * half + child_cols);
+                }
+            }
+        }
+    }
+    PatternInfo info;
+    info.rule = tree.rule;
+    if (!extents.empty()) {
+        std::tie(info.rows, info.cols) = extents.back();
+    }
+    return info;
+}
+
+std::string extensionOf(const std::filesystem::path& file_path) {
+    std::string extension = file_path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+            [](unsigned char c) { return std::tolower(c); });
+    if (extension != ".rle" && extension != ".mc") {
+        throw std::runtime_error(file_path.string() + " is not a .rle or .mc file");
+    }
+    return extension;
+}
+
+}
+
+PatternInfo peekRle(std::istream& in) {
+    return readRleHeaderLine(in);
+}
+
+PatternInfo readRle(std::istream& in, Universe& universe) {
+    PatternInfo info = readRleHeaderLine(in);
+    if (info.rule) {
+        universe.setRule(*info.rule);
+    }
+    CellBatch batch(universe);
+    // no run reaches past the Universe, and below this bound the count cannot wrap
+    size_t max_run = std::max(universe.rowCount(), universe.colCount());
+    size_t row = 0;
+    size_t col = 0;
+    size_t count = 0;
+    bool has_count = false;
+    char c;
+    while (in.get(c)) {
+        if (std::isdigit(static_cast<unsigned char>(c))) {
+            count = 10 * count + (c - '0');
+            if (count > max_run) {
+                throw std::runtime_error("RLE run count too large");
+            }
+            has_count = true;
+            continue;
+        }
+        size_t run = has_count ? count : 1;
+        count = 0;
+        has_count = false;
+        if (c == 'b' || c == '.') {
+            col += run;
+        }
+        else if (c == 'o' || c == '*') {
+            for (size_t i = 0; i < run; ++i) {
+                batch.add(row, col++);
+            }
+        }
+        else if (c == '$') {
+            row += run;
+            col = 0;
+        }
+        else if (c == '!') {
+            batch.flush();
+            return info;
+        }
+        else if (c == '#') {
+            std::string comment;
+            std::getline(in, comment);
+        }
+        else if (!std::isspace(static_cast<unsigned char>(c))) {
+            throw std::runtime_error(std::string("Invalid RLE tag: ") + c);
+        }
+    }
+    throw std::runtime_error("RLE pattern does not end with '!'");
+}
+
+MacrocellTree parseMacrocell(std::istream& in) {
+    std::string line;
+    if (!std::getline(in, line) || line.rfind("[M2]", 0) != 0) {
+        throw std::runtime_error("Not a macrocell file");
+    }
+    MacrocellTree tree;
+    while (std::getline(in, line)) {
+        std::string text = trimmed(line);
+        if (text.empty()) {
+            continue;
+        }
+        if (text[0] == '#') {
+            if (text.rfind("#R", 0) == 0) {
+                tree.rule = Rule::parse(trimmed(text.substr(2)));
+            }
+            continue;
+        }
+        MacrocellTree::Node node;
+        if (text[0] == '.' || text[0] == '*' || text[0] == '$') {
+            node.leaf_bits = parseLeaf(text);
+        }
+        else {
+            size_t children[4];
+            int consumed = 0;
+            unsigned level = 0;
+            if (std::sscanf(text.c_str(), "%u %zu %zu %zu %zu%n", &level, &children[0], &children[1],
+                        &children[2], &children[3], &consumed) != 5 || static_cast<size_t>(consumed) != text.size()) {
+                throw std::runtime_error("Invalid macrocell node: " + text);
+            }
+            if (level < 4 || level > 62) {
+                throw std::runtime_error("Unsupported macrocell node level: " + text);
+            }
+            node.level = level;
+            for (size_t quad = 0; quad < 4; ++quad) {
+                size_t child = children[quad];
+                if (child > tree.nodes.size() || (child != 0 && tree.nodes[child - 1].level != level - 1)) {
+                    throw std::runtime_error("Invalid macrocell child: " + text);
+                }
+                node.children[quad] = child;
+            }
+        }
+        tree.nodes.push_back(node);
+    }
+    if (tree.nodes.empty()) {
+        throw std::runtime_error("Macrocell file has no nodes");
+    }
+    return tree;
+}
+
+PatternInfo peekMacrocell(std::istream& in) {
+    return macrocellInfo(parseMacrocell(in));
+}
+
+PatternInfo readMacrocell(std::istream& in, Universe& universe) {
+    MacrocellTree tree = parseMacrocell(in);
+    if (tree.rule) {
+        universe.setRule(*tree.rule);
+    }
+    universe.insertMacrocell(tree);
+    return macrocellInfo(tree);
+}
+
+// sorts the flat positions once, RLE runs need row major order
+void writeRle(std::ostream& out, const Universe& universe) {
+    std::vector<uint64_t> flat_positions;
+    size_t cols = universe.colCount();
+    size_t extent_rows = 0;
+    size_t extent_cols = 0;
+    universe.forEachAliveCell([&](size_t row, size_t col) {
+        flat_positions.push_back(uint64_t{row} * cols + col);
+        extent_rows = std::max(extent_rows, row + 1);
+        extent_cols = std::max(extent_cols, col + 1);
+    });
+    std::sort(flat_positions.begin(), flat_positions.end());
+    out << "x = " << extent_cols << ", y = " << extent_rows << ", rule = " << universe.rule().toString() << '\n';
+    // lines stay within 70 characters
+    size_t line_length = 0;
+    auto emit = [&out, &line_length](size_t run, char tag) {
+        std::string token = (run > 1 ? std::to_string(run) : "") + tag;
+        if (line_length + token.size() > 70) {
+            out << '\n';
+            line_length = 0;
+        }
+        out << token;
+        line_length += token.size();
+    };
+    size_t row = 0;
+    size_t col = 0;
+    for (size_t i = 0; i < flat_positions.size();) {
+        size_t cell_row = flat_positions[i] / cols;
+        size_t cell_col = flat_positions[i] % cols;
+        size_t run = 1;
+        while (i + run < flat_positions.size() && flat_positions[i + run] == flat_positions[i] + run
+                && flat_positions[i + run] / cols == cell_row) {
+            ++run;
+        }
+        if (cell_row > row) {
+            emit(cell_row - row, '$');
+            row = cell_row;
+            col = 0;
+        }
+        if (cell_col > col) {
+            emit(cell_col - col, 'b');
+        }
+        emit(run, 'o');
+        col = cell_col + run;
+        i += run;
+    }
+    out << "!\n";
+}
+
+void writeMacrocell(std::ostream& out, const Universe& universe) {
+    MacrocellTree tree;
+    if (auto hashlife = dynamic_cast<const HashLifeUniverse*>(&universe)) {
+        tree = hashlife->toMacrocell();
+    }
+    else {
+        // the quadtree of any other engine is built by hash consing its Cells in a HashLife Universe
+        HashLifeUniverse copy(universe.rowCount(), universe.colCount());
+        CellBatch batch(copy);
+        universe.forEachAliveCell([&batch](size_t row, size_t col) { batch.add(row, col); });
+        batch.flush();
+        tree = copy.toMacrocell();
+    }
+    out << "[M2] (GameOfLife)\n";
+    out << "#R " << universe.rule().toString() << '\n';
+    for (const MacrocellTree::Node& node: tree.nodes) {
+        if (node.level == 3) {
+            writeLeaf(out, node.leaf_bits);
+        }
+        else {
+            out << node.level << ' ' << node.children[0] << ' ' << node.children[1] << ' '
+                << node.children[2] << ' ' << node.children[3] << '\n';
+        }
+    }
+}
+
+PatternInfo peekPattern(const std::filesystem::path& file_path) {
+    std::string extension = extensionOf(file_path);
+    std::ifstream file(file_path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open pattern file");
+    }
+    return extension == ".rle" ? peekRle(file) : peekMacrocell(file);
+}
+
+PatternInfo loadPattern(const std::filesystem::path& file_path, Universe& universe) {
+    std::string extension = extensionOf(file_path);
+    std::ifstream file(file_path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open pattern file");
+    }
+    return extension == ".rle" ? readRle(file, universe) : readMacrocell(file, universe);
+}
+
+void savePattern(const std::filesystem::path& file_path, const Universe& universe) {
+    std::string extension = extensionOf(file_path);
+    std::ofstream file(file_path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open output file");
+    }
+    if (extension == ".rle") {
+        writeRle(file, universe);
+    }
+    else {
+        writeMacrocell(file, universe);
+    }
+}
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "sorted_universe.hpp"
+
+SortedUniverse::SortedUniverse(size_t rows, size_t cols): Universe(rows, cols) {}
+
+SortedUniverse::SortedUniverse(const std::filesystem::path& file_path): Universe(file_path) {
+    auto fdata = Universe::parseFile(file_path);
+    m_rows = fdata.rows;
+    m_cols = fdata.cols;
+    for (const std::pair<size_t, size_t>& p: fdata.alive_cells_pos) {
+        m_alive_cells.push_back(m_cols * p.first + p.second);
+    }
+    std::sort(m_alive_cells.begin(), m_alive_cells.end());
+    m_alive_cells.erase(std::unique(m_alive_cells.begin(), m_alive_cells.end()), m_alive_cells.end());
+    recountAlive();
+}
+
+bool SortedUniverse::isCellAlive(size_t row, size_t col) {
+    return std::binary_search(m_alive_cells.begin(), m_alive_cells.end(), m_cols * row + col);
+}
+
+void SortedUniverse::makeCellAlive(size_t row, size_t col) {
+    uint64_t flat_pos = m_cols * row + col;
+    if (m_alive_cells.empty() || m_alive_cells.back() < flat_pos) {
+        m_alive_cells.push_back(flat_pos);
+        noteBirth(row, col);
+        return;
+    }
+    auto it = std::lower_bound(m_alive_cells.begin(), m_alive_cells.end(), flat_pos);
+    if (*it != flat_pos) {
+        m_alive_cells.insert(it, flat_pos);
+        noteBirth(row, col);
+    }
+}
+
+void SortedUniverse::insertAliveCells(const std::pair<size_t, size_t>* cells, size_t count) {
+    size_t old_size = m_alive_cells.size();
+    for (size_t i = 0; i < count; ++i) {
+        m_alive_cells.push_back(m_cols * cells[i].first + cells[i].second);
+    }
+    auto tail = m_alive_cells.begin() + old_size;
+    if (!std::is_sorted(tail, m_alive_cells.end())) {
+        std::sort(tail, m_alive_cells.end());
+    }
+    m_alive_cells.erase(std::unique(tail, m_alive_cells.end()), m_alive_cells.end());
+    tail = m_alive_cells.begin() + old_size;
+    // only the Cells of the batch that sort below the last alive one can be alive already
+    for (auto it = tail; it != m_alive_cells.end(); ++it) {
+        if (tail == m_alive_cells.begin() || *it > *(tail - 1) || !std::binary_search(m_alive_cells.begin(), tail, *it)) {
+            noteBirth(*it / m_cols, *it % m_cols);
+        }
+    }
+    // row major batches land after everything already alive and need no merge
+    if (tail != m_alive_cells.begin() && tail != m_alive_cells.end() && *tail <= *(tail - 1)) {
+        std::inplace_merge(m_alive_cells.begin(), tail, m_alive_cells.end());
+        m_alive_cells.erase(std::unique(m_alive_cells.begin(), m_alive_cells.end()), m_alive_cells.end());
+    }
+}
+
+void SortedUniverse::makeCellDead(size_t row, size_t col) {
+    uint64_t flat_pos = m_cols * row + col;
+    auto it = std::lower_bound(m_alive_cells.begin(), m_alive_cells.end(), flat_pos);
+    if (it != m_alive_cells.end() && *it == flat_pos) {
+        m_alive_cells.erase(it);
+        noteDeath(row, col);
+    }
+}
+
+void SortedUniverse::emitNeighbors() {
+    m_neighbor_keys.clear();
+    m_neighbor_keys.reserve(8 * m_alive_cells.size());
+    for (uint64_t flat_pos: m_alive_cells) {
+        size_t row = flat_pos / m_cols;
+        size_t col = flat_pos % m_cols;
+        bool has_west = col > 0;
+        bool has_east = col + 1 < m_cols;
+        if (row > 0) {
+            uint64_t above = flat_pos - m_cols;
+            if (has_west) {
+                m_neighbor_keys.push_back(above - 1);
+            }
+            m_neighbor_keys.push_back(above);
+            if (has_east) {
+                m_neighbor_keys.push_back(above + 1);
+            }
+        }
+        if (has_west) {
+            m_neighbor_keys.push_back(flat_pos - 1);
+        }
+        if (has_east) {
+            m_neighbor_keys.push_back(flat_pos + 1);
+        }
+        if (row + 1 < m_rows) {
+            uint64_t below = flat_pos + m_cols;
+            if (has_west) {
+                m_neighbor_keys.push_back(below - 1);
+            }
+            m_neighbor_keys.push_back(below);
+            if (has_east) {
+                m_neighbor_keys.push_back(below + 1);
+            }
+        }
+    }
+}
+
+// least significant digit first, only as many digits as the largest position needs
+// all digit histograms are taken in one read, and a digit every key shares is skipped
+void SortedUniverse::radixSort() {
+    uint64_t max_key = m_rows * m_cols - 1;
+    size_t digit_count = 0;
+    for (uint64_t rest = max_key; rest != 0; rest >>= radix_bits) {
+        ++digit_count;
+    }
+    m_histograms.assign(digit_count, {});
+    for (uint64_t key: m_neighbor_keys) {
+        for (size_t digit = 0; digit < digit_count; ++digit) {
+            m_histograms[digit][(key >> (digit * radix_bits)) & (bucket_count - 1)]++;
+        }
+    }
+    m_sort_scratch.resize(m_neighbor_keys.size());
+    for (size_t digit = 0; digit < digit_count; ++digit) {
+        std::array<size_t, bucket_count>& offsets = m_histograms[digit];
+        if (std::count(offsets.begin(), offsets.end(), m_neighbor_keys.size()) == 1) {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t& count: offsets) {
+            offset += std::exchange(count, offset);
+        }
+        unsigned shift = digit * radix_bits;
+        for (uint64_t key: m_neighbor_keys) {
+            m_sort_scratch[offsets[(key >> shift) & (bucket_count - 1)]++] = key;
+        }
+        m_neighbor_keys.swap(m_sort_scratch);
+    }
+}
+
+// the run of a position in the sorted neighbor keys is its alive neighbor count,
+// and walking the sorted population alongside tells whether it is alive itself
+// alive cells without a run have no alive neighbors, the walk passes them by
+void SortedUniverse::advance() {
+    m_generation++;
+    if (m_alive_cells.empty()) {
+        return;
+    }
+    emitNeighbors();
+    radixSort();
+    m_next_alive_cells.clear();
+    bool survives_alone = m_rule.nextState(true, 0);
+    auto alive_it = m_alive_cells.begin();
+    for (size_t run_begin = 0, run_end = 0; run_begin < m_neighbor_keys.size(); run_begin = run_end) {
+        uint64_t flat_pos = m_neighbor_keys[run_begin];
+        while (run_end < m_neighbor_keys.size() && m_neighbor_keys[run_end] == flat_pos) {
+            ++run_end;
+        }
+        for (; alive_it != m_alive_cells.end() && *alive_it < flat_pos; ++alive_it) {
+            keepAlone(*alive_it, survives_alone);
+        }
+        bool is_alive = alive_it != m_alive_cells.end() && *alive_it == flat_pos;
+        alive_it += is_alive;
+        bool next_alive = m_rule.nextState(is_alive, run_end - run_begin);
+        if (next_alive) {
+            m_next_alive_cells.push_back(flat_pos);
+        }
+        if (next_alive != is_alive) {
+            if (next_alive) {
+                noteBirth(flat_pos / m_cols, flat_pos % m_cols);
+            }
+            else {
+                noteDeath(flat_pos / m_cols, flat_pos % m_cols);
+            }
+        }
+    }
+    for (; alive_it != m_alive_cells.end(); ++alive_it) {
+        keepAlone(*alive_it, survives_alone);
+    }
+    m_alive_cells.swap(m_next_alive_cells);
+}
+
+// an alive Cell without alive neighbors
+void SortedUniverse::keepAlone(uint64_t flat_pos, bool survives_alone) {
+    if (survives_alone) {
+        m_next_alive_cells.push_back(flat_pos);
+    }
+    else {
+        noteDeath(flat_pos / m_cols, flat_pos % m_cols);
+    }
+}
+
+void SortedUniverse::setRule(Rule rule) {
+    rejectBirthsFromNothing(rule);
+    Universe::setRule(rule);
+}
+
+void SortedUniverse::forEachAliveCell(CellVisitor visit) const {
+    for (uint64_t flat_pos: m_alive_cells) {
+        visit(flat_pos / m_cols, flat_pos % m_cols);
+    }
+}
+
+void SortedUniverse::forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const {
+    auto end = m_alive_cells.end();
+    forEachSortedInRect(m_alive_cells.begin(), end, clampRect(rect), m_cols,
+            [end](std::vector<uint64_t>::const_iterator from, uint64_t flat_pos) {
+                return std::lower_bound(from, end, flat_pos);
+            },
+            [](uint64_t flat_pos) { return flat_pos; }, visit);
+}
+
+void SortedUniverse::takeSnapshot(CellSnapshot& snapshot) const {
+    snapshot.rows = m_rows;
+    snapshot.cols = m_cols;
+    snapshot.words_per_row = 0;
+    snapshot.flat_positions.assign(m_alive_cells.begin(), m_alive_cells.end());
+}
+
+void SortedUniverse::makeAllCellsDead() {
+    m_alive_cells.clear();
+    clearSummary();
+}
+
+void SortedUniverse::save(const std::filesystem::path& file_path) const {
+    Universe::save(file_path);
+}
+
+void SortedUniverse::load(const std::filesystem::path& file_path) {
+    auto fdata = Universe::parseFile(file_path);
+    if (fdata.rows != m_rows || fdata.cols != m_cols) {
+        throw std::runtime_error("Cannot load a universe with a mismatched size");
+    }
+    m_alive_cells.clear();
+    for (const std::pair<size_t, size_t>& p: fdata.alive_cells_pos) {
+        m_alive_cells.push_back(m_cols * p.first + p.second);
+    }
+    std::sort(m_alive_cells.begin(), m_alive_cells.end());
+    m_alive_cells.erase(std::unique(m_alive_cells.begin(), m_alive_cells.end()), m_alive_cells.end());
+    recountAlive();
+}
@@ -0,0 +1,65 @@
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    for (size_t band = 1; band < thread_count; ++band) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this, band);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_ready.notify_all();
+    for (std::thread& worker: m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::runBand(size_t band) {
+    size_t band_count = threadCount();
+    size_t begin = m_count * band / band_count;
+    size_t end = m_count * (band + 1) / band_count;
+    (*m_task)(band, begin, end);
+}
+
+void ThreadPool::parallelFor(size_t count, const BandTask& task) {
+    if (m_workers.empty()) {
+        task(0, 0, count);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_count = count;
+        m_pending = m_workers.size();
+        ++m_round;
+    }
+    m_work_ready.notify_all();
+    runBand(0);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_work_done.wait(lock, [this] { return m_pending == 0; });
+    m_task = nullptr;
+}
+
+void ThreadPool::workerLoop(size_t band) {
+    size_t seen_round = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_ready.wait(lock, [this, seen_round] { return m_stopping || m_round != seen_round; });
+            if (m_stopping) {
+                return;
+            }
+            seen_round = m_round;
+        }
+        runBand(band);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_pending == 0) {
+                m_work_done.notify_one();
+            }
+        }
+    }
+}
@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "bit_kernel_impl.hpp"
+#include "tiled_universe.hpp"
+
+namespace {
+
+template <uint32_t Table>
+void stepTileRows(uint64_t const* west, uint64_t const* center, uint64_t const* east,
+        uint64_t* next_rows, Rule rule) {
+    for (size_t row = 0; row < 64; ++row) {
+        uint64_t west_of[3];
+        uint64_t east_of[3];
+        for (size_t i = 0; i < 3; ++i) {
+            west_of[i] = (center[row + i] << 1) | (west[row + i] >> 63);
+            east_of[i] = (center[row + i] >> 1) | (east[row + i] << 63);
+        }
+        next_rows[row] = nextCellsByRule<uint64_t, Table>(center[row + 1],
+                west_of[0], center[row], east_of[0],
+                west_of[1], east_of[1],
+                west_of[2], center[row + 2], east_of[2],
+                rule.table());
+    }
+}
+
+}
+
+TiledUniverse::TiledUniverse(size_t rows, size_t cols): Universe(rows, cols) {
+    setRule(m_rule);
+    initTiles();
+}
+
+TiledUniverse::TiledUniverse(const std::filesystem::path& file_path): Universe(file_path) {
+    setRule(m_rule);
+    auto fdata = Universe::parseFile(file_path);
+    m_rows = fdata.rows;
+    m_cols = fdata.cols;
+    initTiles();
+    for (const std::pair<size_t, size_t>& p: fdata.alive_cells_pos) {
+        makeCellAlive(p.first, p.second);
+    }
+}
+
+void TiledUniverse::initTiles() {
+    m_tile_rows = (m_rows + tile_size - 1) / tile_size;
+    m_tile_cols = (m_cols + tile_size - 1) / tile_size;
+    size_t tail_cols = m_cols % tile_size;
+    m_last_col_mask = tail_cols == 0 ? ~uint64_t{0} : (uint64_t{1} << tail_cols) - 1;
+    m_last_tile_row_count = m_rows % tile_size == 0 ? tile_size : m_rows % tile_size;
+}
+
+TiledUniverse::Tile* TiledUniverse::findTile(uint64_t key) {
+    auto it = m_tiles.find(key);
+    return it == m_tiles.end() ? nullptr : &it->second;
+}
+
+TiledUniverse::Tile* TiledUniverse::findTile(size_t tile_row, size_t tile_col) {
+    if (tile_row >= m_tile_rows || tile_col >= m_tile_cols) {
+        return nullptr; // also catches -1 wrapped around
+    }
+    return findTile(tileKey(tile_row, tile_col));
+}
+
+TiledUniverse::Tile& TiledUniverse::getOrMakeTile(uint64_t key) {
+    return m_tiles[key];
+}
+
+void TiledUniverse::markChanged(uint64_t key, Tile& tile) {
+    if (!tile.changed) {
+        tile.changed = true;
+        m_changed_tiles.push_back(key);
+    }
+    if (!tile.unsettled) {
+        tile.unsettled = true;
+        m_unsettled_tiles.push_back(key);
+    }
+}
+
+// a key whose tile was freed meanwhile is skipped, freeing a tile already took its summary out
+void TiledUniverse::settleSummary() const {
+    for (uint64_t key: m_unsettled_tiles) {
+        auto it = m_tiles.find(key);
+        if (it == m_tiles.end() || !it->second.unsettled) {
+            continue;
+        }
+        const Tile& tile = it->second;
+        size_t top = (key >> 32) * tile_size;
+        size_t left = (key & 0xffffffff) * tile_size;
+        AliveChanges changes;
+        for (size_t row = 0; row < tile_size; ++row) {
+            changes.births.addWord(top + row, left, tile.rows[row]);
+        }
+        changes.deaths = tile.summary;
+        tile.summary = changes.births;
+        tile.unsettled = false;
+        applyChanges(changes);
+    }
+    m_unsettled_tiles.clear();
+}
+
+bool TiledUniverse::isCellAlive(size_t row, size_t col) {
+    Tile* tile = findTile(row / tile_size, col / tile_size);
+    return tile && ((tile->rows[row % tile_size] >> (col % tile_size)) & 1);
+}
+
+void TiledUniverse::makeCellAlive(size_t row, size_t col) {
+    uint64_t key = tileKey(row / tile_size, col / tile_size);
+    Tile& tile = getOrMakeTile(key);
+    tile.rows[row % tile_size] |= uint64_t{1} << (col % tile_size);
+    markChanged(key, tile);
+}
+
+void TiledUniverse::makeCellDead(size_t row, size_t col) {
+    uint64_t key = tileKey(row / tile_size, col / tile_size);
+    Tile* tile = findTile(key);
+    if (tile) {
+        tile->rows[row % tile_size] &= ~(uint64_t{1} << (col % tile_size));
+        markChanged(key, *tile); // an emptied tile is freed when it is next evaluated
+    }
+}
+
+// next generation of one tile from its own rows and the edges of its 8 neighbors
+// returns false when the tile and all its neighbors are empty, leaving next_rows untouched
+bool TiledUniverse::computeNextRows(uint64_t key, std::array<uint64_t, tile_size>& next_rows) {
+    size_t tile_row = key >> 32;
+    size_t tile_col = key & 0xffffffff;
+    Tile* neighbors[3][3];
+    bool any_tile = false;
+    for (int dr = -1; dr < 2; ++dr) {
+        for (int dc = -1; dc < 2; ++dc) {
+            neighbors[dr + 1][dc + 1] = findTile(tile_row + dr, tile_col + dc);
+            any_tile = any_tile || neighbors[dr + 1][dc + 1];
+        }
+    }
+    if (!any_tile) {
+        return false;
+    }
+    // rows -1..64 of this tile's column band and of the bands to the west and east
+    uint64_t west[tile_size + 2];
+    uint64_t center[tile_size + 2];
+    uint64_t east[tile_size + 2];
+    for (size_t band = 0; band < 3; ++band) {
+        uint64_t* words = band == 0 ? west : (band == 1 ? center : east);
+        Tile* above = neighbors[0][band];
+        Tile* middle = neighbors[1][band];
+        Tile* below = neighbors[2][band];
+        words[0] = above ? above->rows[tile_size - 1] : 0;
+        for (size_t row = 0; row < tile_size; ++row) {
+            words[row + 1] = middle ? middle->rows[row] : 0;
+        }
+        words[tile_size + 1] = below ? below->rows[0] : 0;
+    }
+    m_tile_step(west, center, east, next_rows.data(), m_rule);
+    // no births outside the Universe
+    if (tile_col == m_tile_cols - 1) {
+        for (uint64_t& word: next_rows) {
+            word &= m_last_col_mask;
+        }
+    }
+    if (tile_row == m_tile_rows - 1) {
+        std::fill(next_rows.begin() + m_last_tile_row_count, next_rows.end(), 0);
+    }
+    return true;
+}
+
+void TiledUniverse::advance() {
+    m_generation++;
+    // a tile can only change if it or one of its neighbors changed last generation
+    std::vector<uint64_t> candidates;
+    candidates.reserve(9 * m_changed_tiles.size());
+    for (uint64_t key: m_changed_tiles) {
+        if (Tile* tile = findTile(key)) {
+            tile->changed = false;
+        }
+        size_t tile_row = key >> 32;
+        size_t tile_col = key & 0xffffffff;
+        for (int dr = -1; dr < 2; ++dr) {
+            for (int dc = -1; dc < 2; ++dc) {
+                size_t nei_row = tile_row + dr;
+                size_t nei_col = tile_col + dc;
+                if (nei_row < m_tile_rows && nei_col < m_tile_cols) {
+                    candidates.push_back(tileKey(nei_row, nei_col));
+                }
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    m_changed_tiles.clear();
+
+    // compute every candidate from the current rows before committing any of them
+    std::vector<uint64_t> evaluated;
+    evaluated.reserve(candidates.size());
+    std::array<uint64_t, tile_size> next_rows;
+    for (uint64_t key: candidates) {
+        if (!computeNextRows(key, next_rows)) {
+            continue;
+        }
+        Tile* tile = findTile(key);
+        if (!tile) {
+            bool any_alive = std::any_of(next_rows.begin(), next_rows.end(), [](uint64_t word) { return word != 0; });
+            if (!any_alive) {
+                continue;
+            }
+            tile = &getOrMakeTile(key); // element references survive rehashing
+        }
+        tile->next_rows = next_rows;
+        evaluated.push_back(key);
+    }
+    for (uint64_t key: evaluated) {
+        Tile& tile = m_tiles[key];
+        if (tile.next_rows != tile.rows) {
+            tile.rows = tile.next_rows;
+            markChanged(key, tile);
+        }
+        bool any_alive = std::any_of(tile.rows.begin(), tile.rows.end(), [](uint64_t word) { return word != 0; });
+        if (!any_alive) {
+            applyChanges(AliveChanges{{}, tile.summary});
+            m_tiles.erase(key);
+        }
+    }
+    // freed tiles leave their keys behind, so a long run without queries settles now and then to bound the list
+    if (m_unsettled_tiles.size() > 2 * m_tiles.size() + 64) {
+        settleSummary();
+    }
+}
+
+void TiledUniverse::setRule(Rule rule) {
+    rejectBirthsFromNothing(rule);
+    Universe::setRule(rule);
+    m_tile_step = withRuleTable(rule.table(), [](auto table) -> TileStep {
+        return stepTileRows<decltype(table)::value>;
+    });
+    // every tile may change under the new rule
+    for (auto& [key, tile]: m_tiles) {
+        markChanged(key, tile);
+    }
+}
+
+void TiledUniverse::forEachAliveCell(CellVisitor visit) const {
+    for (const auto& [key, tile]: m_tiles) {
+        size_t top = (key >> 32) * tile_size;
+        size_t left = (key & 0xffffffff) * tile_size;
+        for (size_t row = 0; row < tile_size; ++row) {
+            for (uint64_t bits = tile.rows[row]; bits != 0; bits &= bits - 1) {
+                visit(top + row, left + __builtin_ctzll(bits));
+            }
+        }
+    }
+}
+
+template <typename Visit>
+void TiledUniverse::forEachTileIn(const CellRect& rect, Visit&& visit) const {
+    CellRect clamped = clampRect(rect);
+    if (clamped.empty()) {
+        return;
+    }
+    size_t first_tile_row = clamped.top / tile_size;
+    size_t end_tile_row = (clamped.bottom + tile_size - 1) / tile_size;
+    size_t first_tile_col = clamped.left / tile_size;
+    size_t end_tile_col = (clamped.right + tile_size - 1) / tile_size;
+    auto visitTile = [&](uint64_t key, const Tile& tile) {
+        size_t top = (key >> 32) * tile_size;
+        size_t left = (key & 0xffffffff) * tile_size;
+        size_t first_col = std::max(clamped.left, left) - left;
+        size_t end_col = std::min(clamped.right, left + tile_size) - left;
+        uint64_t col_mask = (end_col == 64 ? ~uint64_t{0} : (uint64_t{1} << end_col) - 1)
+            & ~((uint64_t{1} << first_col) - 1);
+        size_t first_row = std::max(clamped.top, top) - top;
+        size_t end_row = std::min(clamped.bottom, top + tile_size) - top;
+        visit(top, left, tile, first_row, end_row, col_mask);
+    };
+    if ((end_tile_row - first_tile_row) * (end_tile_col - first_tile_col) > m_tiles.size()) {
+        for (const auto& [key, tile]: m_tiles) {
+            size_t tile_row = key >> 32;
+            size_t tile_col = key & 0xffffffff;
+            if (tile_row >= first_tile_row && tile_row < end_tile_row && tile_col >= first_tile_col
+                    && tile_col < end_tile_col) {
+                visitTile(key, tile);
+            }
+        }
+        return;
+    }
+    for (size_t tile_row = first_tile_row; tile_row < end_tile_row; ++tile_row) {
+        for (size_t tile_col = first_tile_col; tile_col < end_tile_col; ++tile_col) {
+            auto it = m_tiles.find(tileKey(tile_row, tile_col));
+            if (it != m_tiles.end()) {
+                visitTile(it->first, it->second);
+            }
+        }
+    }
+}
+
+void TiledUniverse::forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const {
+    forEachTileIn(rect, [visit](size_t top, size_t left, const Tile& tile, size_t first_row, size_t end_row,
+            uint64_t col_mask) {
+        for (size_t row = first_row; row < end_row; ++row) {
+            for (uint64_t bits = tile.rows[row] & col_mask; bits != 0; bits &= bits - 1) {
+                visit(top + row, left + __builtin_ctzll(bits));
+            }
+        }
+    });
+}
+
+size_t TiledUniverse::countAliveIn(const CellRect& rect) const {
+    size_t count = 0;
+    forEachTileIn(rect, [&count](size_t, size_t, const Tile& tile, size_t first_row, size_t end_row,
+            uint64_t col_mask) {
+        for (size_t row = first_row; row < end_row; ++row) {
+            count += __builtin_popcountll(tile.rows[row] & col_mask);
+        }
+    });
+    return count;
+}
+
+void TiledUniverse::makeAllCellsDead() {
+    m_tiles.clear();
+    m_changed_tiles.clear();
+    m_unsettled_tiles.clear();
+    clearSummary();
+}
+
+void TiledUniverse::save(const std::filesystem::path& file_path) const {
+    Universe::save(file_path);
+}
+
+void TiledUniverse::load(const std::filesystem::path& file_path) {
+    auto fdata = Universe::parseFile(file_path);
+    if (fdata.rows != m_rows || fdata.cols != m_cols) {
+        throw std::runtime_error("Cannot load a universe with a mismatched size");
+    }
+    makeAllCellsDead();
+    for (const std::pair<size_t, size_t>& p: fdata.alive_cells_pos) {
+        makeCellAlive(p.first, p.second);
+    }
+}
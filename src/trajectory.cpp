@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+#include "trajectory.hpp"
+#include "universe.hpp"
+#include "varint.hpp"
+
+namespace {
+
+constexpr char trajectory_magic[8] = {'G', 'o', 'L', 'T', 'r', 'a', 'j', '\0'};
+constexpr char index_magic[8] = {'G', 'o', 'L', 'T', 'I', 'd', 'x', '\0'};
+constexpr uint32_t trajectory_version = 1;
+constexpr size_t header_bytes = sizeof(trajectory_magic) + 4 + 4 + 8 + 8 + 4;
+constexpr size_t trailer_bytes = 8 + sizeof(index_magic);
+constexpr uint8_t keyframe_record = 0;
+constexpr uint8_t delta_record = 1;
+constexpr uint8_t index_record = 2;
+
+// the first position absolute, every other one the gap to its predecessor
+void storePositions(std::string& bytes, const std::vector<uint64_t>& flat_positions) {
+    storeVarint(bytes, flat_positions.size());
+    for (size_t i = 0; i < flat_positions.size(); ++i) {
+        storeVarint(bytes, i == 0 ? flat_positions[i] : flat_positions[i] - flat_positions[i - 1]);
+    }
+}
+
+void loadPositions(const char*& cursor, const char* end, std::vector<uint64_t>& flat_positions) {
+    uint64_t count;
+    if (!loadVarint(cursor, end, count) || count > static_cast<uint64_t>(end - cursor)) {
+        throw std::runtime_error("Corrupt trajectory file");
+    }
+    flat_positions.resize(count);
+    uint64_t flat_pos = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t gap;
+        if (!loadVarint(cursor, end, gap) || (i > 0 && gap == 0)) {
+            throw std::runtime_error("Corrupt trajectory file");
+        }
+        flat_pos = i == 0 ? gap : flat_pos + gap;
+        flat_positions[i] = flat_pos;
+    }
+}
+
+void readBytes(std::ifstream& file, char* bytes, size_t count) {
+    if (!file.read(bytes, count)) {
+        throw std::runtime_error("Truncated trajectory file");
+    }
+}
+
+// returns false at the end of the file or on a record cut short
+bool readRecord(std::ifstream& file, uint8_t& kind, std::string& payload) {
+    char kind_byte;
+    if (!file.get(kind_byte)) {
+        return false;
+    }
+    kind = static_cast<uint8_t>(kind_byte);
+    char length_bytes[10];
+    size_t length_size = 0;
+    do {
+        if (length_size == sizeof(length_bytes) || !file.get(length_bytes[length_size])) {
+            return false;
+        }
+    } while (static_cast<uint8_t>(length_bytes[length_size++]) & 0x80);
+    const char* cursor = length_bytes;
+    uint64_t payload_bytes;
+    loadVarint(cursor, length_bytes + length_size, payload_bytes);
+    payload.resize(payload_bytes);
+    return static_cast<bool>(file.read(payload.data(), payload_bytes));
+}
+
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::filesystem::path& file_path, const Universe& universe,
+        size_t keyframe_interval):
+    m_file(file_path, std::ios::out | std::ios::binary | std::ios::trunc), m_keyframe_interval(keyframe_interval) {
+    if (!m_file.is_open()) {
+        throw std::runtime_error("Failed to open trajectory file");
+    }
+    if (keyframe_interval == 0) {
+        throw std::runtime_error("Keyframe interval must be at least 1");
+    }
+    std::string header(trajectory_magic, sizeof(trajectory_magic));
+    storeLittleEndian(header, trajectory_version, 4);
+    storeLittleEndian(header, universe.rule().table(), 4);
+    storeLittleEndian(header, universe.rowCount(), 8);
+    storeLittleEndian(header, universe.colCount(), 8);
+    storeLittleEndian(header, keyframe_interval, 4);
+    m_file.write(header.data(), header.size());
+    m_offset = header.size();
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    try {
+        close();
+    }
+    catch (const std::exception&) {
+        // destructors must not throw, call close() to see the error
+    }
+}
+
+void TrajectoryWriter::writeRecord(uint8_t kind, const std::string& payload) {
+    std::string prefix(1, static_cast<char>(kind));
+    storeVarint(prefix, payload.size());
+    m_file.write(prefix.data(), prefix.size());
+    m_file.write(payload.data(), payload.size());
+    m_offset += prefix.size() + payload.size();
+}
+
+void TrajectoryWriter::record(const Universe& universe) {
+    if (m_closed) {
+        throw std::runtime_error("Trajectory is already closed");
+    }
+    universe.takeSnapshot(m_current);
+    m_current.normalize();
+    std::vector<uint64_t>& current = m_current.flat_positions;
+    std::string payload;
+    bool keyframe = m_generation_count == 0 || m_since_keyframe + 1 >= m_keyframe_interval;
+    if (!keyframe) {
+        std::vector<uint64_t> births;
+        std::vector<uint64_t> deaths;
+        std::set_difference(current.begin(), current.end(), m_previous.begin(), m_previous.end(),
+                std::back_inserter(births));
+        std::set_difference(m_previous.begin(), m_previous.end(), current.begin(), current.end(),
+                std::back_inserter(deaths));
+        keyframe = births.size() + deaths.size() > current.size();
+        if (!keyframe) {
+            storePositions(payload, births);
+            storePositions(payload, deaths);
+            writeRecord(delta_record, payload);
+            ++m_since_keyframe;
+        }
+    }
+    if (keyframe) {
+        m_keyframes.push_back({m_generation_count, m_offset});
+        storePositions(payload, current);
+        writeRecord(keyframe_record, payload);
+        m_since_keyframe = 0;
+    }
+    if (!m_file) {
+        throw std::runtime_error("Failed to write trajectory file");
+    }
+    std::swap(m_previous, current);
+    ++m_generation_count;
+}
+
+void TrajectoryWriter::close() {
+    if (m_closed) {
+        return;
+    }
+    m_closed = true;
+    uint64_t index_offset = m_offset;
+    std::string index(1, static_cast<char>(index_record));
+    storeLittleEndian(index, m_generation_count, 8);
+    storeLittleEndian(index, m_keyframes.size(), 8);
+    for (const auto& [generation, offset]: m_keyframes) {
+        storeLittleEndian(index, generation, 8);
+        storeLittleEndian(index, offset, 8);
+    }
+    storeLittleEndian(index, index_offset, 8);
+    index.append(index_magic, sizeof(index_magic));
+    m_file.write(index.data(), index.size());
+    m_file.close();
+    if (!m_file) {
+        throw std::runtime_error("Failed to write trajectory file");
+    }
+}
+
+TrajectoryReader::TrajectoryReader(const std::filesystem::path& file_path):
+    m_file(file_path, std::ios::in | std::ios::binary) {
+    if (!m_file.is_open()) {
+        throw std::runtime_error("Failed to open trajectory file");
+    }
+    char header[header_bytes];
+    readBytes(m_file, header, header_bytes);
+    if (std::memcmp(header, trajectory_magic, sizeof(trajectory_magic)) != 0) {
+        throw std::runtime_error("Not a trajectory file");
+    }
+    const char* fields = header + sizeof(trajectory_magic);
+    uint32_t version = loadLittleEndian(fields, 4);
+    if (version != trajectory_version) {
+        throw std::runtime_error("Unsupported trajectory file version " + std::to_string(version));
+    }
+    uint32_t table = loadLittleEndian(fields + 4, 4);
+    m_rule = Rule(table & 0x1ff, table >> 9);
+    m_rows = loadLittleEndian(fields + 8, 8);
+    m_cols = loadLittleEndian(fields + 16, 8);
+    buildIndex(std::filesystem::file_size(file_path));
+    if (m_generation_count == 0 || m_keyframes.empty() || m_keyframes.front().first != 0) {
+        throw std::runtime_error("Trajectory file has no generations");
+    }
+}
+
+// from the trailer when the writer was closed, else by walking the records that made it to disk
+void TrajectoryReader::buildIndex(uint64_t file_size) {
+    if (file_size >= header_bytes + trailer_bytes) {
+        char trailer[trailer_bytes];
+        m_file.seekg(file_size - trailer_bytes);
+        readBytes(m_file, trailer, trailer_bytes);
+        uint64_t index_offset = loadLittleEndian(trailer, 8);
+        if (std::memcmp(trailer + 8, index_magic, sizeof(index_magic)) == 0 && index_offset >= header_bytes
+                && index_offset + 17 <= file_size - trailer_bytes) {
+            char fields[17];
+            m_file.seekg(index_offset);
+            readBytes(m_file, fields, sizeof(fields));
+            uint64_t keyframe_count = loadLittleEndian(fields + 9, 8);
+            if (fields[0] != static_cast<char>(index_record)
+                    || keyframe_count != (file_size - trailer_bytes - index_offset - 17) / 16) {
+                throw std::runtime_error("Corrupt trajectory index");
+            }
+            m_generation_count = loadLittleEndian(fields + 1, 8);
+            std::string entries(16 * keyframe_count, '\0');
+            readBytes(m_file, entries.data(), entries.size());
+            for (size_t i = 0; i < keyframe_count; ++i) {
+                m_keyframes.push_back({loadLittleEndian(entries.data() + 16 * i, 8),
+                        loadLittleEndian(entries.data() + 16 * i + 8, 8)});
+                if (m_keyframes.back().second >= index_offset || (i > 0 && m_keyframes[i].first <= m_keyframes[i - 1].first)) {
+                    throw std::runtime_error("Corrupt trajectory index");
+                }
+            }
+            m_records_end = index_offset;
+            return;
+        }
+    }
+    m_file.clear();
+    m_file.seekg(header_bytes);
+    uint64_t offset = header_bytes;
+    uint8_t kind;
+    while (readRecord(m_file, kind, m_payload) && kind != index_record) {
+        if (kind == keyframe_record) {
+            m_keyframes.push_back({m_generation_count, offset});
+        }
+        ++m_generation_count;
+        offset = m_file.tellg();
+    }
+    m_file.clear();
+    m_records_end = offset;
+}
+
+void TrajectoryReader::applyNextRecord() {
+    if (m_next_offset >= m_records_end) {
+        throw std::runtime_error("Truncated trajectory file");
+    }
+    m_file.clear();
+    if (static_cast<uint64_t>(m_file.tellg()) != m_next_offset) {
+        m_file.seekg(m_next_offset);
+    }
+    uint8_t kind;
+    if (!readRecord(m_file, kind, m_payload)) {
+        throw std::runtime_error("Truncated trajectory file");
+    }
+    m_next_offset = m_file.tellg();
+    const char* cursor = m_payload.data();
+    const char* end = cursor + m_payload.size();
+    if (kind == keyframe_record) {
+        loadPositions(cursor, end, m_cells);
+    }
+    else if (kind == delta_record) {
+        std::vector<uint64_t> births;
+        std::vector<uint64_t> deaths;
+        loadPositions(cursor, end, births);
+        loadPositions(cursor, end, deaths);
+        m_scratch.clear();
+        std::set_difference(m_cells.begin(), m_cells.end(), deaths.begin(), deaths.end(), std::back_inserter(m_scratch));
+        if (m_scratch.size() + deaths.size() != m_cells.size()) {
+            throw std::runtime_error("Corrupt trajectory file"); // a death of a Cell that was not alive
+        }
+        m_cells.resize(m_scratch.size() + births.size());
+        std::merge(m_scratch.begin(), m_scratch.end(), births.begin(), births.end(), m_cells.begin());
+    }
+    else {
+        throw std::runtime_error("Corrupt trajectory file");
+    }
+    if (cursor != end) {
+        throw std::runtime_error("Corrupt trajectory file");
+    }
+}
+
+const std::vector<uint64_t>& TrajectoryReader::flatPositionsAt(size_t generation) {
+    if (generation >= m_generation_count) {
+        throw std::runtime_error("Generation " + std::to_string(generation) + " was not recorded");
+    }
+    auto keyframe = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), generation,
+            [](size_t generation, const auto& entry) { return generation < entry.first; }) - 1;
+    // the cached generation is reused when no keyframe lies between it and the one asked for
+    if (!m_has_cells || m_cells_generation > generation || m_cells_generation < keyframe->first) {
+        m_has_cells = false;
+        m_next_offset = keyframe->second;
+        applyNextRecord();
+        m_cells_generation = keyframe->first;
+        m_has_cells = true;
+    }
+    while (m_cells_generation < generation) {
+        applyNextRecord();
+        ++m_cells_generation;
+    }
+    return m_cells;
+}
+
+void TrajectoryReader::restore(size_t generation, Universe& universe) {
+    if (universe.rowCount() != m_rows || universe.colCount() != m_cols) {
+        throw std::runtime_error("Cannot restore a trajectory into a universe of another size");
+    }
+    const std::vector<uint64_t>& flat_positions = flatPositionsAt(generation);
+    if (!flat_positions.empty() && flat_positions.back() / m_cols >= m_rows) {
+        throw std::runtime_error("Corrupt trajectory file");
+    }
+    if (universe.rule() != m_rule) {
+        universe.setRule(m_rule);
+    }
+    universe.makeAllCellsDead();
+    std::vector<std::pair<size_t, size_t>> cells;
+    cells.reserve(flat_positions.size());
+    for (uint64_t flat_pos: flat_positions) {
+        cells.push_back({flat_pos / m_cols, flat_pos % m_cols});
+    }
+    universe.insertAliveCells(cells.data(), cells.size());
+}
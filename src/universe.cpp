@@ -8,6 +8,7 @@
 
 #include "universe.hpp"
 #include "cell.hpp"
+#include "pattern_io.hpp"
 
 
 Universe::Universe(size_t rows, size_t cols): m_rows(rows), m_cols(cols) {
@@ -17,7 +18,96 @@ Universe::Universe(size_t rows, size_t cols): m_rows(rows), m_cols(cols) {
     }
 }
 
-std::array<std::optional<std::pair<size_t, size_t>>, 8>& Universe::getNeighborsPos(size_t row, size_t col) {
+void Universe::setThreadCount(size_t thread_count) {
+    if (thread_count == 0) {
+        throw std::runtime_error("Thread count must be at least 1");
+    }
+    m_thread_pool = thread_count == 1 ? nullptr : std::make_unique<ThreadPool>(thread_count);
+}
+
+void Universe::setRule(Rule rule) {
+    m_rule = rule;
+}
+
+void Universe::setStatsEnabled(bool enabled) {
+    if (enabled && !stats_compiled) {
+        throw std::runtime_error("Stats need a build with GOL_STATS, configure with -DGOL_ENABLE_STATS=ON");
+    }
+    m_stats = enabled ? std::make_unique<StatsRecorder>() : nullptr;
+}
+
+const std::vector<GenerationStats>& Universe::generationStats() const {
+    static const std::vector<GenerationStats> none;
+    return m_stats ? m_stats->generations() : none;
+}
+
+void Universe::insertAliveCells(const std::pair<size_t, size_t>* cells, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        makeCellAlive(cells[i].first, cells[i].second);
+    }
+}
+
+namespace {
+
+// Cells gathered before each insertAliveCells call
+constexpr size_t insert_batch = 4096;
+
+void insertMacrocellCells(Universe& universe, const MacrocellTree& tree, size_t index, size_t top, size_t left,
+        std::vector<std::pair<size_t, size_t>>& cells) {
+    size_t rows = universe.rowCount();
+    size_t cols = universe.colCount();
+    if (index == 0) {
+        return;
+    }
+    if (top >= rows || left >= cols) {
+        throw std::runtime_error("Pattern does not fit the universe");
+    }
+    const MacrocellTree::Node& node = tree.nodes[index - 1];
+    if (node.level == 3) {
+        for (uint64_t bits = node.leaf_bits; bits != 0; bits &= bits - 1) {
+            size_t bit = __builtin_ctzll(bits);
+            if (top + bit / 8 >= rows || left + bit % 8 >= cols) {
+                throw std::runtime_error("Pattern does not fit the universe");
+            }
+            cells.push_back({top + bit / 8, left + bit % 8});
+        }
+        if (cells.size() >= insert_batch) {
+            universe.insertAliveCells(cells.data(), cells.size());
+            cells.clear();
+        }
+        return;
+    }
+    size_t half = size_t{1} << (node.level - 1);
+    insertMacrocellCells(universe, tree, node.children[0], top, left, cells);
+    insertMacrocellCells(universe, tree, node.children[1], top, left + half, cells);
+    insertMacrocellCells(universe, tree, node.children[2], top + half, left, cells);
+    insertMacrocellCells(universe, tree, node.children[3], top + half, left + half, cells);
+}
+
+}
+
+void Universe::makeAllCellsDead() {
+    for (const auto& [row, col]: getAliveCellsPos()) {
+        makeCellDead(row, col);
+    }
+}
+
+// Cells come out in quadtree order, a batch at a time, HashLife overrides this to keep the tree's sharing
+void Universe::insertMacrocell(const MacrocellTree& tree) {
+    std::vector<std::pair<size_t, size_t>> cells;
+    cells.reserve(insert_batch + 64);
+    insertMacrocellCells(*this, tree, tree.nodes.size(), 0, 0, cells);
+    insertAliveCells(cells.data(), cells.size());
+}
+
+void Universe::rejectBirthsFromNothing(Rule rule) {
+    if (rule.birthsFromNothing()) {
+        throw std::runtime_error("Rules with B0 need an engine that keeps dead Cells: " + rule.toString());
+    }
+}
+
+std::array<std::optional<std::pair<size_t, size_t>>, 8>& Universe::getNeighborsPos(size_t row, size_t col,
+        std::array<std::optional<std::pair<size_t, size_t>>, 8>& neighbor_pos) const {
     int64_t row_count = static_cast<int64_t>(m_rows);
     int64_t col_count = static_cast<int64_t>(m_cols);
     size_t nei_idx = 0;
@@ -31,13 +121,13 @@ std::array<std::optional<std::pair<size_t, size_t>>, 8>& Universe::getNeighborsP
             if (nei_row < 0 || nei_row >= row_count || nei_col < 0 || nei_col >= col_count) {
                 continue;
             }
-            m_neighbor_pos[nei_idx++] = {nei_row, nei_col};
+            neighbor_pos[nei_idx++] = {nei_row, nei_col};
         }
     }
     for (; nei_idx < 8; ++nei_idx) {
-        m_neighbor_pos[nei_idx] = std::nullopt;
+        neighbor_pos[nei_idx] = std::nullopt;
     }
-    return m_neighbor_pos;
+    return neighbor_pos;
 }
 
 Universe::Universe(const std::filesystem::path& file_path) {}
@@ -54,130 +144,482 @@ void Universe::save(const std::filesystem::path& file_path) const {
     if (!file.is_open()) {
         throw std::runtime_error("Failed to open output file");
     }
-    const auto& alive_cells = getAliveCellsPos();
-    file << alive_cells.size() << '\n';
-    for (const std::pair<size_t, size_t>& p: alive_cells) {
-        file << p.first << ',' << p.second << '\n';
-    }
+    file << population() << '\n';
+    forEachAliveCell([&file](size_t row, size_t col) { file << row << ',' << col << '\n'; });
     file.close();
 }
 
+void Universe::saveBinary(const std::filesystem::path& file_path) const {
+    std::filesystem::path save_path(file_path);
+    if (save_path.extension() != ".univ") {
+        save_path = save_path.string() + ".univ";
+    }
+    CellSnapshot snapshot;
+    takeSnapshot(snapshot);
+    snapshot.normalize();
+    writeBinaryUniverseFile(save_path, m_rows, m_cols, snapshot.flat_positions);
+}
+
+void Universe::takeSnapshot(CellSnapshot& snapshot) const {
+    snapshot.rows = m_rows;
+    snapshot.cols = m_cols;
+    snapshot.words_per_row = 0;
+    snapshot.flat_positions.clear();
+    forEachAliveCell([this, &snapshot](size_t row, size_t col) {
+        snapshot.flat_positions.push_back(uint64_t{row} * m_cols + col);
+    });
+}
+
+void CellSnapshot::normalize() {
+    if (words_per_row != 0) {
+        flat_positions.clear();
+        for (size_t row = 0; row < rows; ++row) {
+            uint64_t const* row_words = words.data() + row * words_per_row;
+            for (size_t w = 0; w < words_per_row; ++w) {
+                for (uint64_t bits = row_words[w]; bits != 0; bits &= bits - 1) {
+                    flat_positions.push_back(uint64_t{row} * cols + 64 * w + __builtin_ctzll(bits));
+                }
+            }
+        }
+        words_per_row = 0;
+        return; // row major already
+    }
+    if (!std::is_sorted(flat_positions.begin(), flat_positions.end())) {
+        std::sort(flat_positions.begin(), flat_positions.end());
+    }
+}
+
+std::vector<std::pair<size_t, size_t>> Universe::getAliveCellsPos() const {
+    std::vector<std::pair<size_t, size_t>> alive_pos;
+    forEachAliveCell([&alive_pos](size_t row, size_t col) { alive_pos.push_back({row, col}); });
+    return alive_pos;
+}
+
+void Universe::forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const {
+    forEachAliveCell([&rect, visit](size_t row, size_t col) {
+        if (rect.contains(row, col)) {
+            visit(row, col);
+        }
+    });
+}
+
+void Universe::advance(size_t generations) {
+    for (size_t i = 0; i < generations; ++i) {
+        advance();
+    }
+}
+
+size_t Universe::countAliveIn(const CellRect& rect) const {
+    size_t count = 0;
+    forEachAliveCellIn(rect, [&count](size_t, size_t) { count++; });
+    return count;
+}
+
+// the col sum of a word is col times its population plus the sum of its bit indices,
+// and bit k of the indices adds 2^k for every set bit whose index has it
+void AliveSummary::addWord(size_t row, size_t col, uint64_t bits) {
+    static constexpr uint64_t index_bit_masks[6] = {0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL, 0xf0f0f0f0f0f0f0f0ULL,
+            0xff00ff00ff00ff00ULL, 0xffff0000ffff0000ULL, 0xffffffff00000000ULL};
+    if (bits == 0) {
+        return;
+    }
+    size_t count = __builtin_popcountll(bits);
+    size_t index_sum = 0;
+    for (size_t k = 0; k < 6; ++k) {
+        index_sum += static_cast<size_t>(__builtin_popcountll(bits & index_bit_masks[k])) << k;
+    }
+    population += count;
+    row_sum += CellSum{row} * count;
+    col_sum += CellSum{col} * count + index_sum;
+    bounds.include(row, col + __builtin_ctzll(bits));
+    bounds.include(row, col + 63 - __builtin_clzll(bits));
+    uint64_t word_hash = 0;
+    for (; bits != 0; bits &= bits - 1) {
+        word_hash += col_hash_powers[0][__builtin_ctzll(bits)];
+    }
+    hash += cellHash(row, col) * word_hash;
+}
+
+// deaths lie inside the bounds, so they only loosen an edge they reach
+void Universe::applyChanges(const AliveChanges& changes) const {
+    m_population += changes.births.population;
+    m_population -= changes.deaths.population;
+    m_row_sum += changes.births.row_sum - changes.deaths.row_sum;
+    m_col_sum += changes.births.col_sum - changes.deaths.col_sum;
+    m_hash += changes.births.hash - changes.deaths.hash;
+    if (!changes.deaths.bounds.empty()) {
+        m_bounds_loose = m_bounds_loose || onBoundsEdge(changes.deaths.bounds);
+    }
+    m_bounds.include(changes.births.bounds);
+    if (m_population == 0) {
+        m_bounds = {};
+        m_bounds_loose = false;
+    }
+}
+
+void Universe::recountAlive() {
+    clearSummary();
+    forEachAliveCell([this](size_t row, size_t col) { noteBirth(row, col); });
+}
+
+void Universe::clearSummary() {
+    m_population = 0;
+    m_row_sum = 0;
+    m_col_sum = 0;
+    m_hash = 0;
+    m_bounds = {};
+    m_bounds_loose = false;
+}
+
+StabilityReport Universe::advanceDetectingCycles(size_t generations, CycleAction on_cycle) {
+    CycleDetector detector;
+    for (size_t done = 0;; ++done) {
+        StabilityReport report = detector.observe(*this);
+        if (report.stabilized) {
+            if (on_cycle == CycleAction::fast_forward) {
+                size_t rest = generations - done;
+                advance(rest % report.period);
+                m_generation += rest - rest % report.period;
+            }
+            return report;
+        }
+        if (done == generations) {
+            return report;
+        }
+        advance();
+    }
+}
+
+std::pair<double, double> Universe::centroid() const {
+    settleSummary();
+    if (m_population == 0) {
+        return {0.0, 0.0};
+    }
+    return {static_cast<double>(m_row_sum) / m_population, static_cast<double>(m_col_sum) / m_population};
+}
+
+CellRect Universe::boundingBox() const {
+    settleSummary();
+    if (m_bounds_loose) {
+        tightenBounds(m_bounds);
+        m_bounds_loose = false;
+    }
+    return m_bounds;
+}
+
+// never empty here, bounds only goes loose while a Cell is alive in it
+void Universe::tightenBounds(CellRect& bounds) const {
+    while (countAliveIn({bounds.top, bounds.left, bounds.top + 1, bounds.right}) == 0) {
+        bounds.top++;
+    }
+    while (countAliveIn({bounds.bottom - 1, bounds.left, bounds.bottom, bounds.right}) == 0) {
+        bounds.bottom--;
+    }
+    while (countAliveIn({bounds.top, bounds.left, bounds.bottom, bounds.left + 1}) == 0) {
+        bounds.left++;
+    }
+    while (countAliveIn({bounds.top, bounds.right - 1, bounds.bottom, bounds.right}) == 0) {
+        bounds.right--;
+    }
+}
+
+CellRect Universe::scanBounds() const {
+    CellRect bounds;
+    forEachAliveCell([&bounds](size_t row, size_t col) { bounds.include(row, col); });
+    return bounds;
+}
+
+CellRect Universe::clampRect(const CellRect& rect) const {
+    return {rect.top, rect.left, std::min(rect.bottom, m_rows), std::min(rect.right, m_cols)};
+}
+
+// either .univ format, binary chunks are decoded on the thread pool when there is one
 UniverseFileData Universe::parseFile(const std::filesystem::path& file_path) {
     if (file_path.extension().string() != ".univ") {
         throw std::runtime_error(file_path.string() + " is not a .univ file");
     }
-    std::ifstream file(file_path, std::ios::in);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open universe file");
-    }
-    std::string header;
-    file >> header;
-    if (header != "GameOfLifeUniverse") {
-        throw std::runtime_error("Not a valid universe file");
-    }
-    size_t rows, cols;
-    file >> rows >> cols;
-    size_t alive_count;
-    file >> alive_count;
-    std::vector<std::pair<size_t, size_t>> alive_cells_pos;
-    for (size_t i = 0; i < alive_count; ++i) {
-        std::string pos;
-        file >> pos;
-        auto n = pos.find(",");
-        size_t row = std::stoi(pos.substr(0, n));
-        size_t col = std::stoi(pos.substr(n + 1, pos.size() - n - 1));
-        alive_cells_pos.push_back({row, col});
-    }
-    file.close();
-    return {rows, cols, alive_cells_pos}; // TODO will this move or copy?
+    return readUniverseFile(file_path, m_thread_pool.get());
 }
 
 
-DenseUniverse::DenseUniverse(size_t rows, size_t cols): Universe(rows, cols) {}
-
-DenseUniverse::DenseUniverse(const std::filesystem::path& file_path): Universe(file_path) {}
+void Universe::copyState(StateCopy& copy) const {
+    takeSnapshot(copy.cells);
+    copy.identity = nullptr;
+}
 
-std::array<std::optional<Cell*>, 8>& DenseUniverse::getNeighbors(const Cell& cell) {
-    size_t nei_idx = 0;
-    for (const auto& pos: getNeighborsPos(cell.row(), cell.col())) {
-        if (pos.has_value()) {
-            const auto& [row, col] = pos.value();
-            m_neighbors[nei_idx++] = getCurrentGridCell(row, col);
+bool StateCopy::sameState(StateCopy& other) {
+    if (identity || other.identity) {
+        return identity == other.identity;
+    }
+    cells.normalize();
+    other.cells.normalize();
+    return cells.rows == other.cells.rows && cells.cols == other.cells.cols
+        && cells.flat_positions == other.cells.flat_positions;
+}
+
+// the oldest entry is only dropped after the match, so a period of exactly history_size is still found
+StabilityReport CycleDetector::observe(const Universe& universe) {
+    uint64_t hash = universe.stateHash();
+    universe.copyState(m_current);
+    if (const uint64_t* index = m_seen.find(hash)) {
+        Entry& earlier = m_recent[*index % m_recent.size()];
+        if (m_current.sameState(earlier.state)) {
+            return {true, earlier.generation, universe.generation() - earlier.generation};
         }
-        else {
-            m_neighbors[nei_idx++] = std::nullopt;
+    }
+    Entry& entry = m_recent[m_observed % m_recent.size()];
+    if (m_observed >= m_recent.size()) {
+        const uint64_t* index = m_seen.find(entry.hash);
+        if (index && *index == m_observed - m_recent.size()) {
+            m_seen.erase(entry.hash);
         }
     }
-    return m_neighbors;
+    entry.hash = hash;
+    entry.generation = universe.generation();
+    std::swap(entry.state, m_current);
+    m_seen[hash] = m_observed;
+    m_observed++;
+    return {};
+}
+
+void CycleDetector::clear() {
+    m_seen = FlatHashMap<uint64_t>();
+    for (Entry& entry: m_recent) {
+        entry.state.identity = nullptr; // lets go of HashLife roots
+    }
+    m_current.identity = nullptr;
+    m_observed = 0;
 }
 
+
+DenseUniverse::DenseUniverse(size_t rows, size_t cols): Universe(rows, cols) {}
+
+DenseUniverse::DenseUniverse(const std::filesystem::path& file_path): Universe(file_path) {}
+
 bool DenseUniverse::isCellAlive(size_t row, size_t col) {
     return getCurrentGridCell(row, col)->isAlive();
 }
 
 void DenseUniverse::makeCellAlive(size_t row, size_t col) {
     getCurrentGridCell(row, col)->makeAlive();
+    m_activity.markChanged(row / tile_size, col / tile_size);
 }
 
 void DenseUniverse::makeCellDead(size_t row, size_t col) {
     getCurrentGridCell(row, col)->makeDead();
+    m_activity.markChanged(row / tile_size, col / tile_size);
 }
 
-void DenseUniverse::advance() {
-    for (size_t row = 0; row < m_rows; row++) {
-        for (size_t col = 0; col < m_cols; col++) {
-            Cell* cell = getCurrentGridCell(row, col);
-            size_t alive_count = 0;
-            for (std::optional<Cell*> neighbor: getNeighbors(*cell)) {
-                if (!neighbor.has_value()) {
-                    continue;
+void DenseUniverse::initTiles() {
+    m_activity.reset((m_rows + tile_size - 1) / tile_size, (m_cols + tile_size - 1) / tile_size);
+    m_tile_summaries.assign(m_activity.tileRows() * m_activity.tileCols(), AliveSummary{});
+}
+
+// every tile starts unsettled, and a tile's cells only change along with its activity flag
+void DenseUniverse::settleSummary() const {
+    m_activity.takeUnsettled([this](size_t tile_row, size_t tile_col) {
+        AliveChanges changes;
+        for (size_t row = tile_row * tile_size; row < std::min(m_rows, (tile_row + 1) * tile_size); ++row) {
+            for (size_t col = tile_col * tile_size; col < std::min(m_cols, (tile_col + 1) * tile_size); ++col) {
+                if (getCurrentGridCell(row, col)->isAlive()) {
+                    changes.birth(row, col);
                 }
-                alive_count = neighbor.value()->isAlive() ? alive_count + 1: alive_count;
             }
-            if (cell->isAlive()) {
-                if (alive_count < 2 || alive_count > 3) {
-                    getNextGridCell(row,col)->makeDead();
-                }
-                else {
-                    getNextGridCell(row,col)->makeAlive();
-                }
+        }
+        AliveSummary& settled = m_tile_summaries[tile_row * m_activity.tileCols() + tile_col];
+        changes.deaths = settled;
+        settled = changes.births;
+        applyChanges(changes);
+    });
+}
+
+// every tile only reads the current grid and writes its own cells of the next one,
+// so bands of tile rows run in parallel with the same result as the serial loop
+void DenseUniverse::advance() {
+    m_generation++;
+    GOL_STATS_ONLY(GenerationStats* stats = beginGenerationStats();)
+    if (m_topology == Topology::torus) {
+        wrapGhostBorder();
+        wrapActivity();
+    }
+    GOL_STATS_ONLY(uint64_t stencil_start_ns = stats ? statsNowNs() : 0;)
+    GOL_STATS_ONLY(m_band_counts.assign(threadCount(), StepCounts{});)
+    if (m_thread_pool) {
+        m_thread_pool->parallelFor(m_activity.tileRows(), [this](size_t band, size_t begin_tile_row, size_t end_tile_row) {
+            advanceTileRows(begin_tile_row, end_tile_row, band);
+        });
+    }
+    else {
+        advanceTileRows(0, m_activity.tileRows(), 0);
+    }
+    GOL_STATS_ONLY(uint64_t activity_start_ns = stats ? statsNowNs() : 0;)
+    m_activity.swap();
+    GOL_STATS_ONLY(uint64_t swap_start_ns = stats ? statsNowNs() : 0;)
+    m_grid_1_is_current = !m_grid_1_is_current;
+    GOL_STATS_ONLY(if (stats) { finishStats(*stats, stencil_start_ns, activity_start_ns, swap_start_ns); })
+}
+
+// the torus wrap before the stencil and the activity swap after it count as the frontier pass
+void DenseUniverse::finishStats(GenerationStats& stats, uint64_t stencil_start_ns, uint64_t activity_start_ns,
+        uint64_t swap_start_ns) {
+    stats.swap_ns = statsNowNs() - swap_start_ns;
+    stats.neighbor_ns = activity_start_ns - stencil_start_ns;
+    stats.frontier_ns = stencil_start_ns - stats.start_ns + swap_start_ns - activity_start_ns;
+    for (const StepCounts& counts: m_band_counts) {
+        stats.births += counts.births;
+        stats.deaths += counts.deaths;
+        stats.frontier_cells += counts.cells;
+    }
+    stats.live_cells = population();
+}
+
+void DenseUniverse::advanceTileRows(size_t begin_tile_row, size_t end_tile_row, [[maybe_unused]] size_t band) {
+    StepCounts counts;
+    for (size_t tile_row = begin_tile_row; tile_row < end_tile_row; ++tile_row) {
+        if (!m_activity.startTileRow(tile_row)) {
+            continue;
+        }
+        for (size_t tile_col = 0; tile_col < m_activity.tileCols(); ++tile_col) {
+            bool changed = false;
+            if (m_activity.isActive(tile_row, tile_col)) {
+                changed = advanceRect(tile_row * tile_size, std::min(m_rows, (tile_row + 1) * tile_size),
+                        tile_col * tile_size, std::min(m_cols, (tile_col + 1) * tile_size), counts);
+            }
+            m_activity.setNextChanged(tile_row, tile_col, changed);
+        }
+    }
+    GOL_STATS_ONLY(m_band_counts[band] = counts;)
+}
+
+// the ghost border makes every Cell an interior one, so the stencil has no edge cases
+bool DenseUniverse::advanceRect(size_t begin_row, size_t end_row, size_t begin_col, size_t end_col,
+        [[maybe_unused]] StepCounts& counts) {
+    size_t stride = rowStride();
+    bool changed = false;
+    GOL_STATS_ONLY(counts.cells += (end_row - begin_row) * (end_col - begin_col);)
+    for (size_t row = begin_row; row < end_row; row++) {
+        // padded rows, Cell col sits at index col + 1
+        Cell const* current = getCurrentGrid() + (row + 1) * stride;
+        Cell const* above = current - stride;
+        Cell const* below = current + stride;
+        Cell* next = getNextGrid() + (row + 1) * stride;
+        for (size_t c = begin_col + 1; c <= end_col; c++) {
+            size_t alive_count = above[c - 1].isAlive() + above[c].isAlive() + above[c + 1].isAlive()
+                + current[c - 1].isAlive() + current[c + 1].isAlive()
+                + below[c - 1].isAlive() + below[c].isAlive() + below[c + 1].isAlive();
+            bool alive = current[c].isAlive();
+            bool next_alive = m_rule.nextState(alive, alive_count);
+            if (next_alive) {
+                next[c].makeAlive();
             }
             else {
-                if (alive_count == 3) {
-                    getNextGridCell(row,col)->makeAlive();
-                }
-                else {
-                    getNextGridCell(row,col)->makeDead();
-                }
+                next[c].makeDead();
             }
+            GOL_STATS_ONLY(counts.births += next_alive && !alive; counts.deaths += alive && !next_alive;)
+            changed = changed || next_alive != alive;
         }
     }
+    return changed;
+}
 
-    m_grid_1_is_current = !m_grid_1_is_current;
+void DenseUniverse::wrapGhostBorder() {
+    size_t stride = rowStride();
+    Cell* grid = getCurrentGrid();
+    for (size_t row = 1; row <= m_rows; ++row) {
+        grid[row * stride] = grid[row * stride + m_cols];
+        grid[row * stride + m_cols + 1] = grid[row * stride + 1];
+    }
+    // whole padded rows, so the corners come along
+    std::copy_n(grid + m_rows * stride, stride, grid);
+    std::copy_n(grid + stride, stride, grid + (m_rows + 1) * stride);
 }
 
-std::vector<std::pair<size_t, size_t>> DenseUniverse::getAliveCellsPos() const {
-    std::vector<std::pair<size_t, size_t>> alive_pos;
+void DenseUniverse::wrapActivity() {
+    size_t last_row = m_activity.tileRows() - 1;
+    size_t last_col = m_activity.tileCols() - 1;
+    for (size_t tile_col = 0; tile_col <= last_col; ++tile_col) {
+        if (m_activity.isChanged(0, tile_col)) {
+            m_activity.markChanged(last_row, tile_col);
+        }
+        if (m_activity.isChanged(last_row, tile_col)) {
+            m_activity.markChanged(0, tile_col);
+        }
+    }
+    for (size_t tile_row = 0; tile_row <= last_row; ++tile_row) {
+        if (m_activity.isChanged(tile_row, 0)) {
+            m_activity.markChanged(tile_row, last_col);
+        }
+        if (m_activity.isChanged(tile_row, last_col)) {
+            m_activity.markChanged(tile_row, 0);
+        }
+    }
+    // the corners also touch diagonally
+    if (m_activity.isChanged(0, 0) || m_activity.isChanged(last_row, last_col)) {
+        m_activity.markChanged(0, 0);
+        m_activity.markChanged(last_row, last_col);
+    }
+    if (m_activity.isChanged(0, last_col) || m_activity.isChanged(last_row, 0)) {
+        m_activity.markChanged(0, last_col);
+        m_activity.markChanged(last_row, 0);
+    }
+}
+
+// a bounded Universe needs the ghost border of both grids dead again
+void DenseUniverse::setTopology(Topology topology) {
+    m_topology = topology;
+    if (topology == Topology::bounded) {
+        size_t stride = rowStride();
+        for (Cell* grid: {getCurrentGrid(), getNextGrid()}) {
+            for (size_t col = 0; col < stride; ++col) {
+                grid[col].makeDead();
+                grid[(m_rows + 1) * stride + col].makeDead();
+            }
+            for (size_t row = 1; row <= m_rows; ++row) {
+                grid[row * stride].makeDead();
+                grid[row * stride + m_cols + 1].makeDead();
+            }
+        }
+    }
+    m_activity.markAllChanged();
+}
+
+void DenseUniverse::forEachAliveCell(CellVisitor visit) const {
     for (size_t row = 0; row < m_rows; row++) {
         for (size_t col = 0; col < m_cols; col++) {
             if (getCurrentGridCell(row, col)->isAlive()) {
-                alive_pos.push_back({row, col});
+                visit(row, col);
+            }
+        }
+    }
+}
+
+// the grid is its own index, only the rows and cols of rect are read
+void DenseUniverse::forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const {
+    CellRect clamped = clampRect(rect);
+    for (size_t row = clamped.top; row < clamped.bottom; row++) {
+        for (size_t col = clamped.left; col < clamped.right; col++) {
+            if (getCurrentGridCell(row, col)->isAlive()) {
+                visit(row, col);
             }
         }
     }
-    return alive_pos;
 }
 
 void DenseUniverse::save(const std::filesystem::path& file_path) const {
     Universe::save(file_path);
 }
 
-void DenseUniverse::load(const std::filesystem::path& file_path) {
+void DenseUniverse::makeAllCellsDead() {
     for (size_t row = 0; row < m_rows; ++row) {
         for (size_t col = 0; col < m_cols; ++col) {
             getCurrentGridCell(row, col)->makeDead();
         }
     }
+    m_activity.markAllChanged();
+}
+
+void DenseUniverse::load(const std::filesystem::path& file_path) {
+    makeAllCellsDead();
     auto fdata = Universe::parseFile(file_path);
     if (fdata.rows != m_rows || fdata.cols != m_cols) {
         throw std::runtime_error("Cannot load a universe with a mismatched size");
@@ -187,6 +629,12 @@ void DenseUniverse::load(const std::filesystem::path& file_path) {
     }
 }
 
+// quiet tiles were only quiet under the old rule
+void DenseUniverse::setRule(Rule rule) {
+    Universe::setRule(rule);
+    m_activity.markAllChanged();
+}
+
 
 DenseUniverseV1::DenseUniverseV1(size_t rows, size_t cols): DenseUniverse(rows, cols) {
     initCells();
@@ -218,8 +666,8 @@ void DenseUniverseV1::advance() {
     DenseUniverse::advance();
 }
 
-std::vector<std::pair<size_t, size_t>> DenseUniverseV1::getAliveCellsPos() const {
-    return DenseUniverse::getAliveCellsPos();
+void DenseUniverseV1::forEachAliveCell(CellVisitor visit) const {
+    DenseUniverse::forEachAliveCell(visit);
 }
 
 void DenseUniverseV1::save(const std::filesystem::path& file_path) const {
@@ -231,32 +679,40 @@ void DenseUniverseV1::load(const std::filesystem::path& file_path) {
 }
 
 void DenseUniverseV1::initCells() {
+    size_t stride = rowStride();
+    m_cell_grid_1.assign((m_rows + 2) * stride, Cell());
+    m_cell_grid_2.assign((m_rows + 2) * stride, Cell());
     for (size_t row = 0; row < m_rows; ++row) {
-        std::vector<Cell> cell_row_1;
-        std::vector<Cell> cell_row_2;
         for (size_t col = 0; col < m_cols; ++col) {
-            cell_row_1.emplace_back(row, col, m_cols * row + col, false);
-            cell_row_2.emplace_back(row, col, m_cols * row + col, false);
+            m_cell_grid_1[(row + 1) * stride + col + 1] = Cell(row, col, m_cols * row + col, false);
+            m_cell_grid_2[(row + 1) * stride + col + 1] = Cell(row, col, m_cols * row + col, false);
         }
-        m_cell_grid_1.push_back(std::move(cell_row_1));
-        m_cell_grid_2.push_back(std::move(cell_row_2));
     }
+    initTiles();
+}
+
+Cell* DenseUniverseV1::getCurrentGrid() {
+    return m_grid_1_is_current ? m_cell_grid_1.data() : m_cell_grid_2.data();
+}
+
+Cell const* DenseUniverseV1::getCurrentGrid() const {
+    return m_grid_1_is_current ? m_cell_grid_1.data() : m_cell_grid_2.data();
 }
 
-std::array<std::optional<Cell*>, 8>& DenseUniverseV1::getNeighbors(const Cell& cell) {
-    return DenseUniverse::getNeighbors(cell);
+Cell* DenseUniverseV1::getNextGrid() {
+    return m_grid_1_is_current ? m_cell_grid_2.data() : m_cell_grid_1.data();
 }
 
 Cell* DenseUniverseV1::getCurrentGridCell(size_t row, size_t col) {
-    return m_grid_1_is_current ? &m_cell_grid_1[row][col] : &m_cell_grid_2[row][col];
+    return getCurrentGrid() + (row + 1) * rowStride() + col + 1;
 }
 
 Cell const* DenseUniverseV1::getCurrentGridCell(size_t row, size_t col) const {
-    return m_grid_1_is_current ? &m_cell_grid_1[row][col] : &m_cell_grid_2[row][col];
+    return getCurrentGrid() + (row + 1) * rowStride() + col + 1;
 }
 
 Cell* DenseUniverseV1::getNextGridCell(size_t row, size_t col) {
-    return m_grid_1_is_current ? &m_cell_grid_2[row][col] : &m_cell_grid_1[row][col];
+    return getNextGrid() + (row + 1) * rowStride() + col + 1;
 }
 
 
@@ -271,53 +727,255 @@ bool SparseUniverse::isCellAlive(size_t row, size_t col) {
 void SparseUniverse::makeCellAlive(size_t row, size_t col) {
     if (!findAliveCellByPos(row, col)) {
         makeAndInsertAliveCell(row, col);
+        noteBirth(row, col);
     }
 }
 
 void SparseUniverse::makeCellDead(size_t row, size_t col) {
-    deleteCell(row, col);
+    if (findAliveCellByPos(row, col)) {
+        deleteCell(row, col);
+        noteDeath(row, col);
+    }
 }
 
 void SparseUniverse::advance() {
+    m_generation++;
     // frontier: cells that are 8-connected adjacent to alive cells
     // only the frontier cells can come alive in the next generation
     // track how many alive neighbors each frontier cell has
+    GOL_STATS_ONLY(GenerationStats* stats = beginGenerationStats();)
+    GOL_STATS_ONLY(uint64_t lookups = 0; uint64_t births = 0;)
+    GOL_STATS_ONLY(uint64_t population = stats ? aliveCellCount() : 0;)
+    if (m_thread_pool && aliveCellCount() >= min_parallel_population) {
+        advanceParallel();
+        GOL_STATS_ONLY(uint64_t swap_start_ns = stats ? statsNowNs() : 0;)
+        swapBuffers();
+        GOL_STATS_ONLY(if (stats) { finishStats(*stats, population, swap_start_ns); })
+        return;
+    }
+    m_band_starts[1 - m_current_side].clear();
     clearNextBuffer();
-    std::unordered_map<size_t, size_t> frontier_hit_count;
-    for (Cell* cell: getAliveCells()) {
+    m_frontier_hit_count.clear();
+    std::array<std::optional<std::pair<size_t, size_t>>, 8> neighbor_pos;
+    forEachCurrentCell([&](Cell& cell) {
         size_t alive_count = 0;
-        for (const auto& pos: getNeighborsPos(cell->row(), cell->col())) {
+        for (const auto& pos: getNeighborsPos(cell.row(), cell.col(), neighbor_pos)) {
             if (!pos.has_value()) {
                 continue;
             }
             const auto& [nei_row, nei_col] = pos.value();
+            GOL_STATS_ONLY(lookups++;)
             if (!findAliveCellByPos(nei_row, nei_col)) {
-                frontier_hit_count[{m_cols * nei_row + nei_col}]++;
+                m_frontier_hit_count[m_cols * nei_row + nei_col]++;
             }
             else {
                 alive_count++;
             }
         }
-        if (alive_count == 2 || alive_count == 3) {
-            makeAndInsertNextAliveCell(cell->row(), cell->col());
+        if (m_rule.nextState(true, alive_count)) {
+            makeAndInsertNextAliveCell(cell.row(), cell.col());
+        }
+        else {
+            noteDeath(cell.row(), cell.col());
+        }
+    });
+    GOL_STATS_ONLY(uint64_t frontier_start_ns = stats ? statsNowNs() : 0;)
+
+    m_frontier_hit_count.forEach([&](uint64_t flat_pos, uint8_t alive_count) {
+        if (m_rule.nextState(false, alive_count)) {
+            GOL_STATS_ONLY(births++;)
+            makeAndInsertNextAliveCell(flat_pos / m_cols, flat_pos % m_cols);
+            noteBirth(flat_pos / m_cols, flat_pos % m_cols);
+        }
+    });
+    GOL_STATS_ONLY(uint64_t swap_start_ns = stats ? statsNowNs() : 0;)
+    swapBuffers();
+    GOL_STATS_ONLY(if (stats) {
+        stats->neighbor_ns = frontier_start_ns - stats->start_ns;
+        stats->frontier_ns = swap_start_ns - frontier_start_ns;
+        stats->births = births;
+        stats->frontier_cells = m_frontier_hit_count.size();
+        stats->lookups = lookups;
+        finishStats(*stats, population, swap_start_ns);
+    })
+}
+
+// the rest of stats once the buffers are swapped, every Cell of the new generation was allocated into it
+void SparseUniverse::finishStats(GenerationStats& stats, uint64_t population, uint64_t swap_start_ns) {
+    stats.swap_ns = statsNowNs() - swap_start_ns;
+    stats.live_cells = aliveCellCount();
+    stats.deaths = population + stats.births - stats.live_cells;
+    stats.allocations = stats.live_cells;
+}
+
+// same step as the serial loop, split by row bands:
+// 1. the alive cells are split into one band of rows per thread with about equal population, the bands
+//    the last parallel step left while they still are, else the alive cells are partitioned anew
+// 2. each thread counts the neighbors of its cells, frontier hits go into a shard owned by the band
+//    holding the frontier cell's row, so hits across a band border land in the neighboring band's shard
+// 3. each thread merges the shards of its own band, picks the births and inserts them and the band's
+//    survivors into the band's own container of the next buffer, so no two threads share one
+void SparseUniverse::advanceParallel() {
+    size_t band_count = m_thread_pool->threadCount();
+    size_t next_side = 1 - m_current_side;
+    std::vector<std::vector<Cell*>> band_cells; // empty while the current bands are used as they are
+    if (bandsBalanced(band_count)) {
+        m_band_starts[next_side] = m_band_starts[m_current_side];
+    }
+    else {
+        std::vector<Cell*> alive_cells = getAliveCells();
+        std::vector<size_t> rows;
+        rows.reserve(alive_cells.size());
+        for (Cell* cell: alive_cells) {
+            rows.push_back(cell->row());
+        }
+        std::vector<size_t> band_starts; // first row of bands 1..band_count - 1
+        for (size_t band = 1; band < band_count; ++band) {
+            auto nth = rows.begin() + rows.size() * band / band_count;
+            std::nth_element(rows.begin(), nth, rows.end());
+            band_starts.push_back(*nth);
+        }
+        std::sort(band_starts.begin(), band_starts.end());
+        m_band_starts[next_side] = std::move(band_starts);
+        band_cells.resize(band_count);
+        for (Cell* cell: alive_cells) {
+            band_cells[bandOf(next_side, cell->row())].push_back(cell);
+        }
+    }
+    clearNextBuffer();
+
+    // m_frontier_shards[band][owner]: hits found by band on cells owned by owner
+    m_frontier_shards.resize(band_count);
+    for (std::vector<FlatHashMap<uint8_t>>& shards: m_frontier_shards) {
+        shards.resize(band_count);
+        for (FlatHashMap<uint8_t>& shard: shards) {
+            shard.clear();
+        }
+    }
+    std::vector<std::vector<std::pair<size_t, size_t>>> survivors(band_count);
+    std::vector<AliveChanges> band_changes(band_count);
+    GOL_STATS_ONLY(std::vector<uint64_t> band_lookups(band_count);)
+    m_thread_pool->parallelFor(band_count, [&](size_t band, size_t, size_t) {
+        std::array<std::optional<std::pair<size_t, size_t>>, 8> neighbor_pos;
+        GOL_STATS_ONLY(uint64_t lookups = 0;)
+        auto countNeighbors = [&](Cell& cell) {
+            size_t alive_count = 0;
+            for (const auto& pos: getNeighborsPos(cell.row(), cell.col(), neighbor_pos)) {
+                if (!pos.has_value()) {
+                    continue;
+                }
+                const auto& [nei_row, nei_col] = pos.value();
+                GOL_STATS_ONLY(lookups++;)
+                if (!findAliveCellByPos(nei_row, nei_col)) {
+                    m_frontier_shards[band][bandOf(next_side, nei_row)][m_cols * nei_row + nei_col]++;
+                }
+                else {
+                    alive_count++;
+                }
+            }
+            if (m_rule.nextState(true, alive_count)) {
+                survivors[band].push_back({cell.row(), cell.col()});
+            }
+            else {
+                band_changes[band].death(cell.row(), cell.col());
+            }
+        };
+        if (band_cells.empty()) {
+            forEachCurrentCellInBand(band, countNeighbors);
+        }
+        else {
+            for (Cell* cell: band_cells[band]) {
+                countNeighbors(*cell);
+            }
+        }
+        GOL_STATS_ONLY(band_lookups[band] = lookups;)
+    });
+    GOL_STATS_ONLY(GenerationStats* stats = currentGenerationStats();)
+    GOL_STATS_ONLY(uint64_t frontier_start_ns = stats ? statsNowNs() : 0;)
+
+    GOL_STATS_ONLY(std::vector<size_t> band_births(band_count);)
+    m_thread_pool->parallelFor(band_count, [&](size_t owner, size_t, size_t) {
+        FlatHashMap<uint8_t>& merged = m_frontier_shards[0][owner];
+        for (size_t band = 1; band < band_count; ++band) {
+            m_frontier_shards[band][owner].forEach([&merged](uint64_t flat_pos, uint8_t hit_count) {
+                merged[flat_pos] += hit_count;
+            });
         }
+        for (const auto& [row, col]: survivors[owner]) {
+            makeAndInsertNextAliveCell(row, col);
+        }
+        merged.forEach([&](uint64_t flat_pos, uint8_t alive_count) {
+            if (m_rule.nextState(false, alive_count)) {
+                GOL_STATS_ONLY(band_births[owner]++;)
+                makeAndInsertNextAliveCell(flat_pos / m_cols, flat_pos % m_cols);
+                band_changes[owner].birth(flat_pos / m_cols, flat_pos % m_cols);
+            }
+        });
+    });
+
+    for (size_t band = 0; band < band_count; ++band) {
+        applyChanges(band_changes[band]);
     }
+    GOL_STATS_ONLY(if (stats) {
+        stats->frontier_ns = statsNowNs() - frontier_start_ns;
+        stats->neighbor_ns = frontier_start_ns - stats->start_ns;
+        for (size_t band = 0; band < band_count; ++band) {
+            stats->lookups += band_lookups[band];
+            stats->births += band_births[band];
+            stats->frontier_cells += m_frontier_shards[0][band].size();
+        }
+    })
+}
 
-    for (const auto& [flat_pos, alive_count]: frontier_hit_count) {
-        if (alive_count != 3) {
-            continue;
+// rebuilds both buffers on the new memory resources and moves the alive Cells over
+void SparseUniverse::setArenasEnabled(bool enabled) {
+    auto alive_cells_pos = getAliveCellsPos();
+    for (PingPongArena& arenas: m_arenas) {
+        arenas.setEnabled(enabled);
+    }
+    resetBuffer(0);
+    resetBuffer(1);
+    for (const std::pair<size_t, size_t>& p: alive_cells_pos) {
+        makeAndInsertAliveCell(p.first, p.second);
+    }
+}
+
+// a band may grow to twice its share before the step partitions the cells anew
+bool SparseUniverse::bandsBalanced(size_t band_count) const {
+    if (bandCount(m_current_side) != band_count) {
+        return false;
+    }
+    size_t population = aliveCellCount();
+    for (size_t band = 0; band < band_count; ++band) {
+        if (currentBandSize(band) * band_count > 2 * population) {
+            return false;
         }
-        size_t row = flat_pos / m_cols;
-        size_t col = flat_pos % m_cols;
-        makeAndInsertNextAliveCell(row, col);
     }
-    swapBuffers();
+    return true;
+}
+
+std::pmr::memory_resource* SparseUniverse::resetBandArena(size_t side, size_t band) {
+    while (m_arenas.size() <= band) {
+        m_arenas.emplace_back().setEnabled(arenasEnabled());
+    }
+    m_arenas[band].reset(side);
+    return m_arenas[band].resource(side);
+}
+
+void SparseUniverse::setRule(Rule rule) {
+    rejectBirthsFromNothing(rule);
+    Universe::setRule(rule);
 }
 
 void SparseUniverse::save(const std::filesystem::path& file_path) const {
     Universe::save(file_path);
 }
 
+void SparseUniverse::makeAllCellsDead() {
+    clearBuffer();
+    clearSummary();
+}
+
 void SparseUniverse::load(const std::filesystem::path& file_path) {
     clearBuffer();
     auto fdata = Universe::parseFile(file_path);
@@ -327,11 +985,17 @@ void SparseUniverse::load(const std::filesystem::path& file_path) {
     for (const std::pair<size_t, size_t>& p: fdata.alive_cells_pos) {
         makeAndInsertAliveCell(p.first, p.second);
     }
+    recountAlive();
 }
 
-SparseUniverseV1::SparseUniverseV1(size_t rows, size_t cols): SparseUniverse(rows, cols) {}
+SparseUniverseV1::SparseUniverseV1(size_t rows, size_t cols): SparseUniverse(rows, cols) {
+    resetBuffer(0);
+    resetBuffer(1);
+}
 
 SparseUniverseV1::SparseUniverseV1(const std::filesystem::path& file_path): SparseUniverse(file_path) {
+    resetBuffer(0);
+    resetBuffer(1);
     auto fdata = Universe::parseFile(file_path);
     m_rows = fdata.rows;
     m_cols = fdata.cols;
@@ -340,6 +1004,15 @@ SparseUniverseV1::SparseUniverseV1(const std::filesystem::path& file_path): Spar
         size_t col = p.second;
         makeAndInsertAliveCell(row, col);
     }
+    recountAlive();
+}
+
+SparseUniverseV1::~SparseUniverseV1() {
+    for (std::vector<CellSet>& side: m_cell_sets) {
+        for (CellSet& cells: side) {
+            freeCells(cells);
+        }
+    }
 }
 
 bool SparseUniverseV1::isCellAlive(size_t row, size_t col) {
@@ -354,54 +1027,99 @@ void SparseUniverseV1::makeCellDead(size_t row, size_t col) {
     SparseUniverse::makeCellDead(row, col);
 }
 
-std::set<std::unique_ptr<Cell>>::iterator SparseUniverseV1::findAliveCellIterByPos(size_t row, size_t col) {
-    size_t target = m_cols * row + col;
-    auto it = std::lower_bound(m_alive_cells.begin(), m_alive_cells.end(), target,
-            [](const std::unique_ptr<Cell>& a, size_t flat_pos) {
-                return  a->flatPos() < flat_pos;
-            });
-    return it;
-}
-
 Cell* SparseUniverseV1::findAliveCellByPos(size_t row, size_t col) {
-    auto it = findAliveCellIterByPos(row, col);
-    size_t target = m_cols * row + col;
-    if (it == m_alive_cells.end() || (*it)->flatPos() > target) {
+    CellSet& cells = aliveCells(row);
+    auto it = cells.find(m_cols * row + col);
+    if (it == cells.end()) {
         return nullptr;
     }
-    return it->get();
+    return *it;
 }
 
-std::vector<std::pair<size_t, size_t>> SparseUniverseV1::getAliveCellsPos() const {
-    std::vector<std::pair<size_t, size_t>> alive_pos;
-    for (const std::unique_ptr<Cell>& cell: m_alive_cells) {
-        alive_pos.push_back({cell->row(), cell->col()});
+void SparseUniverseV1::forEachAliveCell(CellVisitor visit) const {
+    for (const CellSet& cells: m_cell_sets[m_current_side]) {
+        for (const Cell* cell: cells) {
+            visit(cell->row(), cell->col());
+        }
+    }
+}
+
+// each set is ordered by flat position, so each row of rect is a contiguous stretch of the set of its band
+void SparseUniverseV1::forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const {
+    for (const CellSet& cells: m_cell_sets[m_current_side]) {
+        forEachSortedInRect(cells.begin(), cells.end(), clampRect(rect), m_cols,
+                [&cells](CellSet::const_iterator, uint64_t flat_pos) { return cells.lower_bound(flat_pos); },
+                [](const Cell* cell) { return cell->flatPos(); }, visit);
     }
-    return alive_pos;
 }
 
 std::vector<Cell*> SparseUniverseV1::getAliveCells() {
-    std::vector<Cell*> cells;
-    for (const std::unique_ptr<Cell>& p: m_alive_cells) {
-        cells.push_back(p.get());
+    std::vector<Cell*> alive_cells;
+    alive_cells.reserve(aliveCellCount());
+    for (const CellSet& cells: m_cell_sets[m_current_side]) {
+        alive_cells.insert(alive_cells.end(), cells.begin(), cells.end());
+    }
+    return alive_cells;
+}
+
+void SparseUniverseV1::forEachCurrentCell(FunctionRef<void(Cell& cell)> visit) {
+    for (CellSet& cells: m_cell_sets[m_current_side]) {
+        for (Cell* cell: cells) {
+            visit(*cell);
+        }
+    }
+}
+
+void SparseUniverseV1::forEachCurrentCellInBand(size_t band, FunctionRef<void(Cell& cell)> visit) {
+    for (Cell* cell: m_cell_sets[m_current_side][band]) {
+        visit(*cell);
+    }
+}
+
+size_t SparseUniverseV1::currentBandSize(size_t band) const {
+    return m_cell_sets[m_current_side][band].size();
+}
+
+size_t SparseUniverseV1::aliveCellCount() const {
+    size_t count = 0;
+    for (const CellSet& cells: m_cell_sets[m_current_side]) {
+        count += cells.size();
     }
-    return cells;
+    return count;
 }
 
 void SparseUniverseV1::makeAndInsertAliveCell(size_t row, size_t col) {
-    auto cell = std::make_unique<Cell>(row, col, m_cols * row + col, true);
-    m_alive_cells.insert(std::move(cell));
+    insertCell(aliveCells(row), row, col);
 }
 
 void SparseUniverseV1::makeAndInsertNextAliveCell(size_t row, size_t col) {
-    auto cell = std::make_unique<Cell>(row, col, m_cols * row + col, true);
-    m_next_alive_cells.insert(std::move(cell));
+    insertCell(nextAliveCells(row), row, col);
+}
+
+// the Cell comes from the same memory resource as the set's nodes
+void SparseUniverseV1::insertCell(CellSet& cells, size_t row, size_t col) {
+    std::pmr::polymorphic_allocator<Cell> alloc = cells.get_allocator();
+    Cell* cell = new (alloc.allocate(1)) Cell(row, col, m_cols * row + col, true);
+    if (!cells.insert(cell).second) {
+        alloc.deallocate(cell, 1);
+    }
+}
+
+// frees nothing while the arena is on, it is reset as a whole
+void SparseUniverseV1::freeCells(CellSet& cells) {
+    std::pmr::polymorphic_allocator<Cell> alloc = cells.get_allocator();
+    for (Cell* cell: cells) {
+        alloc.deallocate(cell, 1);
+    }
 }
 
 void SparseUniverseV1::deleteCell(size_t row, size_t col) {
-    auto it = findAliveCellIterByPos(row, col);
-    if (it != m_alive_cells.end()) {
-        m_alive_cells.erase(it);
+    CellSet& cells = aliveCells(row);
+    auto it = cells.find(m_cols * row + col);
+    if (it != cells.end()) {
+        std::pmr::polymorphic_allocator<Cell> alloc = cells.get_allocator();
+        alloc.deallocate(*it, 1);
+        cells.erase(it);
     }
 }
 
@@ -410,15 +1128,25 @@ void SparseUniverseV1::advance() {
 }
 
 void SparseUniverseV1::swapBuffers() {
-    std::swap(m_alive_cells, m_next_alive_cells);
+    m_current_side = 1 - m_current_side;
 }
 
 void SparseUniverseV1::clearBuffer() {
-    m_alive_cells.clear();
+    resetBuffer(m_current_side);
 }
 
 void SparseUniverseV1::clearNextBuffer() {
-    m_next_alive_cells.clear();
+    resetBuffer(1 - m_current_side);
+}
+
+void SparseUniverseV1::resetBuffer(size_t side) {
+    for (CellSet& cells: m_cell_sets[side]) {
+        freeCells(cells);
+    }
+    m_cell_sets[side].clear();
+    for (size_t band = 0; band < bandCount(side); ++band) {
+        m_cell_sets[side].emplace_back(resetBandArena(side, band));
+    }
 }
 
 void SparseUniverseV1::save(const std::filesystem::path& file_path) const {
@@ -429,15 +1157,21 @@ void SparseUniverseV1::load(const std::filesystem::path& file_path) {
     SparseUniverse::load(file_path);
 }
 
-SparseUniverseV2::SparseUniverseV2(size_t rows, size_t cols): SparseUniverse(rows, cols) {}
+SparseUniverseV2::SparseUniverseV2(size_t rows, size_t cols): SparseUniverse(rows, cols) {
+    resetBuffer(0);
+    resetBuffer(1);
+}
 
 SparseUniverseV2::SparseUniverseV2(const std::filesystem::path& file_path): SparseUniverse(file_path) {
+    resetBuffer(0);
+    resetBuffer(1);
     auto fdata = Universe::parseFile(file_path);
     m_rows = fdata.rows;
     m_cols = fdata.cols;
     for (const std::pair<size_t, size_t>& p: fdata.alive_cells_pos) {
         makeAndInsertAliveCell(p.first, p.second);
     }
+    recountAlive();
 }
 
 bool SparseUniverseV2::isCellAlive(size_t row, size_t col) {
@@ -453,9 +1187,9 @@ void SparseUniverseV2::makeCellDead(size_t row, size_t col) {
 }
 
 Cell* SparseUniverseV2::findAliveCellByPos(size_t row, size_t col) {
-    size_t flat_pos = m_cols * row + col;
-    auto it = m_alive_cells.find(flat_pos);
-    if (it == m_alive_cells.end()) {
+    CellMap& cells = aliveCells(row);
+    auto it = cells.find(m_cols * row + col);
+    if (it == cells.end()) {
         return nullptr;
     }
     return &it->second;
@@ -466,48 +1200,112 @@ void SparseUniverseV2::advance() {
 }
 
 std::vector<Cell*> SparseUniverseV2::getAliveCells() {
-    std::vector<Cell*> cells;
-    for (auto it = m_alive_cells.begin(); it != m_alive_cells.end(); ++it) {
-        cells.push_back(&(it->second));
+    std::vector<Cell*> alive_cells;
+    alive_cells.reserve(aliveCellCount());
+    for (CellMap& cells: m_cell_maps[m_current_side]) {
+        for (auto& [flat_pos, cell]: cells) {
+            alive_cells.push_back(&cell);
+        }
     }
-    return cells;
+    return alive_cells;
+}
+
+void SparseUniverseV2::forEachCurrentCell(FunctionRef<void(Cell& cell)> visit) {
+    for (CellMap& cells: m_cell_maps[m_current_side]) {
+        for (auto& [flat_pos, cell]: cells) {
+            visit(cell);
+        }
+    }
+}
+
+void SparseUniverseV2::forEachCurrentCellInBand(size_t band, FunctionRef<void(Cell& cell)> visit) {
+    for (auto& [flat_pos, cell]: m_cell_maps[m_current_side][band]) {
+        visit(cell);
+    }
+}
+
+size_t SparseUniverseV2::currentBandSize(size_t band) const {
+    return m_cell_maps[m_current_side][band].size();
+}
+
+size_t SparseUniverseV2::aliveCellCount() const {
+    size_t count = 0;
+    for (const CellMap& cells: m_cell_maps[m_current_side]) {
+        count += cells.size();
+    }
+    return count;
 }
 
 void SparseUniverseV2::makeAndInsertAliveCell(size_t row, size_t col) {
     size_t flat_pos = m_cols * row + col;
-    m_alive_cells.emplace(flat_pos, Cell(row, col, flat_pos, true));
+    aliveCells(row).emplace(flat_pos, Cell(row, col, flat_pos, true));
 }
 
 void SparseUniverseV2::makeAndInsertNextAliveCell(size_t row, size_t col) {
     size_t flat_pos = m_cols * row + col;
-    m_next_alive_cells.emplace(flat_pos, Cell(row, col, flat_pos, true));
+    nextAliveCells(row).emplace(flat_pos, Cell(row, col, flat_pos, true));
 }
 
 void SparseUniverseV2::deleteCell(size_t row, size_t col) {
-    auto it = m_alive_cells.find(row * m_cols + col);
-    if (it != m_alive_cells.end()) {
-        m_alive_cells.erase(it);
-    }
+    aliveCells(row).erase(m_cols * row + col);
 }
 
 void SparseUniverseV2::swapBuffers() {
-    std::swap(m_alive_cells, m_next_alive_cells);
+    m_current_side = 1 - m_current_side;
 }
 
 void SparseUniverseV2::clearBuffer() {
-    m_alive_cells.clear();
+    resetBuffer(m_current_side);
 }
 
 void SparseUniverseV2::clearNextBuffer() {
-    m_next_alive_cells.clear();
+    size_t side = 1 - m_current_side;
+    resetBuffer(side);
+    // the next generation is usually about as large, and rehashing would strand bucket arrays in the arena
+    // bands split the population about evenly
+    for (CellMap& cells: m_cell_maps[side]) {
+        cells.reserve(aliveCellCount() / bandCount(side));
+    }
 }
 
-std::vector<std::pair<size_t, size_t>> SparseUniverseV2::getAliveCellsPos() const {
-    std::vector<std::pair<size_t, size_t>> alive_pos;
-    for (const auto& [flat_pos, cell]: m_alive_cells) {
-        alive_pos.push_back({cell.row(), cell.col()});
+void SparseUniverseV2::resetBuffer(size_t side) {
+    m_cell_maps[side].clear();
+    for (size_t band = 0; band < bandCount(side); ++band) {
+        m_cell_maps[side].emplace_back(resetBandArena(side, band));
+    }
+}
+
+void SparseUniverseV2::forEachAliveCell(CellVisitor visit) const {
+    for (const CellMap& cells: m_cell_maps[m_current_side]) {
+        for (const auto& [flat_pos, cell]: cells) {
+            visit(cell.row(), cell.col());
+        }
     }
-    return alive_pos;
+}
+
+// a hash map has no order to search, so whichever is smaller is walked: the Cells of rect or the alive ones
+void SparseUniverseV2::forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const {
+    CellRect clamped = clampRect(rect);
+    if (clamped.area() > population()) {
+        Universe::forEachAliveCellIn(clamped, visit);
+        return;
+    }
+    for (size_t row = clamped.top; row < clamped.bottom; ++row) {
+        for (size_t col = clamped.left; col < clamped.right; ++col) {
+            if (aliveCells(row).count(m_cols * row + col) != 0) {
+                visit(row, col);
+            }
+        }
+    }
+}
+
+// strips probe a Cell each while they are smaller than the population, so a pass wins once the edges outgrow it
+void SparseUniverseV2::tightenBounds(CellRect& bounds) const {
+    if (2 * (bounds.bottom - bounds.top + bounds.right - bounds.left) > population()) {
+        bounds = scanBounds();
+        return;
+    }
+    Universe::tightenBounds(bounds);
 }
 
 void SparseUniverseV2::save(const std::filesystem::path& file_path) const {
@@ -517,3 +1315,154 @@ void SparseUniverseV2::save(const std::filesystem::path& file_path) const {
 void SparseUniverseV2::load(const std::filesystem::path& file_path) {
     SparseUniverse::load(file_path);
 }
+
+SparseUniverseV3::SparseUniverseV3(size_t rows, size_t cols): Universe(rows, cols) {}
+
+SparseUniverseV3::SparseUniverseV3(const std::filesystem::path& file_path): Universe(file_path) {
+    auto fdata = Universe::parseFile(file_path);
+    m_rows = fdata.rows;
+    m_cols = fdata.cols;
+    m_alive_cells.reserve(fdata.alive_cells_pos.size());
+    for (const std::pair<size_t, size_t>& p: fdata.alive_cells_pos) {
+        m_alive_cells.insert(cellKey(p.first, p.second));
+    }
+    recountAlive();
+}
+
+bool SparseUniverseV3::isCellAlive(size_t row, size_t col) {
+    return m_alive_cells.contains(cellKey(row, col));
+}
+
+void SparseUniverseV3::makeCellAlive(size_t row, size_t col) {
+    if (m_alive_cells.insert(cellKey(row, col))) {
+        noteBirth(row, col);
+    }
+}
+
+void SparseUniverseV3::makeCellDead(size_t row, size_t col) {
+    if (m_alive_cells.erase(cellKey(row, col))) {
+        noteDeath(row, col);
+    }
+}
+
+// same frontier step as SparseUniverse::advance, on keys instead of Cells
+void SparseUniverseV3::advance() {
+    m_generation++;
+    GOL_STATS_ONLY(GenerationStats* stats = beginGenerationStats();)
+    GOL_STATS_ONLY(uint64_t lookups = 0; uint64_t births = 0;)
+    GOL_STATS_ONLY(size_t next_capacity = m_next_alive_cells.capacity();)
+    GOL_STATS_ONLY(size_t frontier_capacity = m_frontier_hit_count.capacity();)
+    m_next_alive_cells.clear();
+    m_frontier_hit_count.clear();
+    m_alive_cells.forEach([&](uint64_t key) {
+        size_t row = key >> 32;
+        size_t col = key & 0xffffffff;
+        size_t alive_count = 0;
+        for (int dr = -1; dr < 2; ++dr) {
+            size_t nei_row = row + dr;
+            if (nei_row >= m_rows) {
+                continue; // also catches -1 wrapped around
+            }
+            for (int dc = -1; dc < 2; ++dc) {
+                size_t nei_col = col + dc;
+                if ((dr == 0 && dc == 0) || nei_col >= m_cols) {
+                    continue;
+                }
+                uint64_t nei_key = cellKey(nei_row, nei_col);
+                GOL_STATS_ONLY(lookups++;)
+                if (m_alive_cells.contains(nei_key)) {
+                    alive_count++;
+                }
+                else {
+                    m_frontier_hit_count[nei_key]++;
+                }
+            }
+        }
+        if (m_rule.nextState(true, alive_count)) {
+            m_next_alive_cells.insert(key);
+        }
+        else {
+            noteDeath(row, col);
+        }
+    });
+    GOL_STATS_ONLY(uint64_t frontier_start_ns = stats ? statsNowNs() : 0;)
+    m_frontier_hit_count.forEach([&](uint64_t key, uint8_t alive_count) {
+        if (m_rule.nextState(false, alive_count)) {
+            GOL_STATS_ONLY(births++;)
+            m_next_alive_cells.insert(key);
+            noteBirth(key >> 32, key & 0xffffffff);
+        }
+    });
+    GOL_STATS_ONLY(uint64_t swap_start_ns = stats ? statsNowNs() : 0;)
+    std::swap(m_alive_cells, m_next_alive_cells);
+    GOL_STATS_ONLY(if (stats) {
+        stats->swap_ns = statsNowNs() - swap_start_ns;
+        stats->neighbor_ns = frontier_start_ns - stats->start_ns;
+        stats->frontier_ns = swap_start_ns - frontier_start_ns;
+        stats->live_cells = m_alive_cells.size();
+        stats->births = births;
+        stats->deaths = m_next_alive_cells.size() + births - stats->live_cells;
+        stats->frontier_cells = m_frontier_hit_count.size();
+        stats->lookups = lookups;
+        // no per Cell allocations, only the tables growing
+        stats->allocations = (m_alive_cells.capacity() != next_capacity)
+            + (m_frontier_hit_count.capacity() != frontier_capacity);
+    })
+}
+
+void SparseUniverseV3::forEachAliveCell(CellVisitor visit) const {
+    m_alive_cells.forEach([visit](uint64_t key) {
+        visit(key >> 32, key & 0xffffffff);
+    });
+}
+
+// same choice as SparseUniverseV2, probing the Cells of rect or walking the alive ones
+void SparseUniverseV3::forEachAliveCellIn(const CellRect& rect, CellVisitor visit) const {
+    CellRect clamped = clampRect(rect);
+    if (clamped.area() > m_alive_cells.size()) {
+        Universe::forEachAliveCellIn(clamped, visit);
+        return;
+    }
+    for (size_t row = clamped.top; row < clamped.bottom; ++row) {
+        for (size_t col = clamped.left; col < clamped.right; ++col) {
+            if (m_alive_cells.contains(cellKey(row, col))) {
+                visit(row, col);
+            }
+        }
+    }
+}
+
+// same choice as SparseUniverseV2
+void SparseUniverseV3::tightenBounds(CellRect& bounds) const {
+    if (2 * (bounds.bottom - bounds.top + bounds.right - bounds.left) > m_alive_cells.size()) {
+        bounds = scanBounds();
+        return;
+    }
+    Universe::tightenBounds(bounds);
+}
+
+void SparseUniverseV3::setRule(Rule rule) {
+    rejectBirthsFromNothing(rule);
+    Universe::setRule(rule);
+}
+
+void SparseUniverseV3::makeAllCellsDead() {
+    m_alive_cells.clear();
+    clearSummary();
+}
+
+void SparseUniverseV3::save(const std::filesystem::path& file_path) const {
+    Universe::save(file_path);
+}
+
+void SparseUniverseV3::load(const std::filesystem::path& file_path) {
+    auto fdata = Universe::parseFile(file_path);
+    if (fdata.rows != m_rows || fdata.cols != m_cols) {
+        throw std::runtime_error("Cannot load a universe with a mismatched size");
+    }
+    m_alive_cells.clear();
+    for (const std::pair<size_t, size_t>& p: fdata.alive_cells_pos) {
+        m_alive_cells.insert(cellKey(p.first, p.second));
+    }
+    recountAlive();
+}
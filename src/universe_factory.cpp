@@ -0,0 +1,52 @@
+#include <stdexcept>
+
+#include "universe_factory.hpp"
+#include "bit_universe.hpp"
+#include "hashlife.hpp"
+#include "sorted_universe.hpp"
+#include "tiled_universe.hpp"
+
+namespace {
+
+std::unique_ptr<Universe> makeEngine(const std::string& engine, size_t rows, size_t cols) {
+    if (engine == "DenseUniverseV1") {
+        return std::make_unique<DenseUniverseV1>(rows, cols);
+    }
+    if (engine == "SparseUniverseV1") {
+        return std::make_unique<SparseUniverseV1>(rows, cols);
+    }
+    if (engine == "SparseUniverseV2") {
+        return std::make_unique<SparseUniverseV2>(rows, cols);
+    }
+    if (engine == "SparseUniverseV3") {
+        return std::make_unique<SparseUniverseV3>(rows, cols);
+    }
+    if (engine == "BitUniverse") {
+        return std::make_unique<BitUniverse>(rows, cols);
+    }
+    if (engine == "HashLifeUniverse") {
+        return std::make_unique<HashLifeUniverse>(rows, cols);
+    }
+    if (engine == "TiledUniverse") {
+        return std::make_unique<TiledUniverse>(rows, cols);
+    }
+    if (engine == "SortedUniverse") {
+        return std::make_unique<SortedUniverse>(rows, cols);
+    }
+    throw std::runtime_error("Unknown universe engine: " + engine);
+}
+
+}
+
+std::unique_ptr<Universe> makeUniverse(const std::string& engine, size_t rows, size_t cols,
+        const std::string& rulestring) {
+    Rule rule = Rule::parse(rulestring);
+    std::unique_ptr<Universe> universe = makeEngine(engine, rows, cols);
+    universe->setRule(rule);
+    return universe;
+}
+
+std::vector<std::string> universeEngineNames() {
+    return {"DenseUniverseV1", "SparseUniverseV1", "SparseUniverseV2", "SparseUniverseV3",
+        "BitUniverse", "HashLifeUniverse", "TiledUniverse", "SortedUniverse"};
+}
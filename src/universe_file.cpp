@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "universe_file.hpp"
+#include "varint.hpp"
+
+namespace {
+
+constexpr char text_magic[] = "GameOfLifeUniverse";
+constexpr char binary_magic[8] = {'G', 'o', 'L', 'U', 'n', 'i', 'v', '\0'};
+constexpr uint32_t binary_version = 2;
+constexpr size_t binary_header_bytes = sizeof(binary_magic) + 4 + 4 + 8 + 8 + 8;
+constexpr size_t chunk_entry_bytes = 3 * 8;
+
+std::string readFileBytes(const std::filesystem::path& file_path) {
+    std::ifstream file(file_path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open universe file");
+    }
+    file.seekg(0, std::ios::end);
+    std::string bytes(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0, std::ios::beg);
+    file.read(bytes.data(), bytes.size());
+    if (!file) {
+        throw std::runtime_error("Failed to read universe file");
+    }
+    return bytes;
+}
+
+UniverseFormat formatOf(std::string_view bytes) {
+    if (bytes.size() >= sizeof(binary_magic) && std::memcmp(bytes.data(), binary_magic, sizeof(binary_magic)) == 0) {
+        return UniverseFormat::binary;
+    }
+    size_t start = bytes.find_first_not_of(" \t\r\n");
+    if (start != std::string_view::npos && bytes.substr(start, sizeof(text_magic) - 1) == text_magic) {
+        return UniverseFormat::text;
+    }
+    throw std::runtime_error("Not a valid universe file");
+}
+
+// a number after any whitespace, and after a ',' when one is expected
+size_t parseNumber(const char*& cursor, const char* end, bool after_comma) {
+    while (cursor != end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')) {
+        ++cursor;
+    }
+    if (after_comma) {
+        if (cursor == end || *cursor != ',') {
+            throw std::runtime_error("Not a valid universe file");
+        }
+        ++cursor;
+    }
+    size_t value = 0;
+    auto [next, error] = std::from_chars(cursor, end, value);
+    if (error != std::errc()) {
+        throw std::runtime_error("Not a valid universe file");
+    }
+    cursor = next;
+    return value;
+}
+
+UniverseFileData parseText(std::string_view bytes) {
+    const char* cursor = bytes.data() + bytes.find(text_magic) + sizeof(text_magic) - 1;
+    const char* end = bytes.data() + bytes.size();
+    size_t rows = parseNumber(cursor, end, false);
+    size_t cols = parseNumber(cursor, end, false);
+    size_t alive_count = parseNumber(cursor, end, false);
+    std::vector<std::pair<size_t, size_t>> alive_cells_pos;
+    alive_cells_pos.reserve(std::min(alive_count, bytes.size() / 4)); // a line takes at least 4 bytes
+    for (size_t i = 0; i < alive_count; ++i) {
+        size_t row = parseNumber(cursor, end, false);
+        size_t col = parseNumber(cursor, end, true);
+        alive_cells_pos.push_back({row, col});
+    }
+    return {rows, cols, std::move(alive_cells_pos)};
+}
+
+struct ChunkEntry {
+    uint64_t offset;
+    uint64_t bytes;
+    uint64_t cells;
+};
+
+// returns false on corrupt data instead of throwing, chunks are decoded on worker threads
+bool decodeChunk(const char* payload, const char* payload_end, size_t rows, size_t cols,
+        std::pair<size_t, size_t>* out, size_t cell_count) {
+    const char* cursor = payload;
+    uint64_t flat_pos = 0;
+    uint64_t row = 0;
+    uint64_t row_start = 0; // flat position of column 0 of row
+    for (size_t i = 0; i < cell_count; ++i) {
+        uint64_t gap;
+        if (!loadVarint(cursor, payload_end, gap) || (i > 0 && (gap == 0 || flat_pos + gap < flat_pos))) {
+            return false; // truncated, unsorted or overflowing
+        }
+        flat_pos = i == 0 ? gap : flat_pos + gap;
+        // most gaps stay within the row, so the division is rare
+        if (i == 0 || flat_pos - row_start >= cols) {
+            row = flat_pos / cols;
+            row_start = row * cols;
+        }
+        if (row >= rows) {
+            return false;
+        }
+        out[i] = {row, flat_pos - row_start};
+    }
+    return cursor == payload_end;
+}
+
+UniverseFileData parseBinary(std::string_view bytes, ThreadPool* pool) {
+    if (bytes.size() < binary_header_bytes) {
+        throw std::runtime_error("Truncated universe file");
+    }
+    const char* header = bytes.data() + sizeof(binary_magic);
+    uint32_t version = loadLittleEndian(header, 4);
+    if (version != binary_version) {
+        throw std::runtime_error("Unsupported universe file version " + std::to_string(version));
+    }
+    size_t chunk_count = loadLittleEndian(header + 4, 4);
+    size_t rows = loadLittleEndian(header + 8, 8);
+    size_t cols = loadLittleEndian(header + 16, 8);
+    size_t population = loadLittleEndian(header + 24, 8);
+    if (chunk_count > (bytes.size() - binary_header_bytes) / chunk_entry_bytes) {
+        throw std::runtime_error("Truncated universe file");
+    }
+    const char* table = bytes.data() + binary_header_bytes;
+    const char* payloads = table + chunk_count * chunk_entry_bytes;
+    size_t payload_bytes = bytes.data() + bytes.size() - payloads;
+    std::vector<ChunkEntry> chunks(chunk_count);
+    std::vector<size_t> first_cell(chunk_count);
+    // the payloads follow each other without gaps or overlaps, so no byte is counted twice
+    // and the population is bounded by the file size before anything is allocated for it
+    size_t cell_total = 0;
+    size_t payload_end = 0;
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        const char* entry = table + chunk * chunk_entry_bytes;
+        chunks[chunk] = {loadLittleEndian(entry, 8), loadLittleEndian(entry + 8, 8), loadLittleEndian(entry + 16, 8)};
+        if (chunks[chunk].offset != payload_end || chunks[chunk].bytes > payload_bytes - payload_end
+                || chunks[chunk].cells > chunks[chunk].bytes) {
+            throw std::runtime_error("Truncated universe file");
+        }
+        if (chunks[chunk].cells > population - cell_total) {
+            throw std::runtime_error("Not a valid universe file");
+        }
+        first_cell[chunk] = cell_total;
+        cell_total += chunks[chunk].cells;
+        payload_end += chunks[chunk].bytes;
+    }
+    if (payload_end != payload_bytes) {
+        throw std::runtime_error("Corrupt universe file");
+    }
+    if (cell_total != population || (population > 0 && cols == 0)) {
+        throw std::runtime_error("Not a valid universe file");
+    }
+    std::vector<std::pair<size_t, size_t>> alive_cells_pos(population);
+    std::vector<uint8_t> chunk_ok(chunk_count, 0);
+    auto decode = [&](size_t, size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            const char* payload = payloads + chunks[chunk].offset;
+            chunk_ok[chunk] = decodeChunk(payload, payload + chunks[chunk].bytes, rows, cols,
+                    alive_cells_pos.data() + first_cell[chunk], chunks[chunk].cells);
+        }
+    };
+    if (pool && chunk_count > 1) {
+        pool->parallelFor(chunk_count, decode);
+    }
+    else {
+        decode(0, 0, chunk_count);
+    }
+    for (uint8_t ok: chunk_ok) {
+        if (!ok) {
+            throw std::runtime_error("Corrupt universe file");
+        }
+    }
+    // each chunk only checked its own order, the positions must also rise from one chunk to the next
+    for (size_t chunk = 1; chunk < chunk_count; ++chunk) {
+        size_t first = first_cell[chunk];
+        if (chunks[chunk].cells > 0 && first > 0 && alive_cells_pos[first] <= alive_cells_pos[first - 1]) {
+            throw std::runtime_error("Corrupt universe file");
+        }
+    }
+    return {rows, cols, std::move(alive_cells_pos)};
+}
+
+}
+
+UniverseFormat detectUniverseFormat(const std::filesystem::path& file_path) {
+    std::ifstream file(file_path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open universe file");
+    }
+    std::string prefix(64, '\0');
+    file.read(prefix.data(), prefix.size());
+    prefix.resize(file.gcount());
+    return formatOf(prefix);
+}
+
+UniverseFileData readUniverseFile(const std::filesystem::path& file_path, ThreadPool* pool) {
+    std::string bytes = readFileBytes(file_path);
+    if (formatOf(bytes) == UniverseFormat::binary) {
+        return parseBinary(bytes, pool);
+    }
+    return parseText(bytes);
+}
+
+void writeBinaryUniverseFile(const std::filesystem::path& file_path, size_t rows, size_t cols,
+        const std::vector<uint64_t>& flat_positions, size_t chunk_cells) {
+    if (chunk_cells == 0) {
+        throw std::runtime_error("Chunks must hold at least one cell");
+    }
+    std::string table;
+    std::string payloads;
+    size_t chunk_count = 0;
+    for (size_t begin = 0; begin < flat_positions.size(); begin += chunk_cells) {
+        size_t end = std::min(flat_positions.size(), begin + chunk_cells);
+        size_t offset = payloads.size();
+        for (size_t i = begin; i < end; ++i) {
+            storeVarint(payloads, i == begin ? flat_positions[i] : flat_positions[i] - flat_positions[i - 1]);
+        }
+        storeLittleEndian(table, offset, 8);
+        storeLittleEndian(table, payloads.size() - offset, 8);
+        storeLittleEndian(table, end - begin, 8);
+        ++chunk_count;
+    }
+    std::string header(binary_magic, sizeof(binary_magic));
+    storeLittleEndian(header, binary_version, 4);
+    storeLittleEndian(header, chunk_count, 4);
+    storeLittleEndian(header, rows, 8);
+    storeLittleEndian(header, cols, 8);
+    storeLittleEndian(header, flat_positions.size(), 8);
+    std::ofstream file(file_path, std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open output file");
+    }
+    file.write(header.data(), header.size());
+    file.write(table.data(), table.size());
+    file.write(payloads.data(), payloads.size());
+    if (!file) {
+        throw std::runtime_error("Failed to write universe file");
+    }
+}
@@ -0,0 +1,112 @@
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "universe_stats.hpp"
+
+GenerationStats& StatsRecorder::beginGeneration() {
+    GenerationStats& stats = m_generations.emplace_back();
+    stats.generation = m_generations.size() - 1;
+    stats.start_ns = nowNs();
+    return stats;
+}
+
+namespace {
+
+std::ofstream openStatsFile(const std::filesystem::path& file_path) {
+    std::ofstream file(file_path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + file_path.string());
+    }
+    return file;
+}
+
+// name and value of every field, in declaration order
+template <typename Visit>
+void forEachField(const GenerationStats& stats, Visit&& visit) {
+    visit("generation", stats.generation);
+    visit("live_cells", stats.live_cells);
+    visit("births", stats.births);
+    visit("deaths", stats.deaths);
+    visit("frontier_cells", stats.frontier_cells);
+    visit("lookups", stats.lookups);
+    visit("allocations", stats.allocations);
+    visit("start_ns", stats.start_ns);
+    visit("neighbor_ns", stats.neighbor_ns);
+    visit("frontier_ns", stats.frontier_ns);
+    visit("swap_ns", stats.swap_ns);
+}
+
+void checkWritten(std::ofstream& file, const std::filesystem::path& file_path) {
+    file.flush();
+    if (!file) {
+        throw std::runtime_error("Failed to write " + file_path.string());
+    }
+}
+
+}
+
+void writeStatsCsv(const std::filesystem::path& file_path, const std::vector<GenerationStats>& stats) {
+    std::ofstream file = openStatsFile(file_path);
+    std::string separator;
+    forEachField(GenerationStats{}, [&](const char* name, uint64_t) {
+        file << separator << name;
+        separator = ",";
+    });
+    file << '\n';
+    for (const GenerationStats& generation: stats) {
+        separator.clear();
+        forEachField(generation, [&](const char*, uint64_t value) {
+            file << separator << value;
+            separator = ",";
+        });
+        file << '\n';
+    }
+    checkWritten(file, file_path);
+}
+
+void writeStatsJson(const std::filesystem::path& file_path, const std::vector<GenerationStats>& stats) {
+    std::ofstream file = openStatsFile(file_path);
+    file << "[\n";
+    for (size_t i = 0; i < stats.size(); ++i) {
+        std::string separator;
+        file << "  {";
+        forEachField(stats[i], [&](const char* name, uint64_t value) {
+            file << separator << '"' << name << "\": " << value;
+            separator = ", ";
+        });
+        file << (i + 1 < stats.size() ? "},\n" : "}\n");
+    }
+    file << "]\n";
+    checkWritten(file, file_path);
+}
+
+// timestamps of the format are in microseconds, fractions keep the nanoseconds
+void writeStatsChromeTrace(const std::filesystem::path& file_path, const std::vector<GenerationStats>& stats) {
+    std::ofstream file = openStatsFile(file_path);
+    file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+    std::string separator = "  ";
+    auto phase = [&](const char* name, uint64_t generation, uint64_t start_ns, uint64_t duration_ns) {
+        file << separator << "{\"name\": \"" << name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": "
+            << start_ns / 1000 << '.' << std::to_string(1000 + start_ns % 1000).substr(1)
+            << ", \"dur\": " << duration_ns / 1000 << '.' << std::to_string(1000 + duration_ns % 1000).substr(1)
+            << ", \"args\": {\"generation\": " << generation << "}}";
+        separator = ",\n  ";
+    };
+    for (const GenerationStats& generation: stats) {
+        uint64_t start_ns = generation.start_ns;
+        phase("neighbor pass", generation.generation, start_ns, generation.neighbor_ns);
+        start_ns += generation.neighbor_ns;
+        phase("frontier pass", generation.generation, start_ns, generation.frontier_ns);
+        start_ns += generation.frontier_ns;
+        phase("buffer swap", generation.generation, start_ns, generation.swap_ns);
+        file << separator << "{\"name\": \"cells\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << generation.start_ns / 1000
+            << ", \"args\": {\"live\": " << generation.live_cells << ", \"births\": " << generation.births
+            << ", \"deaths\": " << generation.deaths << ", \"frontier\": " << generation.frontier_cells << "}}";
+        file << separator << "{\"name\": \"work\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << generation.start_ns / 1000
+            << ", \"args\": {\"lookups\": " << generation.lookups << ", \"allocations\": " << generation.allocations
+            << "}}";
+    }
+    file << "\n]}\n";
+    checkWritten(file, file_path);
+}
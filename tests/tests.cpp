@@ -1,6 +1,31 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "universe.hpp"
+#include "bit_kernels.hpp"
+#include "flat_hash.hpp"
+#include "bit_universe.hpp"
+#include "hashlife.hpp"
+#include "sorted_universe.hpp"
+#include "tiled_universe.hpp"
+#include "universe_factory.hpp"
+#include "universe_file.hpp"
+#include "pattern_io.hpp"
+#include "trajectory.hpp"
+#include "checkpointer.hpp"
+#include "painter.hpp"
+#include "animator.hpp"
+#include "spsc_queue.hpp"
+#include "rule.hpp"
 #include "cell.hpp"
 
 void testUniverseStartsDead(std::unique_ptr<Universe>&& universe) {
@@ -285,6 +310,354 @@ void testCreateUniverseFromFile() {
     }
 }
 
+std::vector<std::pair<size_t, size_t>> sortedAliveCellsPos(const Universe* universe) {
+    auto alive_cells_pos = universe->getAliveCellsPos();
+    std::sort(alive_cells_pos.begin(), alive_cells_pos.end());
+    return alive_cells_pos;
+}
+
+// seeds both universes with the same random soup and checks they agree every generation
+template <typename UnivT, typename RefUnivT>
+void testMatchesReference(std::unique_ptr<UnivT>&& universe, size_t time_steps) {
+    size_t rows = universe->rowCount();
+    size_t cols = universe->colCount();
+    auto reference = std::make_unique<RefUnivT>(rows, cols);
+    std::mt19937 rng(42);
+    std::bernoulli_distribution coin(0.35);
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            if (coin(rng)) {
+                universe->makeCellAlive(row, col);
+                reference->makeCellAlive(row, col);
+            }
+        }
+    }
+    for (size_t i = 0; i < time_steps; ++i) {
+        universe->advance();
+        reference->advance();
+        ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(reference.get())) << "generation " << i + 1;
+    }
+}
+
+template <typename UnivT>
+void testForEachAliveCell(std::unique_ptr<UnivT>&& universe) {
+    std::vector<std::pair<size_t, size_t>> alive_cells_pos{{0, 0}, {0, 69}, {3, 64}, {4, 5}, {6, 69}};
+    for (const auto& [row, col]: alive_cells_pos) {
+        universe->makeCellAlive(row, col);
+    }
+    std::vector<std::pair<size_t, size_t>> visited;
+    universe->forEachAliveCell([&visited](size_t row, size_t col) { visited.push_back({row, col}); });
+    std::sort(visited.begin(), visited.end());
+    ASSERT_EQ(visited, alive_cells_pos);
+}
+
+// every engine visits each alive cell exactly once
+TEST(UniverseTests, forEachAliveCell) {
+    testForEachAliveCell(std::make_unique<DenseUniverseV1>(7, 70));
+    testForEachAliveCell(std::make_unique<DenseUniverseV2<7, 70>>());
+    testForEachAliveCell(std::make_unique<SparseUniverseV1>(7, 70));
+    testForEachAliveCell(std::make_unique<SparseUniverseV2>(7, 70));
+    testForEachAliveCell(std::make_unique<SparseUniverseV3>(7, 70));
+    testForEachAliveCell(std::make_unique<BitUniverse>(7, 70));
+    testForEachAliveCell(std::make_unique<HashLifeUniverse>(7, 70));
+    testForEachAliveCell(std::make_unique<TiledUniverse>(7, 70));
+    testForEachAliveCell(std::make_unique<SortedUniverse>(7, 70));
+}
+
+// a block and a blinker settle, then a glider is dropped into tiles that have been quiet for a while
+template <typename UnivT>
+void testQuietTilesWakeUp(std::unique_ptr<UnivT>&& universe) {
+    auto reference = std::make_unique<SparseUniverseV2>(universe->rowCount(), universe->colCount());
+    std::vector<std::pair<size_t, size_t>> still_cells{{1, 1}, {1, 2}, {2, 1}, {2, 2}, {40, 40}, {40, 41}, {40, 42}};
+    std::vector<std::pair<size_t, size_t>> glider_cells{{130, 600}, {131, 601}, {132, 599}, {132, 600}, {132, 601}};
+    for (const auto& [row, col]: still_cells) {
+        universe->makeCellAlive(row, col);
+        reference->makeCellAlive(row, col);
+    }
+    for (size_t i = 0; i < 6; ++i) {
+        universe->advance();
+        reference->advance();
+    }
+    for (const auto& [row, col]: glider_cells) {
+        universe->makeCellAlive(row, col);
+        reference->makeCellAlive(row, col);
+    }
+    universe->makeCellDead(40, 41); // kills the blinker
+    reference->makeCellDead(40, 41);
+    for (size_t i = 0; i < 200; ++i) {
+        universe->advance();
+        reference->advance();
+        ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(reference.get())) << "generation " << i + 1;
+    }
+}
+
+// the glider crosses tile borders in both directions of the dense engines with activity tracking
+TEST(UniverseTests, quietTilesWakeUp) {
+    testQuietTilesWakeUp(std::make_unique<DenseUniverseV1>(200, 700));
+    testQuietTilesWakeUp(std::make_unique<DenseUniverseV2<200, 700>>());
+    testQuietTilesWakeUp(std::make_unique<BitUniverse>(200, 700));
+}
+
+// population, centroid, bounding box and state hash of the Universe against a pass over its alive Cells
+void expectSummaryMatchesCells(const Universe* universe) {
+    size_t population = 0;
+    double row_sum = 0.0;
+    double col_sum = 0.0;
+    CellRect bounds;
+    uint64_t hash = 0;
+    universe->forEachAliveCell([&](size_t row, size_t col) {
+        population++;
+        row_sum += row;
+        col_sum += col;
+        bounds.include(row, col);
+        hash += cellHash(row, col);
+    });
+    ASSERT_EQ(universe->stateHash(), hash);
+    ASSERT_EQ(universe->population(), population);
+    auto [mid_row, mid_col] = universe->centroid();
+    ASSERT_NEAR(mid_row, population == 0 ? 0.0 : row_sum / population, 1e-9);
+    ASSERT_NEAR(mid_col, population == 0 ? 0.0 : col_sum / population, 1e-9);
+    CellRect box = universe->boundingBox();
+    ASSERT_EQ(box.top, bounds.top);
+    ASSERT_EQ(box.left, bounds.left);
+    ASSERT_EQ(box.bottom, bounds.bottom);
+    ASSERT_EQ(box.right, bounds.right);
+}
+
+// one generation straight from the definition of the rule
+std::set<std::pair<size_t, size_t>> naiveStep(const std::set<std::pair<size_t, size_t>>& alive,
+        size_t rows, size_t cols, Rule rule) {
+    std::set<std::pair<size_t, size_t>> next;
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            size_t alive_count = 0;
+            for (int dr = -1; dr < 2; ++dr) {
+                for (int dc = -1; dc < 2; ++dc) {
+                    if ((dr != 0 || dc != 0) && alive.count({row + dr, col + dc})) {
+                        alive_count++;
+                    }
+                }
+            }
+            if (rule.nextState(alive.count({row, col}), alive_count)) {
+                next.insert({row, col});
+            }
+        }
+    }
+    return next;
+}
+
+void testRuleMatchesNaiveStep(const std::string& engine, const std::string& rulestring, size_t time_steps) {
+    SCOPED_TRACE(engine + " " + rulestring);
+    size_t rows = 70;
+    size_t cols = 150;
+    std::unique_ptr<Universe> universe = makeUniverse(engine, rows, cols, rulestring);
+    std::set<std::pair<size_t, size_t>> expected;
+    std::mt19937 rng(42);
+    std::bernoulli_distribution coin(0.35);
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            if (coin(rng)) {
+                universe->makeCellAlive(row, col);
+                expected.insert({row, col});
+            }
+        }
+    }
+    for (size_t i = 0; i < time_steps; ++i) {
+        universe->advance();
+        expected = naiveStep(expected, rows, cols, universe->rule());
+        std::vector<std::pair<size_t, size_t>> expected_pos(expected.begin(), expected.end());
+        ASSERT_EQ(sortedAliveCellsPos(universe.get()), expected_pos) << "generation " << i + 1;
+        expectSummaryMatchesCells(universe.get());
+    }
+}
+
+// the named rules run their own compiled kernels, B35/S1357 the generic one
+TEST(UniverseTests, lifeLikeRules) {
+    for (const std::string& engine: universeEngineNames()) {
+        for (const char* rulestring: {"B3/S23", "B36/S23", "B2/S", "B3678/S34678", "B3/S012345678", "B35/S1357"}) {
+            testRuleMatchesNaiveStep(engine, rulestring, 6);
+        }
+    }
+}
+
+// dead Cells with no alive neighbors are born, only the dense engines can follow
+TEST(UniverseTests, birthsFromNothing) {
+    for (const std::string& engine: universeEngineNames()) {
+        if (engine == "DenseUniverseV1" || engine == "BitUniverse") {
+            testRuleMatchesNaiveStep(engine, "B0123478/S01234678", 4);
+        }
+        else {
+            ASSERT_THROW(makeUniverse(engine, 10, 10, "B0123478/S01234678"), std::runtime_error) << engine;
+        }
+    }
+}
+
+// a rule change takes effect on boards that were already quiet or memoized
+TEST(UniverseTests, setRuleMidRun) {
+    for (const std::string& engine: universeEngineNames()) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 100, 600, "B3/S23");
+        // a block is still life under B3/S23 and dies out under Seeds
+        for (const auto& [row, col]: std::vector<std::pair<size_t, size_t>>{{50, 300}, {50, 301}, {51, 300}, {51, 301}}) {
+            universe->makeCellAlive(row, col);
+        }
+        universe->advance();
+        universe->advance();
+        ASSERT_EQ(sortedAliveCellsPos(universe.get()).size(), 4);
+        universe->setRule(seeds);
+        universe->advance();
+        std::vector<std::pair<size_t, size_t>> expected{
+            {49, 300}, {49, 301}, {50, 299}, {50, 302}, {51, 299}, {51, 302}, {52, 300}, {52, 301}};
+        ASSERT_EQ(sortedAliveCellsPos(universe.get()), expected);
+    }
+}
+
+TEST(UniverseTests, makeUniverseRejectsUnknownEngine) {
+    ASSERT_THROW(makeUniverse("DenseUniverseV9", 10, 10), std::runtime_error);
+    ASSERT_THROW(makeUniverse("BitUniverse", 10, 10, "B3S23"), std::runtime_error);
+}
+
+TEST(UniverseTests, advanceManyMatchesSingleSteps) {
+    for (const std::string& engine: universeEngineNames()) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 90, 140);
+        std::unique_ptr<Universe> reference = makeUniverse(engine, 90, 140);
+        std::mt19937 rng(3);
+        std::bernoulli_distribution coin(0.3);
+        for (size_t row = 0; row < 90; ++row) {
+            for (size_t col = 0; col < 140; ++col) {
+                if (coin(rng)) {
+                    universe->makeCellAlive(row, col);
+                    reference->makeCellAlive(row, col);
+                }
+            }
+        }
+        for (size_t generations: {0, 1, 3, 8, 13}) {
+            universe->advance(generations);
+            for (size_t i = 0; i < generations; ++i) {
+                reference->advance();
+            }
+            ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(reference.get())) << generations;
+            ASSERT_EQ(universe->population(), reference->population());
+        }
+    }
+}
+
+// Rule tests
+TEST(RuleTests, parse) {
+    ASSERT_EQ(Rule::parse("B3/S23"), conway_life);
+    ASSERT_EQ(Rule::parse("s23/b3"), conway_life);
+    ASSERT_EQ(Rule::parse("23/3"), conway_life);
+    ASSERT_EQ(Rule::parse("B63/S32"), high_life);
+    ASSERT_EQ(Rule::parse("B2/S").survivalMask(), 0);
+    ASSERT_EQ(Rule::parse("B36/S23").birthMask(), (1 << 3) | (1 << 6));
+    ASSERT_TRUE(Rule::parse("B0/S8").birthsFromNothing());
+}
+
+TEST(RuleTests, parseRejectsMalformed) {
+    for (const char* rulestring: {"", "B3", "B3/S23/S1", "B9/S23", "B3/B23", "B3/S2x", "B3/23"}) {
+        ASSERT_THROW(Rule::parse(rulestring), std::runtime_error) << rulestring;
+    }
+}
+
+TEST(RuleTests, toStringRoundTrips) {
+    for (const char* rulestring: {"B3/S23", "B36/S23", "B2/S", "B3678/S34678", "B/S012345678"}) {
+        ASSERT_EQ(Rule::parse(rulestring).toString(), rulestring);
+    }
+}
+
+TEST(RuleTests, nextStateIsTheTable) {
+    for (size_t count = 0; count < 9; ++count) {
+        ASSERT_EQ(conway_life.nextState(false, count), count == 3);
+        ASSERT_EQ(conway_life.nextState(true, count), count == 2 || count == 3);
+    }
+}
+
+// one generation on a torus, neighbors wrap around the opposite edges
+std::set<std::pair<size_t, size_t>> naiveTorusStep(const std::set<std::pair<size_t, size_t>>& alive,
+        size_t rows, size_t cols) {
+    std::set<std::pair<size_t, size_t>> next;
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            size_t alive_count = 0;
+            for (size_t dr = rows - 1; dr <= rows + 1; ++dr) {
+                for (size_t dc = cols - 1; dc <= cols + 1; ++dc) {
+                    if ((dr != rows || dc != cols) && alive.count({(row + dr) % rows, (col + dc) % cols})) {
+                        alive_count++;
+                    }
+                }
+            }
+            if (conway_life.nextState(alive.count({row, col}), alive_count)) {
+                next.insert({row, col});
+            }
+        }
+    }
+    return next;
+}
+
+template <typename UnivT>
+void testTorusMatchesNaiveStep(std::unique_ptr<UnivT>&& universe, size_t time_steps) {
+    universe->setTopology(Topology::torus);
+    std::set<std::pair<size_t, size_t>> expected;
+    std::mt19937 rng(42);
+    std::bernoulli_distribution coin(0.35);
+    for (size_t row = 0; row < universe->rowCount(); ++row) {
+        for (size_t col = 0; col < universe->colCount(); ++col) {
+            if (coin(rng)) {
+                universe->makeCellAlive(row, col);
+                expected.insert({row, col});
+            }
+        }
+    }
+    for (size_t i = 0; i < time_steps; ++i) {
+        universe->advance();
+        expected = naiveTorusStep(expected, universe->rowCount(), universe->colCount());
+        std::vector<std::pair<size_t, size_t>> expected_pos(expected.begin(), expected.end());
+        ASSERT_EQ(sortedAliveCellsPos(universe.get()), expected_pos) << "generation " << i + 1;
+        expectSummaryMatchesCells(universe.get());
+    }
+}
+
+// a glider on a torus is back where it started after 4 generations per cell of the side,
+// crossing the corner through tiles that were quiet until it arrived
+template <typename UnivT>
+void testTorusGliderReturns(std::unique_ptr<UnivT>&& universe) {
+    universe->setTopology(Topology::torus);
+    std::vector<std::pair<size_t, size_t>> glider{{40, 41}, {41, 42}, {42, 40}, {42, 41}, {42, 42}};
+    for (const auto& [row, col]: glider) {
+        universe->makeCellAlive(row, col);
+    }
+    for (size_t i = 0; i < 4 * universe->rowCount(); ++i) {
+        universe->advance();
+        ASSERT_EQ(sortedAliveCellsPos(universe.get()).size(), 5) << "generation " << i + 1;
+    }
+    ASSERT_EQ(sortedAliveCellsPos(universe.get()), glider);
+}
+
+TEST(UniverseTests, torus) {
+    testTorusMatchesNaiveStep(std::make_unique<DenseUniverseV1>(37, 70), 8);
+    testTorusMatchesNaiveStep(std::make_unique<DenseUniverseV2<37, 70>>(), 8);
+    testTorusGliderReturns(std::make_unique<DenseUniverseV1>(64, 64));
+    testTorusGliderReturns(std::make_unique<DenseUniverseV2<64, 64>>());
+}
+
+// the ghost border is dead again once the torus is switched off
+TEST(UniverseTests, torusBackToBounded) {
+    auto universe = std::make_unique<DenseUniverseV1>(10, 10);
+    universe->setTopology(Topology::torus);
+    // a blinker across the left edge
+    for (size_t row = 4; row < 7; ++row) {
+        universe->makeCellAlive(row, 0);
+    }
+    universe->advance();
+    std::vector<std::pair<size_t, size_t>> expected{{5, 0}, {5, 1}, {5, 9}};
+    ASSERT_EQ(sortedAliveCellsPos(universe.get()), expected);
+    // on the torus it would flip back, bounded the three Cells are too far apart to survive
+    universe->setTopology(Topology::bounded);
+    universe->advance();
+    ASSERT_TRUE(sortedAliveCellsPos(universe.get()).empty());
+}
+
 // DenseUniverseV1 tests
 TEST(DenseUniverseV1Tests, UniverseStartsDead) {
     testUniverseStartsDead(std::make_unique<DenseUniverseV1>(3, 4));
@@ -330,6 +703,15 @@ TEST(DenseUniverseV1Tests, createFromFile) {
     testCreateUniverseFromFile<DenseUniverseV1>();
 }
 
+// more threads than rows leaves some bands empty
+TEST(DenseUniverseV1Tests, parallelMatchesSerial) {
+    for (size_t threads: {2, 3, 8, 64}) {
+        auto universe = std::make_unique<DenseUniverseV1>(41, 37);
+        universe->setThreadCount(threads);
+        testMatchesReference<DenseUniverseV1, DenseUniverseV1>(std::move(universe), 15);
+    }
+}
+
 // SparseUniverse tests
 TEST(SparseUniverseTests, UniverseStartsDead) {
     testUniverseStartsDead(std::make_unique<SparseUniverseV1>(3, 4));
@@ -375,6 +757,13 @@ TEST(SparseUniverseV1Tests, createFromFile) {
     testCreateUniverseFromFile<SparseUniverseV1>();
 }
 
+// the reference keeps its Cells in the ping-pong arenas, this one on the heap
+TEST(SparseUniverseV1Tests, heapMatchesArenas) {
+    auto universe = std::make_unique<SparseUniverseV1>(60, 60);
+    universe->setArenasEnabled(false);
+    testMatchesReference<SparseUniverseV1, SparseUniverseV1>(std::move(universe), 20);
+}
+
 
 // SparseUniverseV2 tests
 TEST(SparseUniverseV2Tests, UniverseStartsDead) {
@@ -420,3 +809,1471 @@ TEST(SparseUniverseV2Tests, saveAndLoad) {
 TEST(SparseUniverseV2Tests, createFromFile) {
     testCreateUniverseFromFile<SparseUniverseV2>();
 }
+
+TEST(SparseUniverseV2Tests, heapMatchesArenas) {
+    auto universe = std::make_unique<SparseUniverseV2>(60, 60);
+    universe->setArenasEnabled(false);
+    testMatchesReference<SparseUniverseV2, SparseUniverseV2>(std::move(universe), 20);
+}
+
+// large enough to take the parallel path, frontier cells on band borders get hits from two bands
+TEST(SparseUniverseV2Tests, parallelMatchesSerial) {
+    for (size_t threads: {2, 3, 7}) {
+        auto universe = std::make_unique<SparseUniverseV2>(200, 200);
+        universe->setThreadCount(threads);
+        testMatchesReference<SparseUniverseV2, SparseUniverseV2>(std::move(universe), 10);
+    }
+}
+
+// parallel steps leave the buffers split into bands of rows, which edits, queries and later serial steps must find
+template <typename UnivT>
+void testBandedBuffers() {
+    auto universe = std::make_unique<UnivT>(200, 200);
+    DenseUniverseV1 reference(200, 200);
+    universe->setThreadCount(3);
+    std::mt19937 rng(17);
+    std::bernoulli_distribution coin(0.35);
+    for (size_t row = 0; row < 200; ++row) {
+        for (size_t col = 0; col < 200; ++col) {
+            if (coin(rng)) {
+                universe->makeCellAlive(row, col);
+                reference.makeCellAlive(row, col);
+            }
+        }
+    }
+    for (size_t i = 0; i < 40; ++i) {
+        universe->advance();
+        reference.advance();
+        for (size_t row: {0, 37, 100, 101, 163, 199}) {
+            ASSERT_EQ(universe->isCellAlive(row, 2 * i), reference.isCellAlive(row, 2 * i));
+            universe->makeCellAlive(row, 2 * i);
+            reference.makeCellAlive(row, 2 * i);
+            universe->makeCellDead(row, 2 * i + 1);
+            reference.makeCellDead(row, 2 * i + 1);
+        }
+        if (i == 20) {
+            universe->setArenasEnabled(false);
+        }
+        ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(&reference)) << "generation " << i + 1;
+        ASSERT_EQ(universe->countAliveIn({90, 10, 130, 50}), reference.countAliveIn({90, 10, 130, 50}));
+        ASSERT_NO_FATAL_FAILURE(expectSummaryMatchesCells(universe.get()));
+    }
+    // below the parallel threshold the steps are serial again, on the bands the last parallel one left
+    for (const auto& [row, col]: universe->getAliveCellsPos()) {
+        universe->makeCellDead(row, col);
+    }
+    for (size_t col = 3; col < 6; ++col) {
+        universe->makeCellAlive(150, col);
+    }
+    universe->advance();
+    ASSERT_EQ(sortedAliveCellsPos(universe.get()), (std::vector<std::pair<size_t, size_t>>{{149, 4}, {150, 4}, {151, 4}}));
+}
+
+TEST(SparseUniverseTests, bandedBuffers) {
+    testBandedBuffers<SparseUniverseV1>();
+    testBandedBuffers<SparseUniverseV2>();
+}
+
+// SparseUniverseV3 tests
+TEST(SparseUniverseV3Tests, UniverseStartsDead) {
+    testUniverseStartsDead(std::make_unique<SparseUniverseV3>(3, 4));
+}
+
+TEST(SparseUniverseV3Tests, makeCellAlive) {
+    testMakeCellAlive(std::make_unique<SparseUniverseV3>(1, 1));
+}
+
+TEST(SparseUniverseV3Tests, makeCellDead) {
+    testMakeCellDead(std::make_unique<SparseUniverseV3>(1, 1));
+}
+
+TEST(SparseUniverseV3Tests, cellComesAlive) {
+    testNonEdgeCellComesAlive<SparseUniverseV3>();
+    testEdgeCellComesAlive<SparseUniverseV3>();
+    testCornerCellComesAlive<SparseUniverseV3>();
+}
+
+TEST(SparseUniverseV3Tests, cellStaysDead) {
+    testNonEdgeCellStaysDead<SparseUniverseV3>();
+    testEdgeCellStaysDead<SparseUniverseV3>();
+    testCornerCellStaysDead<SparseUniverseV3>();
+}
+
+TEST(SparseUniverseV3Tests, cellDies) {
+    testNonEdgeCellDies<SparseUniverseV3>();
+    testEdgeCellDies<SparseUniverseV3>();
+    testCornerCellDies<SparseUniverseV3>();
+}
+
+TEST(SparseUniverseV3Tests, cellStaysAlive) {
+    testNonEdgeCellStaysAlive<SparseUniverseV3>();
+    testEdgeCellStaysAlive<SparseUniverseV3>();
+    testCornerCellStaysAlive<SparseUniverseV3>();
+}
+
+TEST(SparseUniverseV3Tests, saveAndLoad) {
+    testSaveLoad<SparseUniverseV3>();
+}
+
+TEST(SparseUniverseV3Tests, createFromFile) {
+    testCreateUniverseFromFile<SparseUniverseV3>();
+}
+
+TEST(SparseUniverseV3Tests, matchesDenseUniverseV1) {
+    testMatchesReference<SparseUniverseV3, DenseUniverseV1>(std::make_unique<SparseUniverseV3>(60, 90), 40);
+}
+
+// random inserts and erases against std::set, small keys collide often and the all ones key takes the flag path
+TEST(FlatHashTests, matchesStdSet) {
+    FlatHashSet set;
+    FlatHashMap<uint64_t> map;
+    std::set<uint64_t> reference;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint64_t> small_key(0, 300);
+    for (size_t i = 0; i < 20000; ++i) {
+        uint64_t key = i % 97 == 0 ? FlatHashKeys::empty_key : small_key(rng) << (i % 3 == 0 ? 40 : 0);
+        if (rng() % 3 == 0) {
+            bool erased = reference.erase(key) == 1;
+            ASSERT_EQ(set.erase(key), erased);
+            ASSERT_EQ(map.erase(key), erased);
+        }
+        else {
+            ASSERT_EQ(set.insert(key), reference.insert(key).second);
+            map[key] = key;
+        }
+        ASSERT_EQ(set.size(), reference.size());
+        ASSERT_EQ(map.size(), reference.size());
+    }
+    for (uint64_t key: reference) {
+        ASSERT_TRUE(set.contains(key));
+        ASSERT_NE(map.find(key), nullptr);
+        ASSERT_EQ(*map.find(key), key);
+    }
+    size_t capacity = set.capacity();
+    set.clear();
+    ASSERT_TRUE(set.empty());
+    ASSERT_EQ(set.capacity(), capacity);
+}
+
+// BitUniverse tests
+TEST(BitUniverseTests, UniverseStartsDead) {
+    testUniverseStartsDead(std::make_unique<BitUniverse>(3, 4));
+}
+
+TEST(BitUniverseTests, makeCellAlive) {
+    testMakeCellAlive(std::make_unique<BitUniverse>(1, 1));
+}
+
+TEST(BitUniverseTests, makeCellDead) {
+    testMakeCellDead(std::make_unique<BitUniverse>(1, 1));
+}
+
+TEST(BitUniverseTests, cellComesAlive) {
+    testNonEdgeCellComesAlive<BitUniverse>();
+    testEdgeCellComesAlive<BitUniverse>();
+    testCornerCellComesAlive<BitUniverse>();
+}
+
+TEST(BitUniverseTests, cellStaysDead) {
+    testNonEdgeCellStaysDead<BitUniverse>();
+    testEdgeCellStaysDead<BitUniverse>();
+    testCornerCellStaysDead<BitUniverse>();
+}
+
+TEST(BitUniverseTests, cellDies) {
+    testNonEdgeCellDies<BitUniverse>();
+    testEdgeCellDies<BitUniverse>();
+    testCornerCellDies<BitUniverse>();
+}
+
+TEST(BitUniverseTests, cellStaysAlive) {
+    testNonEdgeCellStaysAlive<BitUniverse>();
+    testEdgeCellStaysAlive<BitUniverse>();
+    testCornerCellStaysAlive<BitUniverse>();
+}
+
+TEST(BitUniverseTests, saveAndLoad) {
+    testSaveLoad<BitUniverse>();
+}
+
+TEST(BitUniverseTests, createFromFile) {
+    testCreateUniverseFromFile<BitUniverse>();
+}
+
+// spans several words per row with a partial last word
+TEST(BitUniverseTests, matchesDenseUniverseV1) {
+    testMatchesReference<BitUniverse, DenseUniverseV1>(std::make_unique<BitUniverse>(37, 150), 40);
+}
+
+TEST(BitUniverseTests, parallelMatchesSerial) {
+    for (size_t threads: {2, 5}) {
+        auto universe = std::make_unique<BitUniverse>(53, 200);
+        universe->setThreadCount(threads);
+        testMatchesReference<BitUniverse, DenseUniverseV1>(std::move(universe), 15);
+    }
+}
+
+// 11 words per row covers full vectors plus a scalar tail for every kernel width
+TEST(BitUniverseTests, everyKernelMatchesDenseUniverseV1) {
+    for (KernelIsa isa: {KernelIsa::scalar, KernelIsa::sse2, KernelIsa::avx2, KernelIsa::avx512}) {
+        if (!isKernelIsaSupported(isa)) {
+            continue;
+        }
+        SCOPED_TRACE(kernelIsaName(isa));
+        auto universe = std::make_unique<BitUniverse>(23, 700);
+        universe->setKernelIsa(isa);
+        testMatchesReference<BitUniverse, DenseUniverseV1>(std::move(universe), 12);
+    }
+}
+
+// wide enough rows that a block holds a single tile row, with a soup on the left, nothing in the middle
+// and a blinker on the right, whose tiles end a block where they started while still changing
+TEST(BitUniverseTests, temporalBlocksMatchSingleSteps) {
+    size_t rows = 150;
+    size_t cols = 30000;
+    for (size_t threads: {1, 3}) {
+        for (size_t depth: {2, 7, 64}) {
+            SCOPED_TRACE(std::to_string(threads) + " threads, depth " + std::to_string(depth));
+            auto universe = std::make_unique<BitUniverse>(rows, cols);
+            auto reference = std::make_unique<BitUniverse>(rows, cols);
+            universe->setThreadCount(threads);
+            universe->setTemporalBlockDepth(depth);
+            std::mt19937 rng(9);
+            std::bernoulli_distribution coin(0.35);
+            for (size_t row = 0; row < rows; ++row) {
+                for (size_t col = 0; col < 1500; ++col) {
+                    if (coin(rng)) {
+                        universe->makeCellAlive(row, col);
+                        reference->makeCellAlive(row, col);
+                    }
+                }
+            }
+            for (size_t col = 20000; col < 20003; ++col) {
+                universe->makeCellAlive(140, col);
+                reference->makeCellAlive(140, col);
+            }
+            for (size_t generations: {2 * depth, depth + 1, size_t{1}, 3 * depth}) {
+                universe->advance(generations);
+                for (size_t i = 0; i < generations; ++i) {
+                    reference->advance();
+                }
+                ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(reference.get())) << generations;
+                ASSERT_NO_FATAL_FAILURE(expectSummaryMatchesCells(universe.get()));
+                // single steps afterwards rely on the tile flags the blocks left behind
+                universe->advance();
+                reference->advance();
+                ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(reference.get())) << generations;
+            }
+        }
+    }
+    // three cells that become a block in the first generation, so their tile settles early in the block
+    for (size_t generations: {9, 16}) {
+        SCOPED_TRACE(std::to_string(generations) + " generations");
+        BitUniverse settling(128, 128);
+        BitUniverse reference(128, 128);
+        settling.setTemporalBlockDepth(8);
+        for (auto [row, col]: std::vector<std::pair<size_t, size_t>>{{10, 10}, {10, 11}, {11, 10}}) {
+            settling.makeCellAlive(row, col);
+            reference.makeCellAlive(row, col);
+        }
+        for (size_t i = 0; i < 2; ++i) {
+            settling.advance(generations);
+            for (size_t j = 0; j < generations; ++j) {
+                reference.advance();
+            }
+            ASSERT_EQ(sortedAliveCellsPos(&settling), sortedAliveCellsPos(&reference));
+            ASSERT_EQ(settling.population(), 4);
+            ASSERT_NO_FATAL_FAILURE(expectSummaryMatchesCells(&settling));
+        }
+    }
+    BitUniverse universe(10, 10);
+    ASSERT_THROW(universe.setTemporalBlockDepth(0), std::runtime_error);
+    ASSERT_THROW(universe.setTemporalBlockDepth(65), std::runtime_error);
+}
+
+TEST(BitUniverseTests, everyKernelMatchesScalarKernel) {
+    size_t word_count = 37;
+    std::mt19937_64 rng(7);
+    // three padded rows, the padding words stay dead
+    std::vector<uint64_t> rows(3 * (word_count + 2), 0);
+    for (size_t r = 0; r < 3; ++r) {
+        for (size_t w = 0; w < word_count; ++w) {
+            rows[r * (word_count + 2) + 1 + w] = rng();
+        }
+    }
+    uint64_t const* above = rows.data() + 1;
+    uint64_t const* row = above + word_count + 2;
+    uint64_t const* below = row + word_count + 2;
+    for (Rule rule: {conway_life, high_life, seeds, day_and_night, Rule::parse("B35/S1357")}) {
+        std::vector<uint64_t> expected(word_count);
+        getRowKernel(KernelIsa::scalar, rule)(above, row, below, expected.data(), word_count, rule.table());
+        for (KernelIsa isa: {KernelIsa::sse2, KernelIsa::avx2, KernelIsa::avx512}) {
+            RowKernel kernel = getRowKernel(isa, rule);
+            if (!kernel) {
+                continue;
+            }
+            std::vector<uint64_t> next(word_count);
+            kernel(above, row, below, next.data(), word_count, rule.table());
+            ASSERT_EQ(next, expected) << kernelIsaName(isa) << " " << rule.toString();
+        }
+    }
+}
+
+// the kernel compiled for a named rule agrees with the generic kernel reading its table
+TEST(BitUniverseTests, namedRuleKernelsMatchGenericKernel) {
+    size_t word_count = 21;
+    std::mt19937_64 rng(11);
+    std::vector<uint64_t> rows(3 * (word_count + 2), 0);
+    for (size_t r = 0; r < 3; ++r) {
+        for (size_t w = 0; w < word_count; ++w) {
+            rows[r * (word_count + 2) + 1 + w] = rng() & rng(); // sparser words reach more of the counts
+        }
+    }
+    uint64_t const* above = rows.data() + 1;
+    uint64_t const* row = above + word_count + 2;
+    uint64_t const* below = row + word_count + 2;
+    // B3/S023 is no named rule, so its kernel reads the table like the generic one does for any rule
+    RowKernel generic = getRowKernel(KernelIsa::scalar, Rule::parse("B3/S023"));
+    for (Rule rule: {conway_life, high_life, seeds, day_and_night, life_without_death}) {
+        std::vector<uint64_t> expected(word_count);
+        generic(above, row, below, expected.data(), word_count, rule.table());
+        std::vector<uint64_t> next(word_count);
+        getRowKernel(KernelIsa::scalar, rule)(above, row, below, next.data(), word_count, rule.table());
+        ASSERT_EQ(next, expected) << rule.toString();
+    }
+}
+
+// HashLifeUniverse tests
+TEST(HashLifeUniverseTests, UniverseStartsDead) {
+    testUniverseStartsDead(std::make_unique<HashLifeUniverse>(3, 4));
+}
+
+TEST(HashLifeUniverseTests, makeCellAlive) {
+    testMakeCellAlive(std::make_unique<HashLifeUniverse>(1, 1));
+}
+
+TEST(HashLifeUniverseTests, makeCellDead) {
+    testMakeCellDead(std::make_unique<HashLifeUniverse>(1, 1));
+}
+
+TEST(HashLifeUniverseTests, cellComesAlive) {
+    testNonEdgeCellComesAlive<HashLifeUniverse>();
+    testEdgeCellComesAlive<HashLifeUniverse>();
+    testCornerCellComesAlive<HashLifeUniverse>();
+}
+
+TEST(HashLifeUniverseTests, cellStaysDead) {
+    testNonEdgeCellStaysDead<HashLifeUniverse>();
+    testEdgeCellStaysDead<HashLifeUniverse>();
+    testCornerCellStaysDead<HashLifeUniverse>();
+}
+
+TEST(HashLifeUniverseTests, cellDies) {
+    testNonEdgeCellDies<HashLifeUniverse>();
+    testEdgeCellDies<HashLifeUniverse>();
+    testCornerCellDies<HashLifeUniverse>();
+}
+
+TEST(HashLifeUniverseTests, cellStaysAlive) {
+    testNonEdgeCellStaysAlive<HashLifeUniverse>();
+    testEdgeCellStaysAlive<HashLifeUniverse>();
+    testCornerCellStaysAlive<HashLifeUniverse>();
+}
+
+TEST(HashLifeUniverseTests, saveAndLoad) {
+    testSaveLoad<HashLifeUniverse>();
+}
+
+TEST(HashLifeUniverseTests, createFromFile) {
+    testCreateUniverseFromFile<HashLifeUniverse>();
+}
+
+// the walls around a non power of two Universe must behave like its edges
+TEST(HashLifeUniverseTests, matchesDenseUniverseV1) {
+    testMatchesReference<HashLifeUniverse, DenseUniverseV1>(std::make_unique<HashLifeUniverse>(29, 45), 60);
+}
+
+TEST(HashLifeUniverseTests, jumpMatchesSingleSteps) {
+    auto universe = std::make_unique<HashLifeUniverse>(50, 70);
+    auto reference = std::make_unique<BitUniverse>(50, 70);
+    std::mt19937 rng(3);
+    std::bernoulli_distribution coin(0.4);
+    for (size_t row = 0; row < 50; ++row) {
+        for (size_t col = 0; col < 70; ++col) {
+            if (coin(rng)) {
+                universe->makeCellAlive(row, col);
+                reference->makeCellAlive(row, col);
+            }
+        }
+    }
+    for (size_t jump: {1, 2, 7, 64, 100}) {
+        universe->advance(jump);
+        for (size_t i = 0; i < jump; ++i) {
+            reference->advance();
+        }
+        ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(reference.get())) << "jump " << jump;
+    }
+}
+
+TEST(HashLifeUniverseTests, gosperGunInHugeUniverse) {
+    std::filesystem::path src_path(__FILE__);
+    auto pattern_path = src_path.parent_path().parent_path() / "src" / "gosper_glider.univ";
+    auto universe = std::make_unique<HashLifeUniverse>(pattern_path);
+    auto reference = std::make_unique<SparseUniverseV2>(pattern_path);
+    universe->advance(300);
+    for (size_t i = 0; i < 300; ++i) {
+        reference->advance();
+    }
+    ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(reference.get()));
+}
+
+// TiledUniverse tests
+TEST(TiledUniverseTests, UniverseStartsDead) {
+    testUniverseStartsDead(std::make_unique<TiledUniverse>(3, 4));
+}
+
+TEST(TiledUniverseTests, makeCellAlive) {
+    testMakeCellAlive(std::make_unique<TiledUniverse>(1, 1));
+}
+
+TEST(TiledUniverseTests, makeCellDead) {
+    testMakeCellDead(std::make_unique<TiledUniverse>(1, 1));
+}
+
+TEST(TiledUniverseTests, cellComesAlive) {
+    testNonEdgeCellComesAlive<TiledUniverse>();
+    testEdgeCellComesAlive<TiledUniverse>();
+    testCornerCellComesAlive<TiledUniverse>();
+}
+
+TEST(TiledUniverseTests, cellStaysDead) {
+    testNonEdgeCellStaysDead<TiledUniverse>();
+    testEdgeCellStaysDead<TiledUniverse>();
+    testCornerCellStaysDead<TiledUniverse>();
+}
+
+TEST(TiledUniverseTests, cellDies) {
+    testNonEdgeCellDies<TiledUniverse>();
+    testEdgeCellDies<TiledUniverse>();
+    testCornerCellDies<TiledUniverse>();
+}
+
+TEST(TiledUniverseTests, cellStaysAlive) {
+    testNonEdgeCellStaysAlive<TiledUniverse>();
+    testEdgeCellStaysAlive<TiledUniverse>();
+    testCornerCellStaysAlive<TiledUniverse>();
+}
+
+TEST(TiledUniverseTests, saveAndLoad) {
+    testSaveLoad<TiledUniverse>();
+}
+
+TEST(TiledUniverseTests, createFromFile) {
+    testCreateUniverseFromFile<TiledUniverse>();
+}
+
+// several tiles in each direction with partial tiles at the far edges
+TEST(TiledUniverseTests, matchesDenseUniverseV1) {
+    testMatchesReference<TiledUniverse, DenseUniverseV1>(std::make_unique<TiledUniverse>(150, 200), 40);
+}
+
+TEST(TiledUniverseTests, gosperGunInHugeUniverse) {
+    std::filesystem::path src_path(__FILE__);
+    auto pattern_path = src_path.parent_path().parent_path() / "src" / "gosper_glider.univ";
+    auto universe = std::make_unique<TiledUniverse>(pattern_path);
+    auto reference = std::make_unique<SparseUniverseV2>(pattern_path);
+    for (size_t i = 0; i < 300; ++i) {
+        universe->advance();
+        reference->advance();
+    }
+    ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(reference.get()));
+}
+
+// SortedUniverse tests
+TEST(SortedUniverseTests, UniverseStartsDead) {
+    testUniverseStartsDead(std::make_unique<SortedUniverse>(3, 4));
+}
+
+TEST(SortedUniverseTests, makeCellAlive) {
+    testMakeCellAlive(std::make_unique<SortedUniverse>(1, 1));
+}
+
+TEST(SortedUniverseTests, makeCellDead) {
+    testMakeCellDead(std::make_unique<SortedUniverse>(1, 1));
+}
+
+TEST(SortedUniverseTests, cellComesAlive) {
+    testNonEdgeCellComesAlive<SortedUniverse>();
+    testEdgeCellComesAlive<SortedUniverse>();
+    testCornerCellComesAlive<SortedUniverse>();
+}
+
+TEST(SortedUniverseTests, cellStaysDead) {
+    testNonEdgeCellStaysDead<SortedUniverse>();
+    testEdgeCellStaysDead<SortedUniverse>();
+    testCornerCellStaysDead<SortedUniverse>();
+}
+
+TEST(SortedUniverseTests, cellDies) {
+    testNonEdgeCellDies<SortedUniverse>();
+    testEdgeCellDies<SortedUniverse>();
+    testCornerCellDies<SortedUniverse>();
+}
+
+TEST(SortedUniverseTests, cellStaysAlive) {
+    testNonEdgeCellStaysAlive<SortedUniverse>();
+    testEdgeCellStaysAlive<SortedUniverse>();
+    testCornerCellStaysAlive<SortedUniverse>();
+}
+
+TEST(SortedUniverseTests, saveAndLoad) {
+    testSaveLoad<SortedUniverse>();
+}
+
+TEST(SortedUniverseTests, createFromFile) {
+    testCreateUniverseFromFile<SortedUniverse>();
+}
+
+// wide enough that positions need several radix digits
+TEST(SortedUniverseTests, matchesDenseUniverseV1) {
+    testMatchesReference<SortedUniverse, DenseUniverseV1>(std::make_unique<SortedUniverse>(70, 3000), 30);
+}
+
+TEST(SortedUniverseTests, gosperGunInHugeUniverse) {
+    std::filesystem::path src_path(__FILE__);
+    auto pattern_path = src_path.parent_path().parent_path() / "src" / "gosper_glider.univ";
+    auto universe = std::make_unique<SortedUniverse>(pattern_path);
+    auto reference = std::make_unique<SparseUniverseV2>(pattern_path);
+    for (size_t i = 0; i < 300; ++i) {
+        universe->advance();
+        reference->advance();
+    }
+    ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(reference.get()));
+}
+
+// UniverseFile tests
+TEST(UniverseFileTests, binaryRoundTripsEveryEngine) {
+    for (const std::string& engine: universeEngineNames()) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 70, 150);
+        std::mt19937 rng(42);
+        std::bernoulli_distribution coin(0.35);
+        for (size_t row = 0; row < 70; ++row) {
+            for (size_t col = 0; col < 150; ++col) {
+                if (coin(rng)) {
+                    universe->makeCellAlive(row, col);
+                }
+            }
+        }
+        universe->saveBinary("test_universe_binary");
+        ASSERT_EQ(detectUniverseFormat("test_universe_binary.univ"), UniverseFormat::binary);
+        std::unique_ptr<Universe> loaded = makeUniverse(engine, 70, 150);
+        loaded->load("test_universe_binary.univ");
+        ASSERT_EQ(sortedAliveCellsPos(loaded.get()), sortedAliveCellsPos(universe.get()));
+    }
+    std::filesystem::remove("test_universe_binary.univ");
+}
+
+TEST(UniverseFileTests, textStillRoundTrips) {
+    auto universe = std::make_unique<SparseUniverseV3>(5, 6);
+    universe->makeCellAlive(0, 5);
+    universe->makeCellAlive(4, 0);
+    universe->save("test_universe_text.univ");
+    ASSERT_EQ(detectUniverseFormat("test_universe_text.univ"), UniverseFormat::text);
+    auto loaded = std::make_unique<SparseUniverseV3>("test_universe_text.univ");
+    ASSERT_EQ(sortedAliveCellsPos(loaded.get()), sortedAliveCellsPos(universe.get()));
+    std::filesystem::remove("test_universe_text.univ");
+}
+
+// many small chunks decoded on a thread pool come back in order
+TEST(UniverseFileTests, chunksDecodeInParallel) {
+    std::mt19937_64 rng(5);
+    size_t rows = 3000;
+    size_t cols = 7000;
+    std::vector<uint64_t> flat_positions;
+    for (size_t i = 0; i < 5000; ++i) {
+        flat_positions.push_back(rng() % (rows * cols));
+    }
+    std::sort(flat_positions.begin(), flat_positions.end());
+    flat_positions.erase(std::unique(flat_positions.begin(), flat_positions.end()), flat_positions.end());
+    writeBinaryUniverseFile("test_universe_chunks.univ", rows, cols, flat_positions, 7);
+    ThreadPool pool(3);
+    UniverseFileData fdata = readUniverseFile("test_universe_chunks.univ", &pool);
+    ASSERT_EQ(fdata.rows, rows);
+    ASSERT_EQ(fdata.cols, cols);
+    ASSERT_EQ(fdata.alive_cells_pos.size(), flat_positions.size());
+    for (size_t i = 0; i < flat_positions.size(); ++i) {
+        ASSERT_EQ(fdata.alive_cells_pos[i].first, flat_positions[i] / cols);
+        ASSERT_EQ(fdata.alive_cells_pos[i].second, flat_positions[i] % cols);
+    }
+    std::filesystem::remove("test_universe_chunks.univ");
+}
+
+// the flat position of the last Cell of a 2^32 x 2^32 Universe is 2^64 - 1
+TEST(UniverseFileTests, binaryHugeUniverse) {
+    size_t side = size_t{1} << 32;
+    auto universe = std::make_unique<SparseUniverseV3>(side, side);
+    std::vector<std::pair<size_t, size_t>> alive_cells_pos{{0, 0}, {0, side - 1}, {side - 1, 0}, {side - 1, side - 1}};
+    for (const auto& [row, col]: alive_cells_pos) {
+        universe->makeCellAlive(row, col);
+    }
+    universe->saveBinary("test_universe_huge.univ");
+    auto loaded = std::make_unique<SparseUniverseV3>("test_universe_huge.univ");
+    ASSERT_EQ(sortedAliveCellsPos(loaded.get()), alive_cells_pos);
+    std::filesystem::remove("test_universe_huge.univ");
+}
+
+TEST(UniverseFileTests, rejectsCorruptBinary) {
+    std::vector<uint64_t> flat_positions{3, 9, 27, 81};
+    writeBinaryUniverseFile("test_universe_corrupt.univ", 10, 10, flat_positions, 2);
+    std::string bytes;
+    {
+        std::ifstream file("test_universe_corrupt.univ", std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    // cut short in the last varint and in the chunk table
+    for (const std::string& corrupt: {bytes.substr(0, bytes.size() - 1), bytes.substr(0, 20)}) {
+        std::ofstream("test_universe_corrupt.univ", std::ios::binary | std::ios::trunc) << corrupt;
+        ASSERT_THROW(readUniverseFile("test_universe_corrupt.univ"), std::runtime_error);
+    }
+    // both chunks of 2 Cells point at the first payload, its 2 bytes read twice would make a population of 4
+    std::string overlapping = bytes;
+    size_t second_entry = bytes.size() - 4 - 24;
+    overlapping.replace(second_entry, 16, bytes.substr(second_entry - 24, 16));
+    std::ofstream("test_universe_corrupt.univ", std::ios::binary | std::ios::trunc) << overlapping;
+    ASSERT_THROW(readUniverseFile("test_universe_corrupt.univ"), std::runtime_error);
+    // each chunk is sorted on its own, but the second starts at or before the end of the first
+    for (const std::vector<uint64_t>& unsorted: {std::vector<uint64_t>{3, 9, 9, 81}, std::vector<uint64_t>{3, 9, 2, 81}}) {
+        writeBinaryUniverseFile("test_universe_corrupt.univ", 10, 10, unsorted, 2);
+        ASSERT_THROW(readUniverseFile("test_universe_corrupt.univ"), std::runtime_error);
+    }
+    // 81 lies past a 5x10 Universe
+    writeBinaryUniverseFile("test_universe_corrupt.univ", 5, 10, flat_positions, 2);
+    ASSERT_THROW(readUniverseFile("test_universe_corrupt.univ"), std::runtime_error);
+    std::filesystem::remove("test_universe_corrupt.univ");
+}
+
+TEST(PatternIoTests, rleGlider) {
+    std::string rle = "#N Glider\n#C comment lines are skipped\nx = 3, y = 3, rule = B3/S23\nbo$2bo$\n3o!\n";
+    std::istringstream header(rle);
+    PatternInfo info = peekRle(header);
+    ASSERT_EQ(info.rows, 3);
+    ASSERT_EQ(info.cols, 3);
+    ASSERT_TRUE(info.rule == conway_life);
+    std::vector<std::pair<size_t, size_t>> glider{{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}};
+    for (const std::string& engine: universeEngineNames()) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 10, 10);
+        std::istringstream in(rle);
+        readRle(in, *universe);
+        ASSERT_EQ(sortedAliveCellsPos(universe.get()), glider);
+    }
+}
+
+TEST(PatternIoTests, rleHeaderSetsRule) {
+    auto universe = std::make_unique<BitUniverse>(8, 8);
+    std::istringstream in("x = 2, y = 1, rule = B36/S23\n2o!");
+    readRle(in, *universe);
+    ASSERT_TRUE(universe->rule() == high_life);
+}
+
+TEST(PatternIoTests, roundTripsEveryEngine) {
+    for (const std::string& engine: universeEngineNames()) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 70, 150, "B36/S23");
+        std::mt19937 rng(42);
+        std::bernoulli_distribution coin(0.35);
+        for (size_t row = 0; row < 70; ++row) {
+            for (size_t col = 0; col < 150; ++col) {
+                if (coin(rng)) {
+                    universe->makeCellAlive(row, col);
+                }
+            }
+        }
+        for (const std::string file_path: {"test_pattern.rle", "test_pattern.mc"}) {
+            savePattern(file_path, *universe);
+            std::unique_ptr<Universe> loaded = makeUniverse(engine, 70, 150);
+            loadPattern(file_path, *loaded);
+            ASSERT_EQ(sortedAliveCellsPos(loaded.get()), sortedAliveCellsPos(universe.get())) << file_path;
+            ASSERT_TRUE(loaded->rule() == high_life);
+            PatternInfo info = peekPattern(file_path);
+            ASSERT_LE(info.rows, 70);
+            ASSERT_LE(info.cols, 150);
+        }
+        std::ifstream rle("test_pattern.rle");
+        for (std::string line; std::getline(rle, line);) {
+            ASSERT_LE(line.size(), 70);
+        }
+    }
+    std::filesystem::remove("test_pattern.rle");
+    std::filesystem::remove("test_pattern.mc");
+}
+
+// a block in every 8x8 leaf of a 2^31 x 2^31 Universe, 2^56 alive Cells in 29 macrocell nodes
+std::string repeatingMacrocell(uint32_t root_level) {
+    std::string mc = "[M2] (test)\n#R B3/S23\n**$**$\n";
+    for (uint32_t level = 4; level <= root_level; ++level) {
+        std::string index = std::to_string(level - 3);
+        mc += std::to_string(level) + " " + index + " " + index + " " + index + " " + index + "\n";
+    }
+    return mc;
+}
+
+TEST(PatternIoTests, macrocellStaysSharedInHashLife) {
+    size_t side = size_t{1} << 31;
+    auto universe = std::make_unique<HashLifeUniverse>(side, side);
+    std::istringstream in(repeatingMacrocell(31));
+    PatternInfo info = readMacrocell(in, *universe);
+    ASSERT_EQ(info.rows, side - 6);
+    ASSERT_EQ(info.cols, side - 6);
+    ASSERT_LT(universe->nodeCount(), 1000);
+    universe->advance(); // blocks are still lifes
+    for (size_t top: {size_t{0}, size_t{1} << 30, side - 8}) {
+        ASSERT_TRUE(universe->isCellAlive(top + 1, top + 1));
+        ASSERT_FALSE(universe->isCellAlive(top + 2, top + 1));
+    }
+    ASSERT_EQ(universe->toMacrocell().nodes.size(), 29);
+}
+
+// engines without a quadtree get the Cells one by one
+TEST(PatternIoTests, macrocellIntoEveryEngine) {
+    auto reference = std::make_unique<HashLifeUniverse>(64, 70);
+    std::istringstream reference_in(repeatingMacrocell(6));
+    readMacrocell(reference_in, *reference);
+    for (const std::string& engine: universeEngineNames()) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 64, 70);
+        std::istringstream in(repeatingMacrocell(6));
+        readMacrocell(in, *universe);
+        ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(reference.get()));
+        ASSERT_EQ(universe->getAliveCellsPos().size(), 8 * 8 * 4);
+    }
+}
+
+TEST(PatternIoTests, rejectsMalformedPatterns) {
+    for (const char* rle: {"x = 3, y = 3\nbo$2bq!", "x = 3, y = 3\nbo$2bo", "bo$2bo!", "x = 3\nbo!",
+            "x = 3, y = 3, rule = B9/S23\nbo!", "x = 20, y = 1\n20o!",
+            // run counts that wrap a 64-bit count to 3 and 1
+            "x = 3, y = 3\n18446744073709551619bo!", "x = 3, y = 3\n18446744073709551617$o!", "x = 3, y = 3\n11b!"}) {
+        auto universe = std::make_unique<SparseUniverseV3>(10, 10);
+        std::istringstream in(rle);
+        ASSERT_THROW(readRle(in, *universe), std::runtime_error) << rle;
+    }
+    for (const std::string& mc: std::vector<std::string>{"4 1 1 1 1\n", "[M2]\n**$\n5 1 1 1 1\n", "[M2]\n**$\n4 1 2 1 1\n",
+            "[M2]\n*********$\n", "[M2]\n", repeatingMacrocell(5)}) {
+        auto universe = std::make_unique<HashLifeUniverse>(20, 20);
+        std::istringstream in(mc);
+        ASSERT_THROW(readMacrocell(in, *universe), std::runtime_error) << mc;
+    }
+    ASSERT_THROW(peekPattern("test_pattern.txt"), std::runtime_error);
+}
+
+// records a soup, keeping the expected flat positions of every generation
+std::vector<std::vector<uint64_t>> recordSoup(const std::filesystem::path& file_path, size_t generations,
+        size_t keyframe_interval) {
+    auto universe = std::make_unique<SortedUniverse>(64, 48);
+    std::mt19937 rng(7);
+    std::bernoulli_distribution coin(0.4);
+    for (size_t row = 0; row < 64; ++row) {
+        for (size_t col = 0; col < 48; ++col) {
+            if (coin(rng)) {
+                universe->makeCellAlive(row, col);
+            }
+        }
+    }
+    std::vector<std::vector<uint64_t>> expected;
+    TrajectoryWriter writer(file_path, *universe, keyframe_interval);
+    for (size_t generation = 0; generation < generations; ++generation) {
+        if (generation > 0) {
+            universe->advance();
+        }
+        writer.record(*universe);
+        std::vector<uint64_t> flat_positions;
+        for (const auto& [row, col]: sortedAliveCellsPos(universe.get())) {
+            flat_positions.push_back(row * 48 + col);
+        }
+        expected.push_back(flat_positions);
+    }
+    return expected;
+}
+
+TEST(TrajectoryTests, seeksToEveryGeneration) {
+    std::vector<std::vector<uint64_t>> expected = recordSoup("test_trajectory.traj", 120, 16);
+    TrajectoryReader reader("test_trajectory.traj");
+    ASSERT_EQ(reader.generationCount(), 120);
+    ASSERT_EQ(reader.rowCount(), 64);
+    ASSERT_EQ(reader.colCount(), 48);
+    ASSERT_GE(reader.keyframeCount(), 120 / 16);
+    // forward, backward and across keyframes
+    for (size_t generation: {0, 1, 2, 15, 16, 17, 119, 3, 64, 40, 41, 100, 0}) {
+        ASSERT_EQ(reader.flatPositionsAt(generation), expected[generation]) << generation;
+    }
+    std::mt19937 rng(1);
+    for (size_t i = 0; i < 50; ++i) {
+        size_t generation = rng() % 120;
+        ASSERT_EQ(reader.flatPositionsAt(generation), expected[generation]) << generation;
+    }
+    ASSERT_THROW(reader.flatPositionsAt(120), std::runtime_error);
+    std::filesystem::remove("test_trajectory.traj");
+}
+
+TEST(TrajectoryTests, restoreIntoAnotherEngine) {
+    recordSoup("test_trajectory.traj", 30, 8);
+    TrajectoryReader reader("test_trajectory.traj");
+    auto universe = std::make_unique<DenseUniverseV1>(64, 48);
+    universe->makeCellAlive(0, 0);
+    reader.restore(20, *universe);
+    auto reference = std::make_unique<SortedUniverse>(64, 48);
+    reader.restore(10, *reference);
+    for (size_t i = 0; i < 10; ++i) {
+        reference->advance();
+    }
+    ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(reference.get()));
+    auto wrong_size = std::make_unique<SortedUniverse>(48, 64);
+    ASSERT_THROW(reader.restore(0, *wrong_size), std::runtime_error);
+    std::filesystem::remove("test_trajectory.traj");
+}
+
+// restore empties the target with makeAllCellsDead first, whatever the engine and whatever it held
+TEST(TrajectoryTests, restoreIntoEveryEngine) {
+    std::vector<std::vector<uint64_t>> expected = recordSoup("test_trajectory.traj", 30, 8);
+    TrajectoryReader reader("test_trajectory.traj");
+    for (const std::string& engine: universeEngineNames()) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 64, 48);
+        for (size_t generation: {20, 5, 29}) {
+            universe->advance();
+            universe->makeCellAlive(63, 47);
+            reader.restore(generation, *universe);
+            std::vector<uint64_t> flat_positions;
+            for (const auto& [row, col]: sortedAliveCellsPos(universe.get())) {
+                flat_positions.push_back(row * 48 + col);
+            }
+            ASSERT_EQ(flat_positions, expected[generation]) << generation;
+            ASSERT_NO_FATAL_FAILURE(expectSummaryMatchesCells(universe.get()));
+        }
+        universe->makeAllCellsDead();
+        ASSERT_EQ(universe->population(), 0);
+        ASSERT_TRUE(universe->getAliveCellsPos().empty());
+    }
+    std::filesystem::remove("test_trajectory.traj");
+}
+
+// a writer that never got to close() leaves no index, the records that made it to disk are still readable
+TEST(TrajectoryTests, readsWithoutIndex) {
+    std::vector<std::vector<uint64_t>> expected = recordSoup("test_trajectory.traj", 40, 8);
+    size_t keyframe_count = TrajectoryReader("test_trajectory.traj").keyframeCount();
+    size_t records_end = std::filesystem::file_size("test_trajectory.traj") - (1 + 16 + 16 * keyframe_count + 16);
+    std::filesystem::resize_file("test_trajectory.traj", records_end);
+    TrajectoryReader reader("test_trajectory.traj");
+    ASSERT_EQ(reader.generationCount(), 40);
+    ASSERT_EQ(reader.keyframeCount(), keyframe_count);
+    ASSERT_EQ(reader.flatPositionsAt(39), expected[39]);
+    // cut inside the last record
+    std::filesystem::resize_file("test_trajectory.traj", records_end - 1);
+    TrajectoryReader truncated("test_trajectory.traj");
+    ASSERT_EQ(truncated.generationCount(), 39);
+    ASSERT_EQ(truncated.flatPositionsAt(38), expected[38]);
+    std::filesystem::remove("test_trajectory.traj");
+}
+
+// a glider costs the same few bytes per generation however large the Universe is
+TEST(TrajectoryTests, sizeFollowsActivity) {
+    std::vector<size_t> file_sizes;
+    for (size_t side: {64, 1 << 20}) {
+        auto universe = std::make_unique<SparseUniverseV3>(side, side);
+        for (const auto& [row, col]: std::vector<std::pair<size_t, size_t>>{{1, 2}, {2, 3}, {3, 1}, {3, 2}, {3, 3}}) {
+            universe->makeCellAlive(row, col);
+        }
+        {
+            TrajectoryWriter writer("test_trajectory.traj", *universe, 1000);
+            for (size_t generation = 0; generation < 200; ++generation) {
+                writer.record(*universe);
+                universe->advance();
+            }
+        }
+        file_sizes.push_back(std::filesystem::file_size("test_trajectory.traj"));
+    }
+    ASSERT_LT(file_sizes[0], 200 * 16);
+    ASSERT_LT(file_sizes[1], file_sizes[0] + 200 * 8);
+    std::filesystem::remove("test_trajectory.traj");
+}
+
+TEST(TrajectoryTests, rejectsOtherFiles) {
+    std::ofstream("test_trajectory.traj", std::ios::binary) << "GameOfLifeUniverse\n1\n1\n0\n plus some padding";
+    ASSERT_THROW(TrajectoryReader("test_trajectory.traj"), std::runtime_error);
+    std::filesystem::remove("test_trajectory.traj");
+    ASSERT_THROW(TrajectoryReader("test_trajectory_missing.traj"), std::runtime_error);
+}
+
+TEST(CheckpointerTests, takeSnapshotEveryEngine) {
+    for (const std::string& engine: universeEngineNames()) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 50, 130);
+        std::mt19937 rng(3);
+        std::bernoulli_distribution coin(0.3);
+        std::vector<uint64_t> expected;
+        for (size_t row = 0; row < 50; ++row) {
+            for (size_t col = 0; col < 130; ++col) {
+                if (coin(rng)) {
+                    universe->makeCellAlive(row, col);
+                    expected.push_back(row * 130 + col);
+                }
+            }
+        }
+        CellSnapshot snapshot;
+        snapshot.flat_positions = {7}; // replaced, not appended to
+        universe->takeSnapshot(snapshot);
+        snapshot.normalize();
+        ASSERT_EQ(snapshot.rows, 50);
+        ASSERT_EQ(snapshot.cols, 130);
+        ASSERT_EQ(snapshot.flat_positions, expected);
+    }
+}
+
+// the checkpoint holds the generation it was taken at, however far the run got while it was written
+TEST(CheckpointerTests, checkpointsEveryInterval) {
+    std::filesystem::path directory = "test_checkpoints";
+    std::filesystem::remove_all(directory);
+    auto universe = std::make_unique<BitUniverse>(100, 200);
+    std::mt19937 rng(11);
+    std::bernoulli_distribution coin(0.3);
+    for (size_t row = 0; row < 100; ++row) {
+        for (size_t col = 0; col < 200; ++col) {
+            if (coin(rng)) {
+                universe->makeCellAlive(row, col);
+            }
+        }
+    }
+    auto expected = std::make_unique<BitUniverse>(100, 200);
+    {
+        Checkpointer checkpointer(directory, 5);
+        for (size_t generation = 0; generation <= 22; ++generation) {
+            checkpointer.onGeneration(*universe, generation);
+            if (generation == 20) {
+                universe->save("test_checkpoint_expected.univ");
+            }
+            universe->advance();
+            if (generation < 20) {
+                checkpointer.flush(); // so every older checkpoint gets written rather than superseded
+            }
+        }
+        checkpointer.flush();
+        ASSERT_EQ(checkpointer.writtenCount(), 5);
+        ASSERT_EQ(checkpointer.latestPath(), directory / "checkpoint_20.univ");
+    }
+    expected->load("test_checkpoint_expected.univ");
+    auto loaded = std::make_unique<SortedUniverse>(100, 200);
+    loaded->load(directory / "checkpoint_20.univ");
+    ASSERT_EQ(sortedAliveCellsPos(loaded.get()), sortedAliveCellsPos(expected.get()));
+    // the two newest are kept, nothing half written is left behind
+    size_t file_count = 0;
+    for (const auto& entry: std::filesystem::directory_iterator(directory)) {
+        ASSERT_EQ(entry.path().extension(), ".univ");
+        ++file_count;
+    }
+    ASSERT_EQ(file_count, 2);
+    std::filesystem::remove_all(directory);
+    std::filesystem::remove("test_checkpoint_expected.univ");
+}
+
+TEST(CheckpointerTests, reportsWriterErrors) {
+    std::filesystem::path directory = "test_checkpoints";
+    Checkpointer checkpointer(directory, 1);
+    std::filesystem::remove_all(directory);
+    auto universe = std::make_unique<SortedUniverse>(10, 10);
+    checkpointer.checkpoint(*universe, 0);
+    ASSERT_THROW(checkpointer.flush(), std::runtime_error);
+    ASSERT_THROW(checkpointer.checkpoint(*universe, 1), std::runtime_error);
+}
+
+TEST(StatsTests, writesCsvJsonAndTrace) {
+    std::vector<GenerationStats> stats(2);
+    stats[1].generation = 1;
+    stats[1].live_cells = 3;
+    stats[1].start_ns = 2500;
+    stats[1].neighbor_ns = 1200;
+    writeStatsCsv("test_stats.csv", stats);
+    writeStatsJson("test_stats.json", stats);
+    writeStatsChromeTrace("test_stats_trace.json", stats);
+    auto read = [](const char* file_path) {
+        std::ifstream file(file_path);
+        return std::string(std::istreambuf_iterator<char>(file), {});
+    };
+    std::string csv = read("test_stats.csv");
+    ASSERT_EQ(std::count(csv.begin(), csv.end(), '\n'), 3);
+    ASSERT_EQ(csv.rfind("generation,live_cells,births,deaths,", 0), 0);
+    ASSERT_NE(csv.find("\n1,3,0,0,0,0,0,2500,1200,0,0\n"), std::string::npos);
+    std::string json = read("test_stats.json");
+    ASSERT_NE(json.find("{\"generation\": 1, \"live_cells\": 3,"), std::string::npos);
+    std::string trace = read("test_stats_trace.json");
+    ASSERT_NE(trace.find("\"name\": \"neighbor pass\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": 2.500, "
+        "\"dur\": 1.200"), std::string::npos);
+    ASSERT_NE(trace.find("\"name\": \"frontier pass\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": 3.700"),
+        std::string::npos);
+    ASSERT_THROW(writeStatsCsv("no_such_directory/stats.csv", stats), std::runtime_error);
+}
+
+// only records in a build configured with -DGOL_ENABLE_STATS=ON, the engines with hooks agree on every count
+TEST(StatsTests, engineCountsAgree) {
+    std::vector<std::vector<GenerationStats>> recorded;
+    for (const char* engine: {"DenseUniverseV1", "SparseUniverseV1", "SparseUniverseV2", "SparseUniverseV3"}) {
+        for (size_t thread_count: {1, 2}) {
+            SCOPED_TRACE(std::string(engine) + " " + std::to_string(thread_count));
+            std::unique_ptr<Universe> universe = makeUniverse(engine, 100, 100);
+            universe->setThreadCount(thread_count);
+            std::mt19937 rng(5);
+            std::bernoulli_distribution coin(0.5);
+            size_t population = 0;
+            for (size_t row = 0; row < 100; ++row) {
+                for (size_t col = 0; col < 100; ++col) {
+                    if (coin(rng)) {
+                        universe->makeCellAlive(row, col);
+                        population++;
+                    }
+                }
+            }
+            if (!stats_compiled) {
+                ASSERT_THROW(universe->setStatsEnabled(true), std::runtime_error);
+                ASSERT_TRUE(universe->generationStats().empty());
+                continue;
+            }
+            universe->setStatsEnabled(true);
+            for (size_t generation = 0; generation < 4; ++generation) {
+                universe->advance();
+            }
+            const std::vector<GenerationStats>& stats = universe->generationStats();
+            ASSERT_EQ(stats.size(), 4);
+            for (const GenerationStats& generation: stats) {
+                ASSERT_EQ(generation.live_cells, population + generation.births - generation.deaths);
+                population = generation.live_cells;
+            }
+            ASSERT_EQ(stats.back().generation, 3);
+            ASSERT_EQ(population, universe->getAliveCellsPos().size());
+            recorded.push_back(stats);
+            universe->setStatsEnabled(false);
+            universe->advance();
+            ASSERT_TRUE(universe->generationStats().empty());
+        }
+    }
+    for (const std::vector<GenerationStats>& stats: recorded) {
+        for (size_t generation = 0; generation < stats.size(); ++generation) {
+            ASSERT_EQ(stats[generation].births, recorded[0][generation].births);
+            ASSERT_EQ(stats[generation].deaths, recorded[0][generation].deaths);
+        }
+    }
+}
+
+// what the painter wrote to fd since offset
+std::string readPainted(int fd, off_t& offset) {
+    off_t end = lseek(fd, 0, SEEK_END);
+    std::string bytes(end - offset, '\0');
+    EXPECT_EQ(pread(fd, bytes.data(), bytes.size(), offset), static_cast<ssize_t>(bytes.size()));
+    offset = end;
+    return bytes;
+}
+
+TEST(PainterTests, presentsOnlyChangedCells) {
+    int fd = open("test_painter.out", O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    off_t offset = 0;
+    {
+        GridPainter painter(fd);
+        ASSERT_EQ(readPainted(fd, offset), "\x1B[?25l");
+        for (size_t col = 0; col < 40; ++col) {
+            painter.paint(0, col, "█", Color::red);
+        }
+        for (size_t row = 1; row < 40; ++row) {
+            for (size_t col = row % 2; col < 40; col += 2) {
+                painter.paint(row, col, "█", Color::green);
+            }
+        }
+        size_t writes = painter.writeCount();
+        painter.present();
+        ASSERT_EQ(painter.writeCount(), writes + 1);
+        std::string frame = readPainted(fd, offset);
+        ASSERT_EQ(frame.rfind("\x1B[H\x1B[2J\x1B[1;1H\x1B[31m█████", 0), 0);
+        ASSERT_NE(frame.find("\x1B[2;2H\x1B[32m█\x1B[2;4H█"), std::string::npos);
+
+        // the same frame but one Cell writes that Cell alone
+        for (size_t col = 0; col < 40; ++col) {
+            painter.paint(0, col, "█", Color::red);
+        }
+        for (size_t row = 1; row < 40; ++row) {
+            for (size_t col = row % 2; col < 40; col += 2) {
+                if (row != 7 || col != 9) {
+                    painter.paint(row, col, "█", Color::green);
+                }
+            }
+        }
+        painter.paint(7, 8, 'x', Color::yellow);
+        painter.present();
+        ASSERT_EQ(painter.writeCount(), writes + 2);
+        ASSERT_EQ(readPainted(fd, offset), "\x1B[8;9H\x1B[33mx \x1B[0m");
+
+        // an empty frame blanks what the last one showed, then nothing is left to write
+        painter.present();
+        ASSERT_EQ(painter.lastFrameBytes(), readPainted(fd, offset).size());
+        painter.present();
+        ASSERT_EQ(painter.lastFrameBytes(), 0);
+        ASSERT_EQ(painter.writeCount(), writes + 3);
+        painter.moveBelowFrame();
+        ASSERT_EQ(readPainted(fd, offset), "\x1B[41;1H");
+    }
+    ASSERT_EQ(readPainted(fd, offset), "\x1B[0m\x1B[?25h");
+    close(fd);
+    std::filesystem::remove("test_painter.out");
+}
+
+TEST(AnimatorTests, queueKeepsOrderAcrossThreads) {
+    SpscQueue<std::vector<size_t>> queue(5);
+    ASSERT_EQ(queue.capacity(), 8);
+    std::vector<size_t> value;
+    ASSERT_FALSE(queue.tryPop(value));
+    constexpr size_t count = 100000;
+    std::thread producer([&queue] {
+        std::vector<size_t> item;
+        for (size_t i = 0; i < count; ++i) {
+            item.assign(1 + i % 3, i);
+            while (!queue.tryPush(item)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (size_t i = 0; i < count; ++i) {
+        while (!queue.tryPop(value)) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(value, std::vector<size_t>(1 + i % 3, i));
+    }
+    producer.join();
+    ASSERT_FALSE(queue.tryPop(value));
+}
+
+TEST(AnimatorTests, simulationRunsAheadOfDisplay) {
+    int fd = open("test_animator.out", O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    auto universe = std::make_unique<SparseUniverseV3>(30, 30);
+    auto expected = std::make_unique<SparseUniverseV3>(30, 30);
+    for (auto [row, col]: std::vector<std::pair<size_t, size_t>>{{1, 2}, {2, 3}, {3, 1}, {3, 2}, {3, 3}}) {
+        universe->makeCellAlive(row, col);
+        expected->makeCellAlive(row, col);
+    }
+    for (size_t step = 0; step < 12; ++step) {
+        expected->advance();
+    }
+    FullViewAnimator animator(std::chrono::milliseconds(20), 4, fd);
+    animator.animate(universe.get(), 12);
+    ASSERT_EQ(universe->getAliveCellsPos(), expected->getAliveCellsPos());
+    // the display takes 20 ms a frame, the glider far less, so the queue fills up
+    ASSERT_EQ(animator.maxQueuedFrames(), 4);
+    for (size_t step = 0; step < 12; ++step) {
+        expected->advance();
+    }
+    AutoPanAnimator auto_pan(std::chrono::milliseconds(0), 2, fd);
+    auto_pan.animate(universe.get(), 6);
+    CenterAutoPanAnimator center(std::chrono::milliseconds(0), 1, fd);
+    center.animate(universe.get(), 6);
+    ASSERT_EQ(universe->getAliveCellsPos(), expected->getAliveCellsPos());
+    off_t offset = 0;
+    std::string painted = readPainted(fd, offset);
+    ASSERT_NE(painted.find("█"), std::string::npos);
+    close(fd);
+    std::filesystem::remove("test_animator.out");
+}
+
+TEST(RegionQueryTests, everyEngineMatchesFiltering) {
+    std::vector<std::string> engines = universeEngineNames();
+    for (const std::string& engine: engines) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 150, 200);
+        std::mt19937 rng(11);
+        std::bernoulli_distribution coin(0.2);
+        std::vector<std::pair<size_t, size_t>> alive;
+        for (size_t row = 0; row < 150; ++row) {
+            for (size_t col = 0; col < 200; ++col) {
+                if (coin(rng)) {
+                    universe->makeCellAlive(row, col);
+                    alive.push_back({row, col});
+                }
+            }
+        }
+        // word and tile edges, a single Cell, empty, past the edges and the whole Universe
+        for (CellRect rect: {CellRect{3, 60, 70, 130}, CellRect{64, 64, 128, 128}, CellRect{7, 9, 8, 10},
+                CellRect{20, 20, 20, 90}, CellRect{140, 190, 1000, 5000}, CellRect{0, 0, 150, 200},
+                CellRect{0, 127, 150, 129}}) {
+            SCOPED_TRACE(std::to_string(rect.top) + " " + std::to_string(rect.left));
+            std::vector<std::pair<size_t, size_t>> expected;
+            std::copy_if(alive.begin(), alive.end(), std::back_inserter(expected),
+                    [&rect](const std::pair<size_t, size_t>& cell) { return rect.contains(cell.first, cell.second); });
+            std::vector<std::pair<size_t, size_t>> visited;
+            universe->forEachAliveCellIn(rect, [&visited](size_t row, size_t col) { visited.push_back({row, col}); });
+            std::sort(visited.begin(), visited.end());
+            ASSERT_EQ(visited, expected);
+            ASSERT_EQ(universe->countAliveIn(rect), expected.size());
+        }
+    }
+}
+
+// a handful of Cells far apart in a Universe too large to visit Cell by Cell
+TEST(RegionQueryTests, sparseEnginesOnHugeUniverse) {
+    size_t size = size_t{1} << 32;
+    for (const char* engine: {"HashLifeUniverse", "SparseUniverseV1", "SparseUniverseV2", "SparseUniverseV3",
+            "SortedUniverse", "TiledUniverse"}) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, size, size);
+        for (size_t i = 0; i < 64; ++i) {
+            universe->makeCellAlive(i * (size / 64) + 5, i * (size / 64) + 7);
+        }
+        CellRect rect{size / 2, size / 2, size / 2 + 40, size / 2 + 40};
+        std::vector<std::pair<size_t, size_t>> visited;
+        universe->forEachAliveCellIn(rect, [&visited](size_t row, size_t col) { visited.push_back({row, col}); });
+        ASSERT_EQ(visited, (std::vector<std::pair<size_t, size_t>>{{size / 2 + 5, size / 2 + 7}}));
+        ASSERT_EQ(universe->countAliveIn({0, 0, size, size / 2}), 32);
+        // its area does not fit in 64 bits
+        ASSERT_EQ(universe->countAliveIn({0, 0, size, size}), 64);
+    }
+    ASSERT_EQ((CellRect{0, 0, size, size}.area()), std::numeric_limits<size_t>::max());
+}
+
+// edits on and off the edges, duplicates, steps on one and several threads, and a reload
+TEST(SummaryTests, everyEngineKeepsItCurrent) {
+    for (const std::string& engine: universeEngineNames()) {
+        for (size_t thread_count: {1, 3}) {
+            SCOPED_TRACE(engine + " " + std::to_string(thread_count));
+            std::unique_ptr<Universe> universe = makeUniverse(engine, 110, 170);
+            universe->setThreadCount(thread_count);
+            expectSummaryMatchesCells(universe.get());
+            std::mt19937 rng(5);
+            std::bernoulli_distribution coin(0.3);
+            for (size_t row = 0; row < 110; ++row) {
+                for (size_t col = 0; col < 170; ++col) {
+                    if (coin(rng)) {
+                        universe->makeCellAlive(row, col);
+                    }
+                }
+            }
+            universe->makeCellAlive(0, 0);
+            universe->makeCellAlive(0, 0);
+            expectSummaryMatchesCells(universe.get());
+            for (size_t i = 0; i < 25; ++i) {
+                universe->advance();
+                ASSERT_NO_FATAL_FAILURE(expectSummaryMatchesCells(universe.get())) << "generation " << i + 1;
+                CellRect box = universe->boundingBox();
+                universe->makeCellDead(box.top, box.left);
+                universe->makeCellDead(box.bottom - 1, box.right - 1);
+                universe->makeCellDead(box.bottom - 1, box.right - 1);
+                ASSERT_NO_FATAL_FAILURE(expectSummaryMatchesCells(universe.get())) << "generation " << i + 1;
+            }
+            universe->save("test_summary.univ");
+            universe->makeCellAlive(109, 169);
+            universe->load("test_summary.univ");
+            expectSummaryMatchesCells(universe.get());
+            std::filesystem::remove("test_summary.univ");
+        }
+    }
+}
+
+// a glider leaves its old corner behind every generation, the box follows it and the population stays 5
+TEST(SummaryTests, boxFollowsGliderToTheEdge) {
+    for (const std::string& engine: universeEngineNames()) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 40, 40);
+        for (const auto& [row, col]: std::vector<std::pair<size_t, size_t>>{{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}}) {
+            universe->makeCellAlive(row, col);
+        }
+        for (size_t i = 0; i < 4 * 30; ++i) {
+            universe->advance();
+        }
+        ASSERT_EQ(universe->population(), 5);
+        CellRect box = universe->boundingBox();
+        ASSERT_EQ(box.top, 30);
+        ASSERT_EQ(box.left, 30);
+        ASSERT_EQ(box.bottom, 33);
+        ASSERT_EQ(box.right, 33);
+        ASSERT_NEAR(universe->centroid().first, (30 + 31 + 32 + 32 + 32) / 5.0, 1e-9);
+        // into the corner, where it becomes a block
+        for (size_t i = 0; i < 4 * 10; ++i) {
+            universe->advance();
+        }
+        expectSummaryMatchesCells(universe.get());
+    }
+}
+
+TEST(SummaryTests, fixedSizeDenseUniverse) {
+    auto universe = std::make_unique<DenseUniverseV2<50, 70>>();
+    std::mt19937 rng(9);
+    std::bernoulli_distribution coin(0.3);
+    for (size_t row = 0; row < 50; ++row) {
+        for (size_t col = 0; col < 70; ++col) {
+            if (coin(rng)) {
+                universe->makeCellAlive(row, col);
+            }
+        }
+    }
+    for (size_t i = 0; i < 10; ++i) {
+        universe->advance();
+        expectSummaryMatchesCells(universe.get());
+    }
+}
+
+// Cycle tests
+TEST(CycleTests, fastForwardMatchesStepping) {
+    for (const std::string& engine: universeEngineNames()) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 40, 40);
+        std::unique_ptr<Universe> reference = makeUniverse(engine, 40, 40);
+        std::mt19937 rng(13);
+        std::bernoulli_distribution coin(0.3);
+        for (size_t row = 0; row < 40; ++row) {
+            for (size_t col = 0; col < 40; ++col) {
+                if (coin(rng)) {
+                    universe->makeCellAlive(row, col);
+                    reference->makeCellAlive(row, col);
+                }
+            }
+        }
+        StabilityReport report = universe->advanceDetectingCycles(3001);
+        ASSERT_TRUE(report.stabilized);
+        ASSERT_GE(report.period, 1);
+        ASSERT_EQ(universe->generation(), 3001);
+        reference->advance(report.generation);
+        std::vector<std::pair<size_t, size_t>> cycle_start = sortedAliveCellsPos(reference.get());
+        reference->advance(report.period);
+        ASSERT_EQ(sortedAliveCellsPos(reference.get()), cycle_start);
+        reference->advance(3001 - report.generation - report.period);
+        ASSERT_EQ(reference->generation(), 3001);
+        ASSERT_EQ(sortedAliveCellsPos(universe.get()), sortedAliveCellsPos(reference.get()));
+        expectSummaryMatchesCells(universe.get());
+    }
+}
+
+// 1 + x + ... + x^(2^log2_count - 1), doubling the terms at each step
+uint64_t geometricHashSum(uint64_t x, size_t log2_count) {
+    uint64_t sum = 1;
+    for (size_t k = 0; k < log2_count; ++k) {
+        sum *= 1 + x;
+        x *= x;
+    }
+    return sum;
+}
+
+// the hash of 2^56 alive Cells is composed from the macrocell's 29 distinct nodes, none of the Cells is visited
+TEST(CycleTests, hashLifeHashesHugePatterns) {
+    size_t side = size_t{1} << 31;
+    auto universe = std::make_unique<HashLifeUniverse>(side, side);
+    std::istringstream in(repeatingMacrocell(31));
+    readMacrocell(in, *universe);
+    // a block at the top left of each 8x8 leaf, 2^28 leaves along either side
+    uint64_t block = cellHash(0, 0) + cellHash(0, 1) + cellHash(1, 0) + cellHash(1, 1);
+    uint64_t expected = block * geometricHashSum(rowHashKey(8), 28) * geometricHashSum(colHashKey(8), 28);
+    ASSERT_EQ(universe->stateHash(), expected);
+    universe->makeCellDead(side - 7, side - 7);
+    ASSERT_EQ(universe->stateHash(), expected - cellHash(side - 7, side - 7));
+    universe->makeCellAlive(side - 7, side - 7);
+    StabilityReport report = universe->advanceDetectingCycles(size_t{1} << 40);
+    ASSERT_TRUE(report.stabilized);
+    ASSERT_EQ(report.period, 1);
+    ASSERT_EQ(universe->generation(), size_t{1} << 40);
+    ASSERT_EQ(universe->stateHash(), expected);
+}
+
+// the terms of (1 - A^64)(1 - A^128)(1 - A^256)(1 - A^512)(1 - B^64)(1 - B^128)(1 - B^256), whose product is 0 mod 2^64,
+// as the top left Cells of 2x2 blocks: even terms go into one set and odd terms into the other, same hash
+std::array<std::vector<std::pair<size_t, size_t>>, 2> collidingBlockSets() {
+    std::array<std::vector<std::pair<size_t, size_t>>, 2> sets;
+    for (size_t row_terms = 0; row_terms < 16; ++row_terms) {
+        for (size_t col_terms = 0; col_terms < 8; ++col_terms) {
+            size_t parity = (__builtin_popcount(row_terms) + __builtin_popcount(col_terms)) % 2;
+            sets[parity].push_back({64 * row_terms, 64 * col_terms});
+        }
+    }
+    return sets;
+}
+
+void setBlocks(Universe* universe, const std::vector<std::pair<size_t, size_t>>& corners, bool alive) {
+    for (const auto& [row, col]: corners) {
+        for (size_t cell = 0; cell < 4; ++cell) {
+            if (alive) {
+                universe->makeCellAlive(row + cell / 2, col + cell % 2);
+            }
+            else {
+                universe->makeCellDead(row + cell / 2, col + cell % 2);
+            }
+        }
+    }
+}
+
+// a hash match between two different still lifes is no repeat, the next generation of the second one is
+TEST(CycleTests, collidingHashesAreNoCycle) {
+    std::array<std::vector<std::pair<size_t, size_t>>, 2> sets = collidingBlockSets();
+    for (const std::string& engine: universeEngineNames()) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 962, 450);
+        setBlocks(universe.get(), sets[0], true);
+        uint64_t first_hash = universe->stateHash();
+        CycleDetector detector;
+        ASSERT_FALSE(detector.observe(*universe).stabilized);
+        setBlocks(universe.get(), sets[0], false);
+        setBlocks(universe.get(), sets[1], true);
+        ASSERT_EQ(universe->stateHash(), first_hash);
+        ASSERT_EQ(universe->population(), 4 * 64);
+        universe->advance();
+        ASSERT_FALSE(detector.observe(*universe).stabilized);
+        universe->advance();
+        StabilityReport report = detector.observe(*universe);
+        ASSERT_TRUE(report.stabilized);
+        ASSERT_EQ(report.generation, 1);
+        ASSERT_EQ(report.period, 1);
+    }
+}
+
+TEST(CycleTests, stopsAtTheFirstRepeat) {
+    for (const std::string& engine: universeEngineNames()) {
+        SCOPED_TRACE(engine);
+        std::unique_ptr<Universe> universe = makeUniverse(engine, 10, 10);
+        for (size_t col = 3; col < 6; ++col) {
+            universe->makeCellAlive(4, col); // blinker
+        }
+        universe->advance(3);
+        StabilityReport report = universe->advanceDetectingCycles(1000, CycleAction::stop);
+        ASSERT_TRUE(report.stabilized);
+        ASSERT_EQ(report.generation, 3);
+        ASSERT_EQ(report.period, 2);
+        ASSERT_EQ(universe->generation(), 5);
+        // a still life repeats at once
+        for (size_t row = 3; row < 6; ++row) {
+            universe->makeCellDead(row, 4);
+        }
+        for (const auto& [row, col]: std::vector<std::pair<size_t, size_t>>{{4, 4}, {4, 5}, {5, 4}, {5, 5}}) {
+            universe->makeCellAlive(row, col);
+        }
+        report = universe->advanceDetectingCycles(1000);
+        ASSERT_EQ(report.period, 1);
+        ASSERT_EQ(universe->generation(), 1005);
+        ASSERT_EQ(universe->population(), 4);
+        StabilityReport still = universe->advanceDetectingCycles(0);
+        ASSERT_FALSE(still.stabilized);
+        ASSERT_EQ(universe->generation(), 1005);
+    }
+}
+
+// on a torus a glider comes back to its cells after 4 generations per Cell of the side
+TEST(CycleTests, historyBoundsThePeriod) {
+    for (size_t history_size: {31, 32}) {
+        DenseUniverseV1 universe(8, 8);
+        universe.setTopology(Topology::torus);
+        for (const auto& [row, col]: std::vector<std::pair<size_t, size_t>>{{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}}) {
+            universe.makeCellAlive(row, col);
+        }
+        CycleDetector detector(history_size);
+        StabilityReport report;
+        for (size_t i = 0; i < 100 && !report.stabilized; ++i) {
+            report = detector.observe(universe);
+            universe.advance();
+        }
+        ASSERT_EQ(report.stabilized, history_size == 32);
+        ASSERT_EQ(report.period, history_size == 32 ? 32 : 0);
+    }
+    ASSERT_THROW(CycleDetector(0), std::runtime_error);
+}